@@ -0,0 +1,137 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_async.hpp>
+
+bool I2CAsyncEngine::Submit(I2CTransaction *transaction) {
+  if (transaction == nullptr || (transaction->tx_len == 0 && transaction->rx_len == 0)) {
+    return false;
+  }
+
+  bool start_now = false;
+  I2C_ENTER_CRITICAL();
+  if (active_ == nullptr) {
+    transaction->state = kI2cTransactionBusy;
+    active_ = transaction;
+    start_now = true;
+  } else if (count_ < kI2cAsyncQueueSize) {
+    transaction->state = kI2cTransactionQueued;
+    queue_[tail_] = transaction;
+    tail_ = (tail_ + 1) % kI2cAsyncQueueSize;
+    count_++;
+  } else {
+    I2C_EXIT_CRITICAL();
+    return false;
+  }
+  I2C_EXIT_CRITICAL();
+
+  // The completion interrupt can only fire after the transfer is started,
+  // so active_ is safe to use here without holding the critical section.
+  if (start_now) {
+    const uint8_t kStatus = StartActive();
+    if (kStatus != 0) {
+      Complete(kStatus, false);
+    }
+  }
+  return true;
+}
+
+void I2CAsyncEngine::Complete(uint8_t status, bool from_isr) {
+  I2CTransaction *transaction = active_;
+  while (transaction != nullptr) {
+    if (status == 0 && phase_ == kPhaseWrite && transaction->rx_len > 0) {
+      phase_ = kPhaseRead;
+      status = StartRead(transaction->i2c_addr, transaction->rx_buffer, transaction->rx_len);
+      if (status == 0) {
+        return;
+      }
+    }
+
+    transaction->status = status;
+    transaction->state = (status == 0) ? kI2cTransactionDone : kI2cTransactionError;
+
+    // Outside the interrupt other tasks can Submit in between, the queue has to be locked
+    I2CTransaction *next;
+    if (from_isr) {
+      next = PopNext();
+      active_ = next;
+    } else {
+      I2C_ENTER_CRITICAL();
+      next = PopNext();
+      active_ = next;
+      I2C_EXIT_CRITICAL();
+    }
+
+    // Keep the bus busy before handing the result back to the owner
+    status = (next != nullptr) ? StartActive() : 0;
+    Finish(transaction, from_isr);
+
+    // A transfer that did start completes from its interrupt, one that did not is finished here
+    transaction = (status != 0) ? next : nullptr;
+  }
+}
+
+uint8_t I2CAsyncEngine::StartActive() {
+  I2CTransaction *transaction = active_;
+  transaction->state = kI2cTransactionBusy;
+  if (transaction->tx_len > 0) {
+    phase_ = kPhaseWrite;
+    return StartWrite(transaction->i2c_addr, transaction->tx_buffer, transaction->tx_len, transaction->rx_len == 0);
+  }
+  phase_ = kPhaseRead;
+  return StartRead(transaction->i2c_addr, transaction->rx_buffer, transaction->rx_len);
+}
+
+I2CTransaction *I2CAsyncEngine::PopNext() {
+  if (count_ == 0) {
+    return nullptr;
+  }
+  I2CTransaction *next = queue_[head_];
+  head_ = (head_ + 1) % kI2cAsyncQueueSize;
+  count_--;
+  return next;
+}
+
+void I2CAsyncEngine::Finish(I2CTransaction *transaction, bool from_isr) {
+  if (transaction->callback != nullptr) {
+    transaction->callback(transaction, transaction->context);
+  }
+#if defined(__arm__) && !defined(Arduino)
+  if ((transaction->flags & kI2cAsyncFlagNotifyTask) && transaction->notify_task != nullptr) {
+    if (from_isr) {
+      BaseType_t higher_priority_task_woken = pdFALSE;
+      vTaskNotifyGiveFromISR(transaction->notify_task, &higher_priority_task_woken);
+      portYIELD_FROM_ISR(higher_priority_task_woken);
+    } else {
+      xTaskNotifyGive(transaction->notify_task);
+    }
+  }
+#else
+  (void)from_isr;
+#endif
+}
@@ -0,0 +1,161 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_ASYNC_HPP_
+#define I2C_ASYNC_HPP_
+#include <stdint.h>
+#include <i2c_helper.hpp>
+
+#if defined(__arm__) && !defined(Arduino)
+#include <FreeRTOS.h>
+#include <task.h>
+#define I2C_ASYNC_TASK_HANDLE_T TaskHandle_t
+#define I2C_ENTER_CRITICAL() taskENTER_CRITICAL()
+#define I2C_EXIT_CRITICAL() taskEXIT_CRITICAL()
+#else
+#define I2C_ASYNC_TASK_HANDLE_T void*
+#define I2C_ENTER_CRITICAL()
+#define I2C_EXIT_CRITICAL()
+#endif
+
+inline constexpr uint8_t kI2cAsyncQueueSize = 8;
+
+struct I2CTransaction;
+
+/**
+ * @brief Called when a transaction has finished
+ *
+ * @note Runs in the context that reported the completion,
+ *       which is the I2C interrupt on target, or the task calling Submit
+ *       when the transfer failed to start.
+ */
+typedef void (*I2CCompletionCallback)(I2CTransaction *transaction, void *context);
+
+enum I2CTransactionFlags {
+  kI2cAsyncFlagNone = 0,
+  kI2cAsyncFlagNotifyTask = 1 << 0,  /**< Give a task notification to notify_task on completion */
+};
+
+enum I2CTransactionState {
+  kI2cTransactionIdle = 0,
+  kI2cTransactionQueued,
+  kI2cTransactionBusy,
+  kI2cTransactionDone,
+  kI2cTransactionError,
+};
+
+/**
+ * @brief Descriptor of one asynchronous transaction
+ *
+ * @note The tx bytes are written first, the rx bytes are read after a repeated start.
+ *       Either length may be zero. The descriptor and its buffers are owned by the caller
+ *       and must stay valid until the transaction has completed.
+ */
+struct I2CTransaction {
+  uint8_t i2c_addr;
+  const uint8_t *tx_buffer;
+  uint8_t tx_len;
+  uint8_t *rx_buffer;
+  uint8_t rx_len;
+  uint8_t flags;
+  I2CCompletionCallback callback;
+  void *context;
+  I2C_ASYNC_TASK_HANDLE_T notify_task;
+  volatile uint8_t status;                 /**< 0 on success, otherwise the bus error code */
+  volatile I2CTransactionState state;
+};
+
+/**
+ * @brief Non-blocking transaction engine, one instance per I2C peripheral
+ *
+ * Transactions are queued and executed back-to-back by the interrupt-driven backend.
+ * The completion interrupt of the peripheral has to be forwarded to OnTransferComplete().
+ */
+class I2CAsyncEngine {
+ public:
+  explicit I2CAsyncEngine(I2C_PERIPHERAL_T i2c_peripheral) {
+    this->i2c_peripheral_ = i2c_peripheral;
+  }
+
+  /**
+   * @brief Queue a transaction, it is started immediately when the bus is idle
+   *
+   * @note Call from task context only.
+   *
+   * @return false when the queue is full or the transaction is empty
+   */
+  bool Submit(I2CTransaction *transaction);
+
+  /**
+   * @brief Report that the current bus transfer has finished, call from the transfer-done interrupt
+   *
+   * @param status 0 on success, otherwise the error code reported by the peripheral
+   */
+  void OnTransferComplete(uint8_t status) {
+    Complete(status, true);
+  }
+
+  bool Busy() const {
+    return active_ != nullptr;
+  }
+
+  uint8_t Pending() const {
+    return count_;
+  }
+
+ private:
+  enum TransferPhase {
+    kPhaseWrite,
+    kPhaseRead,
+  };
+
+  I2C_PERIPHERAL_T i2c_peripheral_;
+  I2CTransaction *queue_[kI2cAsyncQueueSize] = {};
+  uint8_t head_ = 0;
+  uint8_t tail_ = 0;
+  volatile uint8_t count_ = 0;
+  I2CTransaction *volatile active_ = nullptr;
+  TransferPhase phase_ = kPhaseWrite;
+
+  /**
+   * @brief Finish the active transaction and start the next one
+   *
+   * @param from_isr false when a transfer failed to start in the task calling Submit
+   */
+  void Complete(uint8_t status, bool from_isr);
+  uint8_t StartActive();
+  I2CTransaction *PopNext();
+  void Finish(I2CTransaction *transaction, bool from_isr);
+
+  // Backend functions, implemented per platform.
+  // Return 0 when the transfer is on the bus, otherwise it failed to start and no interrupt follows.
+  uint8_t StartWrite(uint8_t i2c_addr, const uint8_t *buffer, uint8_t num_of_bytes, bool send_stop);
+  uint8_t StartRead(uint8_t i2c_addr, uint8_t *buffer, uint8_t num_of_bytes);
+};
+
+#endif  // I2C_ASYNC_HPP_
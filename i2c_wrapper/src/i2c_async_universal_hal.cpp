@@ -0,0 +1,42 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include "hal_i2c_host.h"
+#include "i2c_async.hpp"
+
+// The transfer-done interrupt of the SERCOM has to call I2CAsyncEngine::OnTransferComplete()
+// of the engine that owns the peripheral.
+
+uint8_t I2CAsyncEngine::StartWrite(uint8_t i2c_addr, const uint8_t *buffer, uint8_t num_of_bytes, bool send_stop) {
+  return i2c_host_write_non_blocking(i2c_peripheral_, i2c_addr, buffer, num_of_bytes,
+                                     send_stop ? I2C_STOP_BIT : I2C_NO_STOP_BIT);
+}
+
+uint8_t I2CAsyncEngine::StartRead(uint8_t i2c_addr, uint8_t *buffer, uint8_t num_of_bytes) {
+  return i2c_host_read_non_blocking(i2c_peripheral_, i2c_addr, buffer, num_of_bytes);
+}
@@ -0,0 +1,107 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_helper.hpp>
+#include <stdint.h>
+
+namespace {
+
+// backoff_us << attempt, saturated: max_retries allows shifts past the width of the type
+uint32_t RetryBackoffUs(uint32_t backoff_us, uint8_t attempt) {
+  if (attempt >= 32 || backoff_us > (UINT32_MAX >> attempt)) {
+    return backoff_us == 0 ? 0 : UINT32_MAX;
+  }
+  return backoff_us << attempt;
+}
+
+}  // namespace
+
+bool I2CRecoverBus(const I2CBusRecoveryPins *pins) {
+  pins->begin();
+  pins->set_sda(true);
+  pins->set_scl(true);
+  pins->delay_us(pins->half_period_us);
+
+  for (uint8_t pulse = 0; pulse < kI2cRecoveryClockPulses && !pins->read_sda(); pulse++) {
+    pins->set_scl(false);
+    pins->delay_us(pins->half_period_us);
+    pins->set_scl(true);
+    pins->delay_us(pins->half_period_us);
+  }
+  const bool kReleased = pins->read_sda();
+
+  // STOP: SDA low to high while SCL is high
+  pins->set_scl(false);
+  pins->set_sda(false);
+  pins->delay_us(pins->half_period_us);
+  pins->set_scl(true);
+  pins->delay_us(pins->half_period_us);
+  pins->set_sda(true);
+  pins->delay_us(pins->half_period_us);
+  pins->end();
+  return kReleased;
+}
+
+bool I2CDriver::RetryAfterFailure(uint8_t *status, uint32_t start_us, uint8_t *attempt) {
+  if (*status == 0) {
+    consecutive_failures_ = 0;
+    return false;
+  }
+
+  consecutive_failures_++;
+  if (retry_policy_.recovery != nullptr && retry_policy_.recovery_threshold != 0
+      && consecutive_failures_ >= retry_policy_.recovery_threshold) {
+    consecutive_failures_ = 0;
+    if (!I2CRecoverBus(retry_policy_.recovery)) {
+      *status = kI2cStatusBusStuck;
+      return false;
+    }
+    Init();
+  }
+
+  if (*attempt >= retry_policy_.max_retries) {
+    return false;
+  }
+  const uint32_t kBackoff = RetryBackoffUs(retry_policy_.backoff_us, *attempt);
+  if (retry_policy_.deadline_us != 0 && retry_policy_.clock != nullptr) {
+    const uint32_t kElapsed = retry_policy_.clock() - start_us;
+    if (kElapsed >= retry_policy_.deadline_us || kBackoff >= retry_policy_.deadline_us - kElapsed) {
+      *status = kI2cStatusDeadlineExceeded;
+      return false;
+    }
+  }
+  if (kBackoff != 0 && retry_policy_.delay != nullptr) {
+    retry_policy_.delay(kBackoff);
+  }
+  (*attempt)++;
+  return true;
+}
+
+uint32_t I2CDriver::AttemptsStart() const {
+  return retry_policy_.clock != nullptr ? retry_policy_.clock() : 0;
+}
@@ -0,0 +1,69 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_BUS_RECOVERY_HPP_
+#define I2C_BUS_RECOVERY_HPP_
+#include <stdint.h>
+
+/*
+ * Result codes added on top of the ones the bus reports itself,
+ * kept at the top of the range so they can not collide with those.
+ */
+inline constexpr uint8_t kI2cStatusDeadlineExceeded = 0xF0;
+inline constexpr uint8_t kI2cStatusBusStuck = 0xF1;
+inline constexpr uint8_t kI2cStatusShortRead = 0xF2;  // The slave sent fewer bytes than requested
+
+/* The standard recovery sequence: at most 9 clocks shift out a byte and its (N)ACK */
+inline constexpr uint8_t kI2cRecoveryClockPulses = 9;
+
+typedef void (*I2CDelayFunction)(uint32_t delay_us);
+
+/**
+ * @brief Board specific access to the bus lines as plain GPIO
+ *
+ * @note set_scl and set_sda drive the line low on false and release it (open drain) on true.
+ *       The board takes the pins from the I2C peripheral in begin and hands them back in end.
+ */
+struct I2CBusRecoveryPins {
+  void (*begin)(void);
+  void (*set_scl)(bool level);
+  void (*set_sda)(bool level);
+  bool (*read_sda)(void);
+  void (*end)(void);
+  I2CDelayFunction delay_us;
+  uint32_t half_period_us;   /**< Half an SCL period, 5 us gives 100 kHz */
+};
+
+/**
+ * @brief Clock SCL until a slave that holds SDA low lets go, then send a STOP
+ *
+ * @return true when SDA was released
+ */
+bool I2CRecoverBus(const I2CBusRecoveryPins *pins);
+
+#endif  // I2C_BUS_RECOVERY_HPP_
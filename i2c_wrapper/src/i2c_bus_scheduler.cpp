@@ -0,0 +1,203 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_bus_scheduler.hpp>
+
+uint8_t I2CBusScheduler::AddDevice(uint8_t i2c_addr, I2CBusPriority priority, I2CSpeed max_speed,
+                                   const I2CRetryPolicy *retry_policy) {
+  if (num_of_devices_ == kI2cSchedulerMaxDevices) {
+    return kI2cInvalidDevice;
+  }
+  devices_[num_of_devices_].i2c_addr = i2c_addr;
+  devices_[num_of_devices_].priority = priority;
+  devices_[num_of_devices_].max_speed = max_speed;
+  devices_[num_of_devices_].retry_policy = retry_policy;
+  devices_[num_of_devices_].statistics = {};
+  num_of_devices_++;
+
+  I2CSpeed bus_speed = max_speed_;
+  for (uint8_t i = 0; i < num_of_devices_; i++) {
+    if (devices_[i].max_speed < bus_speed) {
+      bus_speed = devices_[i].max_speed;
+    }
+  }
+  if (bus_speed != bus_.GetSpeed()) {
+    bus_.SetSpeed(bus_speed);
+    if (initialised_) {
+      bus_.Init();
+    }
+  }
+  return num_of_devices_ - 1;
+}
+
+bool I2CBusScheduler::Submit(uint8_t device, I2CTransaction *transaction, uint32_t deadline_us) {
+  if (device >= num_of_devices_ || transaction == nullptr) {
+    return false;
+  }
+
+  I2C_ENTER_CRITICAL();
+  if (count_ == kI2cSchedulerQueueSize) {
+    I2C_EXIT_CRITICAL();
+    return false;
+  }
+  transaction->i2c_addr = devices_[device].i2c_addr;
+  transaction->state = kI2cTransactionQueued;
+  slots_[count_].transaction = transaction;
+  slots_[count_].deadline_us = deadline_us;
+  slots_[count_].sequence = next_sequence_++;
+  slots_[count_].device = device;
+  count_++;
+  I2C_EXIT_CRITICAL();
+
+#if defined(__arm__) && !defined(Arduino)
+  if (service_task_ != nullptr) {
+    xTaskNotifyGive(service_task_);
+  }
+#endif
+  return true;
+}
+
+bool I2CBusScheduler::RunNext() {
+  Slot slot;
+  if (!TakeMostUrgent(&slot)) {
+    return false;
+  }
+
+  I2CTransaction *transaction = slot.transaction;
+  transaction->state = kI2cTransactionBusy;
+  const uint32_t kStart = clock_();
+  uint8_t status = Execute(slot.device, transaction);
+  const uint32_t kEnd = clock_();
+
+  const bool kMissed = slot.deadline_us != kI2cNoDeadline
+      && static_cast<int32_t>(kEnd - slot.deadline_us) > 0;
+  Record(&bus_statistics_, status, kEnd - kStart, kMissed);
+  Record(&devices_[slot.device].statistics, status, kEnd - kStart, kMissed);
+
+  transaction->status = status;
+  transaction->state = (status == 0) ? kI2cTransactionDone : kI2cTransactionError;
+  if (transaction->callback != nullptr) {
+    transaction->callback(transaction, transaction->context);
+  }
+#if defined(__arm__) && !defined(Arduino)
+  if ((transaction->flags & kI2cAsyncFlagNotifyTask) && transaction->notify_task != nullptr) {
+    xTaskNotifyGive(transaction->notify_task);
+  }
+#endif
+  return true;
+}
+
+uint16_t I2CBusScheduler::RunAll() {
+  uint16_t num_of_runs = 0;
+  while (RunNext()) {
+    num_of_runs++;
+  }
+  return num_of_runs;
+}
+
+uint16_t I2CBusScheduler::GetUtilisation() const {
+  const uint32_t kWindow = clock_() - window_start_us_;
+  if (kWindow == 0) {
+    return 0;
+  }
+  uint64_t utilisation = (static_cast<uint64_t>(bus_statistics_.busy_time_us) * 10000) / kWindow;
+  return utilisation > 10000 ? 10000 : static_cast<uint16_t>(utilisation);
+}
+
+void I2CBusScheduler::ResetStatistics() {
+  bus_statistics_ = {};
+  for (uint8_t i = 0; i < num_of_devices_; i++) {
+    devices_[i].statistics = {};
+  }
+  window_start_us_ = clock_();
+}
+
+bool I2CBusScheduler::MoreUrgent(const Slot &candidate, const Slot &current) const {
+  const I2CBusPriority kCandidatePriority = devices_[candidate.device].priority;
+  const I2CBusPriority kCurrentPriority = devices_[current.device].priority;
+  if (kCandidatePriority != kCurrentPriority) {
+    return kCandidatePriority < kCurrentPriority;
+  }
+  // Within a priority level: earliest deadline first, transactions without one go last
+  if (candidate.deadline_us != current.deadline_us) {
+    if (current.deadline_us == kI2cNoDeadline) {
+      return true;
+    }
+    if (candidate.deadline_us == kI2cNoDeadline) {
+      return false;
+    }
+    return static_cast<int32_t>(candidate.deadline_us - current.deadline_us) < 0;
+  }
+  return static_cast<int32_t>(candidate.sequence - current.sequence) < 0;
+}
+
+bool I2CBusScheduler::TakeMostUrgent(Slot *slot) {
+  I2C_ENTER_CRITICAL();
+  if (count_ == 0) {
+    I2C_EXIT_CRITICAL();
+    return false;
+  }
+  uint8_t most_urgent = 0;
+  for (uint8_t i = 1; i < count_; i++) {
+    if (MoreUrgent(slots_[i], slots_[most_urgent])) {
+      most_urgent = i;
+    }
+  }
+  *slot = slots_[most_urgent];
+  // Order of the slots is not kept, the sequence number takes care of FIFO order
+  slots_[most_urgent] = slots_[count_ - 1];
+  count_--;
+  I2C_EXIT_CRITICAL();
+  return true;
+}
+
+uint8_t I2CBusScheduler::Execute(uint8_t device, I2CTransaction *transaction) {
+  static const I2CRetryPolicy kSingleAttempt = {};
+  const I2CRetryPolicy *retry_policy = devices_[device].retry_policy;
+  bus_.SetRetryPolicy(retry_policy != nullptr ? *retry_policy : kSingleAttempt);
+  bus_.ChangeAddress(transaction->i2c_addr);
+  if (transaction->tx_len > 0 && transaction->rx_len > 0) {
+    return bus_.WriteRead(transaction->tx_buffer, transaction->tx_len,
+                          transaction->rx_buffer, transaction->rx_len);
+  }
+  if (transaction->tx_len > 0) {
+    return bus_.SendBytes(transaction->tx_buffer, transaction->tx_len);
+  }
+  return bus_.ReadBytes(transaction->rx_buffer, transaction->rx_len);
+}
+
+void I2CBusScheduler::Record(I2CBusStatistics *statistics, uint8_t status, uint32_t duration_us, bool missed) {
+  statistics->transactions++;
+  statistics->busy_time_us += duration_us;
+  if (status != 0) {
+    statistics->errors++;
+  }
+  if (missed) {
+    statistics->deadline_misses++;
+  }
+}
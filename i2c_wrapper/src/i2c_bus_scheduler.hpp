@@ -0,0 +1,183 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_BUS_SCHEDULER_HPP_
+#define I2C_BUS_SCHEDULER_HPP_
+#include <stdint.h>
+#include <i2c_helper.hpp>
+#include <i2c_async.hpp>
+
+inline constexpr uint8_t kI2cSchedulerMaxDevices = 8;
+inline constexpr uint8_t kI2cSchedulerQueueSize = 16;
+inline constexpr uint8_t kI2cInvalidDevice = 0xFF;
+inline constexpr uint32_t kI2cNoDeadline = 0;
+
+enum I2CBusPriority {
+  kI2cPriorityHigh = 0,     /**< e.g. SDP810 ventilation sensor */
+  kI2cPriorityMedium,       /**< e.g. VL6180X compression sensor */
+  kI2cPriorityLow,          /**< e.g. ADS7138 finger position bursts */
+};
+
+struct I2CBusStatistics {
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t deadline_misses;
+  uint32_t busy_time_us;    /**< Time spent executing transactions */
+};
+
+/**
+ * @brief Owns one physical I2C peripheral and runs the transactions of all
+ *        logical devices on it one after another.
+ *
+ * Transactions are picked by device priority first and earliest deadline second,
+ * equal ones are run in submission order. Only the scheduler touches the peripheral,
+ * so devices on the same bus can not interleave their transfers.
+ */
+class I2CBusScheduler {
+ public:
+  /**
+   * @param speed Fastest speed the board allows on this bus (pull-ups, bus capacitance)
+   */
+  I2CBusScheduler(I2C_PERIPHERAL_T i2c_peripheral, I2CSpeed speed, I2CClockFunction clock)
+      : bus_(i2c_peripheral, speed) {
+    this->clock_ = clock;
+    this->max_speed_ = speed;
+    this->window_start_us_ = clock();
+  }
+
+  void Init() {
+    bus_.Init();
+    initialised_ = true;
+  }
+
+  /**
+   * @brief Register a logical device on this bus. The bus runs at the fastest speed
+   *        every device on it can handle, and is restarted when a slower device joins later.
+   *
+   * @param max_speed Fastest speed the device supports
+   * @param retry_policy Retries, deadline and bus recovery for this device, nullptr makes one attempt.
+   *                     Must stay valid for the lifetime of the scheduler.
+   * @return Device handle used with Submit, or kI2cInvalidDevice when the device table is full
+   */
+  uint8_t AddDevice(uint8_t i2c_addr, I2CBusPriority priority, I2CSpeed max_speed = kI2cSpeed_1MHz,
+                    const I2CRetryPolicy *retry_policy = nullptr);
+
+  /**
+   * @brief Speed the bus was negotiated to
+   */
+  I2CSpeed GetBusSpeed() const {
+    return bus_.GetSpeed();
+  }
+
+  /**
+   * @brief Queue a transaction for a device, its i2c_addr is filled in by the scheduler
+   *
+   * @param deadline_us Absolute time the transaction should be finished by, or kI2cNoDeadline
+   * @return false when the device is unknown or the queue is full
+   */
+  bool Submit(uint8_t device, I2CTransaction *transaction, uint32_t deadline_us = kI2cNoDeadline);
+
+  /**
+   * @brief Run the most urgent queued transaction
+   *
+   * @return false when nothing was queued
+   */
+  bool RunNext();
+
+  /**
+   * @brief Run queued transactions until the queue is empty
+   *
+   * @return Number of transactions that were run
+   */
+  uint16_t RunAll();
+
+  /**
+   * @brief Task that runs the scheduler, it gets a task notification on every Submit
+   */
+  void SetServiceTask(I2C_ASYNC_TASK_HANDLE_T service_task) {
+    service_task_ = service_task;
+  }
+
+  uint8_t Pending() const {
+    return count_;
+  }
+
+  I2CBusStatistics GetBusStatistics() const {
+    return bus_statistics_;
+  }
+
+  I2CBusStatistics GetDeviceStatistics(uint8_t device) const {
+    return devices_[device].statistics;
+  }
+
+  /**
+   * @brief Bus busy time since the last ResetStatistics, in 0.01% steps (10000 = 100%)
+   */
+  uint16_t GetUtilisation() const;
+
+  void ResetStatistics();
+
+ private:
+  struct Device {
+    uint8_t i2c_addr;
+    I2CBusPriority priority;
+    I2CSpeed max_speed;
+    const I2CRetryPolicy *retry_policy;
+    I2CBusStatistics statistics;
+  };
+
+  struct Slot {
+    I2CTransaction *transaction;
+    uint32_t deadline_us;
+    uint32_t sequence;
+    uint8_t device;
+  };
+
+  I2CDriver bus_;
+  I2CClockFunction clock_;
+  I2CSpeed max_speed_;
+  bool initialised_ = false;
+  I2C_ASYNC_TASK_HANDLE_T service_task_ = nullptr;
+
+  Device devices_[kI2cSchedulerMaxDevices] = {};
+  uint8_t num_of_devices_ = 0;
+
+  Slot slots_[kI2cSchedulerQueueSize] = {};
+  volatile uint8_t count_ = 0;
+  uint32_t next_sequence_ = 0;
+
+  I2CBusStatistics bus_statistics_ = {};
+  uint32_t window_start_us_;
+
+  bool TakeMostUrgent(Slot *slot);
+  bool MoreUrgent(const Slot &candidate, const Slot &current) const;
+  uint8_t Execute(uint8_t device, I2CTransaction *transaction);
+  static void Record(I2CBusStatistics *statistics, uint8_t status, uint32_t duration_us, bool missed);
+};
+
+#endif  // I2C_BUS_SCHEDULER_HPP_
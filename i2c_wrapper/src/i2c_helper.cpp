@@ -27,6 +27,7 @@
 ***********************************************************************************************/
 
 #include <i2c_helper.hpp>
+#include <i2c_trace.hpp>
 
 constexpr uint8_t GetUpperByte(uint16_t number) {
   return (number >> 8) & 0xff;
@@ -37,86 +38,206 @@ constexpr uint8_t GetLowerByte(uint16_t number) {
 }
 
 void I2CDriver::Init() {
+  speed_ = I2CFastestSpeed(source_clock_hz_, speed_);
   i2c_peripheral_->begin();
+  i2c_peripheral_->setClock(speed_);
 }
 
 void I2CDriver::ChangeAddress(uint8_t new_i2c_address) {
+  if (new_i2c_address != i2c_addr_) {
+    // The shadow copy describes the previous device
+    register_cache_ = nullptr;
+  }
   i2c_addr_ = new_i2c_address;
 }
 
-void I2CDriver::WriteReg(uint16_t reg, uint8_t data) {
+uint8_t I2CDriver::WriteReg(uint16_t reg, uint8_t data) {
+  if (register_cache_ != nullptr && !register_cache_->NeedsWrite(reg, 1, data)) {
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
 
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(kRegUpperByte);
-  i2c_peripheral_->write(kRegLowerByte);
-  i2c_peripheral_->write(data);
-  i2c_peripheral_->endTransmission();
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(kRegUpperByte);
+    i2c_peripheral_->write(kRegLowerByte);
+    i2c_peripheral_->write(data);
+    status = i2c_peripheral_->endTransmission();
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWrite, 3, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 1, data);
+  }
+  return status;
 }
 
-void I2CDriver::WriteReg16(uint16_t reg, uint16_t data) {
+uint8_t I2CDriver::WriteReg16(uint16_t reg, uint16_t data) {
+  if (register_cache_ != nullptr && !register_cache_->NeedsWrite(reg, 2, data)) {
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
 
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(kRegUpperByte);
-  i2c_peripheral_->write(kRegLowerByte);
-
-  uint8_t temp;
-  temp = GetUpperByte(data);
-  i2c_peripheral_->write(temp);
-  temp = GetLowerByte(data);
-  i2c_peripheral_->write(temp);
-  i2c_peripheral_->endTransmission();
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(kRegUpperByte);
+    i2c_peripheral_->write(kRegLowerByte);
+
+    uint8_t temp;
+    temp = GetUpperByte(data);
+    i2c_peripheral_->write(temp);
+    temp = GetLowerByte(data);
+    i2c_peripheral_->write(temp);
+    status = i2c_peripheral_->endTransmission();
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWrite, 4, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 2, data);
+  }
+  return status;
 }
 
-uint8_t I2CDriver::ReadReg(uint16_t reg) {
+uint8_t I2CDriver::ReadReg(uint16_t reg, uint8_t *data) {
+  uint16_t cached;
+  if (register_cache_ != nullptr && register_cache_->Lookup(reg, 1, &cached)) {
+    *data = cached;
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
 
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(GetUpperByte(kRegUpperByte));
-  i2c_peripheral_->write(GetLowerByte(kRegLowerByte));
-  i2c_peripheral_->endTransmission(false);
-  i2c_peripheral_->requestFrom(i2c_addr_, 1);
-  uint8_t data = i2c_peripheral_->read();
-  return data;
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(kRegUpperByte);
+    i2c_peripheral_->write(kRegLowerByte);
+    status = i2c_peripheral_->endTransmission(false);
+    if (status == 0) {
+      if (i2c_peripheral_->requestFrom(i2c_addr_, 1) == 1) {
+        *data = i2c_peripheral_->read();
+      } else {
+        status = kI2cStatusShortRead;
+      }
+    }
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWriteRead, 3, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 1, *data);
+  }
+  return status;
 }
 
-uint16_t I2CDriver::ReadReg16(uint16_t reg) {
-  uint8_t data_low;
-  uint8_t data_high;
-  uint16_t data;
-
+uint8_t I2CDriver::ReadReg16(uint16_t reg, uint16_t *data) {
+  uint16_t cached;
+  if (register_cache_ != nullptr && register_cache_->Lookup(reg, 2, &cached)) {
+    *data = cached;
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
 
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(kRegUpperByte);
-  i2c_peripheral_->write(kRegLowerByte);
-  i2c_peripheral_->endTransmission(false);
-  i2c_peripheral_->requestFrom(i2c_addr_, 2);
-  data_high = i2c_peripheral_->read();
-  data_low = i2c_peripheral_->read();
-  data = (data_high << 8) | data_low;
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(kRegUpperByte);
+    i2c_peripheral_->write(kRegLowerByte);
+    status = i2c_peripheral_->endTransmission(false);
+    if (status == 0) {
+      if (i2c_peripheral_->requestFrom(i2c_addr_, 2) == 2) {
+        uint8_t data_high = i2c_peripheral_->read();
+        uint8_t data_low = i2c_peripheral_->read();
+        *data = (data_high << 8) | data_low;
+      } else {
+        status = kI2cStatusShortRead;
+      }
+    }
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWriteRead, 4, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 2, *data);
+  }
+  return status;
+}
+
+uint8_t I2CDriver::ReadReg(uint16_t reg) {
+  uint8_t data = 0;
+  ReadReg(reg, &data);
   return data;
 }
 
-void I2CDriver::ReadBytes(uint8_t *buffer, uint8_t num_of_bytes) {
-  i2c_peripheral_->requestFrom(i2c_addr_, num_of_bytes, true);
-  i2c_peripheral_->readBytes(buffer, num_of_bytes);
+uint16_t I2CDriver::ReadReg16(uint16_t reg) {
+  uint16_t data = 0;
+  ReadReg16(reg, &data);
+  return data;
 }
 
-uint8_t I2CDriver::SendBytes(const uint8_t *buffer, uint8_t num_of_bytes) {
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(buffer, num_of_bytes);
-  return i2c_peripheral_->endTransmission(true);
+uint8_t I2CDriver::WriteRead(const uint8_t *tx_buffer, uint8_t tx_len, uint8_t *rx_buffer, uint8_t rx_len) {
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(tx_buffer, tx_len);
+    status = i2c_peripheral_->endTransmission(false);
+    if (status == 0) {
+      if (i2c_peripheral_->requestFrom(i2c_addr_, rx_len) == rx_len) {
+        i2c_peripheral_->readBytes(rx_buffer, rx_len);
+      } else {
+        status = kI2cStatusShortRead;
+      }
+    }
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWriteRead, tx_len + rx_len, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
+}
 
+uint8_t I2CDriver::ReadBytes(uint8_t *buffer, uint8_t num_of_bytes) {
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    status = 0;
+    if (i2c_peripheral_->requestFrom(i2c_addr_, num_of_bytes, true) == num_of_bytes) {
+      i2c_peripheral_->readBytes(buffer, num_of_bytes);
+    } else {
+      status = kI2cStatusShortRead;
+    }
+    I2C_TRACE_END(i2c_addr_, kI2cTraceRead, num_of_bytes, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
+}
+
+uint8_t I2CDriver::SendBytes(const uint8_t *buffer, uint8_t num_of_bytes) {
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    i2c_peripheral_->beginTransmission(i2c_addr_);
+    i2c_peripheral_->write(buffer, num_of_bytes);
+    status = i2c_peripheral_->endTransmission(true);
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWrite, num_of_bytes, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
 }
 
 uint8_t I2CDriver::SendByte(const uint8_t data) {
-  i2c_peripheral_->beginTransmission(i2c_addr_);
-  i2c_peripheral_->write(data, 1);
-  return i2c_peripheral_->endTransmission(true);
+  return SendBytes(&data, 1);
 }
\ No newline at end of file
@@ -29,6 +29,9 @@
 #ifndef I2C_HELPER_HPP_
 #define I2C_HELPER_HPP_
 #include <stdint.h>
+#include <i2c_register_table.hpp>
+#include <i2c_register_cache.hpp>
+#include <i2c_bus_recovery.hpp>
 
 #ifdef __arm__
 #include "i2c_helper_platform_specific.hpp"
@@ -38,9 +41,78 @@
 #endif
 
 typedef enum {
-  kI2cSpeed_100KHz = 100000, kI2cSpeed_400KHz = 400000,
+  kI2cSpeed_100KHz = 100000, kI2cSpeed_400KHz = 400000, kI2cSpeed_1MHz = 1000000,
 } I2CSpeed;
 
+inline constexpr uint32_t kI2cDefaultSourceClockHz = 48000000;
+inline constexpr int32_t kI2cInvalidBaud = -1;
+inline constexpr int32_t kI2cMaxBaud = 255;
+
+/**
+ * @brief Maximum SCL rise time allowed in each bus mode (I2C-bus specification, UM10204)
+ */
+constexpr uint32_t I2CRiseTimeNs(I2CSpeed speed) {
+  return speed == kI2cSpeed_1MHz ? 120 : (speed == kI2cSpeed_400KHz ? 300 : 1000);
+}
+
+/**
+ * @brief SERCOM I2C BAUD value for a SCL frequency, rounded up so SCL never ends up faster than asked:
+ *        BAUD = f_source / (2 * f_scl) - 5 - f_source * t_rise / 2
+ *
+ * @return kI2cInvalidBaud when the source clock can not generate this speed
+ */
+constexpr int32_t I2CComputeBaud(uint32_t source_clock_hz, I2CSpeed speed) {
+  const int64_t kDoubleBaudNs = static_cast<int64_t>(source_clock_hz) * 1000000000 / speed
+                                - 10000000000LL
+                                - static_cast<int64_t>(source_clock_hz) * I2CRiseTimeNs(speed);
+  const int64_t kBaud = (kDoubleBaudNs + 1999999999) / 2000000000;
+  return (kDoubleBaudNs < 0 || kBaud > kI2cMaxBaud) ? kI2cInvalidBaud : static_cast<int32_t>(kBaud);
+}
+
+/**
+ * @brief The SCL frequency a BAUD value really gives, including the rise time of the mode
+ */
+constexpr uint32_t I2CBaudToSpeed(uint32_t source_clock_hz, int32_t baud, I2CSpeed mode) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(source_clock_hz) * 1000000000
+                               / ((2 * static_cast<uint64_t>(baud) + 10) * 1000000000
+                                  + static_cast<uint64_t>(source_clock_hz) * I2CRiseTimeNs(mode)));
+}
+
+/**
+ * @brief Fastest speed, not above max_speed, that the source clock can generate
+ */
+constexpr I2CSpeed I2CFastestSpeed(uint32_t source_clock_hz, I2CSpeed max_speed) {
+  if (max_speed == kI2cSpeed_1MHz && I2CComputeBaud(source_clock_hz, kI2cSpeed_1MHz) != kI2cInvalidBaud) {
+    return kI2cSpeed_1MHz;
+  }
+  if (max_speed != kI2cSpeed_100KHz && I2CComputeBaud(source_clock_hz, kI2cSpeed_400KHz) != kI2cInvalidBaud) {
+    return kI2cSpeed_400KHz;
+  }
+  return kI2cSpeed_100KHz;
+}
+
+/**
+ * @brief Monotonic microsecond clock, used for deadlines, statistics and tracing
+ */
+typedef uint32_t (*I2CClockFunction)(void);
+
+/**
+ * @brief What to do when a transaction fails
+ *
+ * @note The zero initialised policy makes one attempt and never recovers the bus.
+ *       The deadline covers all attempts of one transaction and is checked between attempts,
+ *       a single blocking attempt is only bounded by the timeout of the bus itself.
+ */
+struct I2CRetryPolicy {
+  uint32_t deadline_us;           /**< 0: no deadline, needs clock */
+  uint8_t max_retries;            /**< Attempts after the first one */
+  uint32_t backoff_us;            /**< Wait before the first retry, doubled every next retry, needs delay */
+  uint8_t recovery_threshold;     /**< Consecutive failures before bus recovery, 0: never */
+  I2CClockFunction clock;
+  I2CDelayFunction delay;
+  const I2CBusRecoveryPins *recovery;
+};
+
 
 class I2CDriver {
  public:
@@ -55,24 +127,112 @@ class I2CDriver {
     this->speed_ = speed;
   }
 
+  /**
+   * @brief Start the peripheral at the fastest speed, not above the configured one,
+   *        that the source clock can generate
+   */
   void Init();
-  void WriteReg(uint16_t reg, uint8_t data);
-  void WriteReg16(uint16_t reg, uint16_t data);
+
+  /**
+   * @brief Frequency of the clock feeding the peripheral, takes effect on the next Init
+   */
+  void SetSourceClock(uint32_t source_clock_hz) {
+    source_clock_hz_ = source_clock_hz;
+  }
+
+  /**
+   * @brief Bus speed, takes effect on the next Init
+   */
+  void SetSpeed(I2CSpeed speed) {
+    speed_ = speed;
+  }
+
+  I2CSpeed GetSpeed() const {
+    return speed_;
+  }
+
+  /**
+   * @brief Retry, deadline and bus recovery behaviour for every following transaction
+   *
+   * @note The count of consecutive failures belongs to this driver, not the bus, and survives a policy change
+   */
+  void SetRetryPolicy(const I2CRetryPolicy &retry_policy) {
+    retry_policy_ = retry_policy;
+  }
+
+  /**
+   * @return 0 on success, otherwise the error code of the last attempt
+   */
+  uint8_t WriteReg(uint16_t reg, uint8_t data);
+  uint8_t WriteReg16(uint16_t reg, uint16_t data);
+
+  /**
+   * @brief Read a register, data is left untouched when the read fails
+   *
+   * @return 0 on success, otherwise the error code of the last attempt
+   */
+  uint8_t ReadReg(uint16_t reg, uint8_t *data);
+  uint8_t ReadReg16(uint16_t reg, uint16_t *data);
+
+  /**
+   * @brief Read a register, failures read as 0
+   */
   uint8_t ReadReg(uint16_t reg);
   uint16_t ReadReg16(uint16_t reg);
 
-  void ReadBytes(uint8_t *buffer, uint8_t num_of_bytes);
+  /**
+   * @brief Write tx_buffer and read rx_len bytes back in one transaction,
+   *        using a repeated start instead of a STOP between both halves.
+   *
+   * @return 0 on success, otherwise the error code of the failing half
+   */
+  uint8_t WriteRead(const uint8_t *tx_buffer, uint8_t tx_len, uint8_t *rx_buffer, uint8_t rx_len);
+
+  /**
+   * @brief Write a whole register table in one pass. With auto_increment set,
+   *        entries at consecutive addresses are merged into one burst write.
+   *
+   * @return 0 on success, otherwise the error code of the first failing write
+   */
+  uint8_t WriteRegTable(const I2CRegisterWrite *table, size_t num_of_entries, bool auto_increment = true);
+
+  uint8_t ReadBytes(uint8_t *buffer, uint8_t num_of_bytes);
   uint8_t SendBytes(const uint8_t *buffer, uint8_t num_of_bytes);
   uint8_t SendByte(const uint8_t data);
+  /**
+   * @brief Point the driver at another device, an attached register cache is detached
+   *        when the address changes
+   */
   void ChangeAddress(uint8_t new_i2c_address);
 
+  /**
+   * @brief Serve cacheable registers of this device from a shadow copy in RAM,
+   *        and skip writes that would not change them. Pass nullptr to detach.
+   *        Attach after ChangeAddress, which drops the cache of the previous device.
+   */
+  void AttachRegisterCache(I2CRegisterCache *register_cache) {
+    register_cache_ = register_cache;
+  }
+
   bool SensorAvailable();
  private:
 
   uint8_t i2c_addr_;
   I2C_PERIPHERAL_T i2c_peripheral_;
   I2CSpeed speed_;
+  uint32_t source_clock_hz_ = kI2cDefaultSourceClockHz;
+  I2CRegisterCache *register_cache_ = nullptr;
+  I2CRetryPolicy retry_policy_ = {};
+  uint8_t consecutive_failures_ = 0;
+
+  uint32_t AttemptsStart() const;
 
+  /**
+   * @brief Book keeping after an attempt: counts failures, recovers the bus and waits out the backoff
+   *
+   * @return true when the transaction should be attempted again
+   */
+  bool RetryAfterFailure(uint8_t *status, uint32_t start_us, uint8_t *attempt);
 };
 
 #endif  // I2C_HELPER_HPP_
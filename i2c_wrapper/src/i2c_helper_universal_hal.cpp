@@ -28,6 +28,7 @@
 
 #include "hal_i2c_host.h"
 #include "i2c_helper.hpp"
+#include "i2c_trace.hpp"
 
 constexpr uint8_t GetUpperByte(uint16_t number) {
   return (number >> 8) & 0xff;
@@ -38,58 +39,143 @@ constexpr uint8_t GetLowerByte(uint16_t number) {
 }
 
 void I2CDriver::Init() {
-  i2c_host_init(i2c_peripheral_, I2C_CLK_SOURCE_USE_DEFAULT, 48000000, speed_, I2C_EXTRA_OPT_NONE);
+  speed_ = I2CFastestSpeed(source_clock_hz_, speed_);
+  i2c_host_init(i2c_peripheral_, I2C_CLK_SOURCE_USE_DEFAULT, source_clock_hz_, speed_, I2C_EXTRA_OPT_NONE);
 }
 
 void I2CDriver::ChangeAddress(uint8_t new_i2c_address) {
+  if (new_i2c_address != i2c_addr_) {
+    // The shadow copy describes the previous device
+    register_cache_ = nullptr;
+  }
   i2c_addr_ = new_i2c_address;
 }
 
-void I2CDriver::WriteReg(uint16_t reg, uint8_t data) {
+uint8_t I2CDriver::WriteReg(uint16_t reg, uint8_t data) {
+  if (register_cache_ != nullptr && !register_cache_->NeedsWrite(reg, 1, data)) {
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
   const uint8_t WriteBuffer[3] = {kRegUpperByte, kRegLowerByte, data};
 
-  i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, WriteBuffer, sizeof(WriteBuffer), I2C_STOP_BIT);
+  uint8_t status = SendBytes(WriteBuffer, sizeof(WriteBuffer));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 1, data);
+  }
+  return status;
 }
 
-void I2CDriver::WriteReg16(uint16_t reg, uint16_t data) {
+uint8_t I2CDriver::WriteReg16(uint16_t reg, uint16_t data) {
+  if (register_cache_ != nullptr && !register_cache_->NeedsWrite(reg, 2, data)) {
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
   const uint8_t WriteBuffer[4] = {kRegUpperByte, kRegLowerByte, GetUpperByte(data), GetLowerByte(data)};
 
-  i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, WriteBuffer, sizeof(WriteBuffer), I2C_STOP_BIT);
+  uint8_t status = SendBytes(WriteBuffer, sizeof(WriteBuffer));
+  if (register_cache_ != nullptr && status == 0) {
+    register_cache_->Store(reg, 2, data);
+  }
+  return status;
 }
 
-uint8_t I2CDriver::ReadReg(uint16_t reg) {
+uint8_t I2CDriver::ReadReg(uint16_t reg, uint8_t *data) {
+  uint16_t cached;
+  if (register_cache_ != nullptr && register_cache_->Lookup(reg, 1, &cached)) {
+    *data = cached;
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
   const uint8_t WriteBuffer[2] = {kRegUpperByte, kRegLowerByte};
-  uint8_t data;
-
-  i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, WriteBuffer, sizeof(WriteBuffer), I2C_STOP_BIT);
-  i2c_host_read_blocking(i2c_peripheral_, i2c_addr_, &data, sizeof(data));
-  return data;
+  uint8_t ReadBuffer;
+
+  uint8_t status = WriteRead(WriteBuffer, sizeof(WriteBuffer), &ReadBuffer, sizeof(ReadBuffer));
+  if (status != 0) {
+    return status;
+  }
+  *data = ReadBuffer;
+  if (register_cache_ != nullptr) {
+    register_cache_->Store(reg, 1, ReadBuffer);
+  }
+  return 0;
 }
 
-uint16_t I2CDriver::ReadReg16(uint16_t reg) {
+uint8_t I2CDriver::ReadReg16(uint16_t reg, uint16_t *data) {
+  uint16_t cached;
+  if (register_cache_ != nullptr && register_cache_->Lookup(reg, 2, &cached)) {
+    *data = cached;
+    return 0;
+  }
   const uint8_t kRegLowerByte = GetLowerByte(reg);
   const uint8_t kRegUpperByte = GetUpperByte(reg);
   const uint8_t WriteBuffer[2] = {kRegUpperByte, kRegLowerByte};
   uint8_t ReadBuffer[2];
-  uint16_t data;
-  i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, WriteBuffer, sizeof(WriteBuffer), I2C_STOP_BIT);
-  i2c_host_read_blocking(i2c_peripheral_, i2c_addr_, ReadBuffer, sizeof(ReadBuffer));
-  data = (ReadBuffer[0] << 8) | ReadBuffer[1];
+
+  uint8_t status = WriteRead(WriteBuffer, sizeof(WriteBuffer), ReadBuffer, sizeof(ReadBuffer));
+  if (status != 0) {
+    return status;
+  }
+  *data = (ReadBuffer[0] << 8) | ReadBuffer[1];
+  if (register_cache_ != nullptr) {
+    register_cache_->Store(reg, 2, *data);
+  }
+  return 0;
+}
+
+uint8_t I2CDriver::ReadReg(uint16_t reg) {
+  uint8_t data = 0;
+  ReadReg(reg, &data);
   return data;
 }
 
-void I2CDriver::ReadBytes(uint8_t *buffer, uint8_t num_of_bytes) {
-  i2c_host_read_blocking(i2c_peripheral_, i2c_addr_, buffer, num_of_bytes);
+uint16_t I2CDriver::ReadReg16(uint16_t reg) {
+  uint16_t data = 0;
+  ReadReg16(reg, &data);
+  return data;
+}
+
+uint8_t I2CDriver::WriteRead(const uint8_t *tx_buffer, uint8_t tx_len, uint8_t *rx_buffer, uint8_t rx_len) {
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    // No STOP after the write phase, so the read phase starts with a repeated start
+    // and no other master can claim the bus in between.
+    status = i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, tx_buffer, tx_len, I2C_NO_STOP_BIT);
+    if (status == 0) {
+      status = i2c_host_read_blocking(i2c_peripheral_, i2c_addr_, rx_buffer, rx_len);
+    }
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWriteRead, tx_len + rx_len, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
+}
+
+uint8_t I2CDriver::ReadBytes(uint8_t *buffer, uint8_t num_of_bytes) {
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    status = i2c_host_read_blocking(i2c_peripheral_, i2c_addr_, buffer, num_of_bytes);
+    I2C_TRACE_END(i2c_addr_, kI2cTraceRead, num_of_bytes, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
 }
 
 uint8_t I2CDriver::SendBytes(const uint8_t *buffer, uint8_t num_of_bytes) {
-  return i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, buffer, num_of_bytes, I2C_STOP_BIT);
+  const uint32_t kStart = AttemptsStart();
+  uint8_t attempt = 0;
+  uint8_t status;
+  do {
+    I2C_TRACE_BEGIN();
+    status = i2c_host_write_blocking(i2c_peripheral_, i2c_addr_, buffer, num_of_bytes, I2C_STOP_BIT);
+    I2C_TRACE_END(i2c_addr_, kI2cTraceWrite, num_of_bytes, status);
+  } while (RetryAfterFailure(&status, kStart, &attempt));
+  return status;
 }
 
 uint8_t I2CDriver::SendByte(const uint8_t data) {
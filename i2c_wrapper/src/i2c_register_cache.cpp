@@ -0,0 +1,106 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_register_cache.hpp>
+
+bool I2CRegisterCache::IsCacheable(uint16_t reg) const {
+  for (size_t i = 0; i < num_of_ranges_; i++) {
+    if (reg >= cacheable_[i].first && reg <= cacheable_[i].last) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool I2CRegisterCache::Lookup(uint16_t reg, uint8_t width, uint16_t *value) {
+  if (!IsCacheable(reg)) {
+    return false;
+  }
+  Entry *entry = Find(reg);
+  if (entry == nullptr || entry->width != width) {
+    statistics_.misses++;
+    return false;
+  }
+  statistics_.hits++;
+  *value = entry->value;
+  return true;
+}
+
+bool I2CRegisterCache::NeedsWrite(uint16_t reg, uint8_t width, uint16_t value) {
+  if (!IsCacheable(reg)) {
+    return true;
+  }
+  Entry *entry = Find(reg);
+  if (entry != nullptr && entry->width == width && entry->value == value) {
+    statistics_.elided_writes++;
+    return false;
+  }
+  return true;
+}
+
+void I2CRegisterCache::Store(uint16_t reg, uint8_t width, uint16_t value) {
+  if (!IsCacheable(reg)) {
+    return;
+  }
+  // A 16-bit register overlaps the 8-bit register after it, never keep both
+  Entry *overlapping = Find(reg - 1);
+  if (overlapping != nullptr && overlapping->width == 2) {
+    Remove(overlapping);
+  }
+  if (width == 2 && (overlapping = Find(reg + 1)) != nullptr) {
+    Remove(overlapping);
+  }
+
+  Entry *entry = Find(reg);
+  if (entry == nullptr) {
+    if (num_of_entries_ == kI2cRegisterCacheSize) {
+      return;  // Full, the register just keeps going to the bus
+    }
+    entry = &entries_[num_of_entries_++];
+    entry->reg = reg;
+  }
+  entry->width = width;
+  entry->value = value;
+}
+
+void I2CRegisterCache::Invalidate() {
+  num_of_entries_ = 0;
+}
+
+void I2CRegisterCache::Remove(Entry *entry) {
+  *entry = entries_[--num_of_entries_];
+}
+
+I2CRegisterCache::Entry *I2CRegisterCache::Find(uint16_t reg) {
+  for (uint8_t i = 0; i < num_of_entries_; i++) {
+    if (entries_[i].reg == reg) {
+      return &entries_[i];
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,107 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_REGISTER_CACHE_HPP_
+#define I2C_REGISTER_CACHE_HPP_
+#include <stddef.h>
+#include <stdint.h>
+
+inline constexpr uint8_t kI2cRegisterCacheSize = 32;
+
+/**
+ * @brief Inclusive range of registers whose value only changes when the host writes it
+ *        (configuration, identification). Result, status and interrupt registers must
+ *        never be part of a cacheable range.
+ */
+struct I2CRegisterRange {
+  uint16_t first;
+  uint16_t last;
+};
+
+struct I2CRegisterCacheStatistics {
+  uint32_t hits;            /**< Reads served from RAM */
+  uint32_t misses;          /**< Reads of cacheable registers that went to the bus */
+  uint32_t elided_writes;   /**< Writes skipped because the register already holds the value */
+};
+
+/**
+ * @brief Shadow copy of the cacheable registers of one device
+ *
+ * @note Call Invalidate() whenever the device may have lost its configuration,
+ *       e.g. after a power-cycle or reset.
+ */
+class I2CRegisterCache {
+ public:
+  I2CRegisterCache(const I2CRegisterRange *cacheable, size_t num_of_ranges) {
+    this->cacheable_ = cacheable;
+    this->num_of_ranges_ = num_of_ranges;
+  }
+
+  bool IsCacheable(uint16_t reg) const;
+
+  /**
+   * @brief Look up a cacheable register, counts a hit or a miss
+   *
+   * @return true and the shadow value when it is known
+   */
+  bool Lookup(uint16_t reg, uint8_t width, uint16_t *value);
+
+  /**
+   * @brief Check if a write has to go to the bus, counts elided writes
+   */
+  bool NeedsWrite(uint16_t reg, uint8_t width, uint16_t value);
+
+  /**
+   * @brief Remember the value of a register after a successful transfer
+   */
+  void Store(uint16_t reg, uint8_t width, uint16_t value);
+
+  void Invalidate();
+
+  I2CRegisterCacheStatistics GetStatistics() const {
+    return statistics_;
+  }
+
+ private:
+  struct Entry {
+    uint16_t reg;
+    uint16_t value;
+    uint8_t width;
+  };
+
+  const I2CRegisterRange *cacheable_;
+  size_t num_of_ranges_;
+  Entry entries_[kI2cRegisterCacheSize] = {};
+  uint8_t num_of_entries_ = 0;
+  I2CRegisterCacheStatistics statistics_ = {};
+
+  Entry *Find(uint16_t reg);
+  void Remove(Entry *entry);
+};
+
+#endif  // I2C_REGISTER_CACHE_HPP_
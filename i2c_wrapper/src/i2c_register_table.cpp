@@ -0,0 +1,71 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_helper.hpp>
+
+uint8_t I2CDriver::WriteRegTable(const I2CRegisterWrite *table, size_t num_of_entries, bool auto_increment) {
+  uint8_t burst[kI2cMaxBurstBytes];
+  size_t index = 0;
+
+  while (index < num_of_entries) {
+    if (register_cache_ != nullptr && !register_cache_->NeedsWrite(table[index].reg, table[index].width, table[index].value)) {
+      index++;
+      continue;
+    }
+
+    const size_t kFirstEntry = index;
+    uint16_t next_reg = table[index].reg;
+    uint8_t length = 0;
+    burst[length++] = (next_reg >> 8) & 0xFF;
+    burst[length++] = next_reg & 0xFF;
+
+    // Merge entries as long as they continue where the previous one ended,
+    // the device auto-increments the register address during the burst.
+    do {
+      const I2CRegisterWrite &entry = table[index];
+      if (entry.width == 2) {
+        burst[length++] = (entry.value >> 8) & 0xFF;
+      }
+      burst[length++] = entry.value & 0xFF;
+      next_reg = entry.reg + entry.width;
+      index++;
+    } while (auto_increment && index < num_of_entries && table[index].reg == next_reg
+        && length + table[index].width <= kI2cMaxBurstBytes);
+
+    uint8_t status = SendBytes(burst, length);
+    if (status != 0) {
+      return status;
+    }
+    if (register_cache_ != nullptr) {
+      for (size_t i = kFirstEntry; i < index; i++) {
+        register_cache_->Store(table[i].reg, table[i].width, table[i].value);
+      }
+    }
+  }
+  return 0;
+}
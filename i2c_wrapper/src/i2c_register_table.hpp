@@ -0,0 +1,53 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_REGISTER_TABLE_HPP_
+#define I2C_REGISTER_TABLE_HPP_
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest single write transaction built from a table, including the 2 register address bytes
+inline constexpr uint8_t kI2cMaxBurstBytes = 32;
+
+/**
+ * @brief One entry of a register initialisation table
+ *
+ * @note Written big-endian with a 16-bit register address, the same as WriteReg and WriteReg16.
+ */
+struct I2CRegisterWrite {
+  uint16_t reg;
+  uint16_t value;
+  uint8_t width;   /**< 1 for an 8-bit register, 2 for a 16-bit register */
+};
+
+template<typename T, size_t N>
+constexpr size_t RegTableSize(const T (&)[N]) {
+  return N;
+}
+
+#endif  // I2C_REGISTER_TABLE_HPP_
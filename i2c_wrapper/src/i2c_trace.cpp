@@ -0,0 +1,222 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <i2c_trace.hpp>
+
+#ifdef I2C_TRACE_ENABLE
+#ifndef __arm__
+#include <stdio.h>
+#endif
+
+namespace {
+
+struct TraceSlot {
+  std::atomic<uint32_t> sequence;
+  I2CTraceRecord record;
+};
+
+struct DeviceSlot {
+  std::atomic<uint8_t> i2c_addr;
+  I2CTraceDeviceStatistics statistics;
+};
+
+constexpr uint32_t kIndexMask = kI2cTraceBufferSize - 1;
+constexpr uint8_t kFreeDeviceSlot = 0xFF;  // Not a valid 7-bit address
+
+I2CClockFunction trace_clock = nullptr;
+TraceSlot trace_ring[kI2cTraceBufferSize];
+std::atomic<uint32_t> trace_head{0};
+uint32_t trace_tail = 0;
+std::atomic<uint32_t> trace_dropped{0};
+DeviceSlot device_slots[kI2cTraceMaxDevices];
+
+struct TraceInitializer {
+  TraceInitializer() {
+    I2CTracer::Reset();
+  }
+} trace_initializer;
+
+uint8_t LatencyBucket(uint32_t duration_us) {
+  uint8_t bucket = 0;
+  uint32_t upper_bound = 32;
+  while (duration_us >= upper_bound && bucket < kI2cTraceHistogramBuckets - 1) {
+    upper_bound <<= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+I2CTraceDeviceStatistics *FindOrClaimDevice(uint8_t i2c_addr) {
+  for (DeviceSlot &slot : device_slots) {
+    uint8_t owner = slot.i2c_addr.load(std::memory_order_acquire);
+    if (owner == i2c_addr) {
+      return &slot.statistics;
+    }
+    if (owner == kFreeDeviceSlot) {
+      uint8_t expected = kFreeDeviceSlot;
+      if (slot.i2c_addr.compare_exchange_strong(expected, i2c_addr, std::memory_order_acq_rel)
+          || expected == i2c_addr) {
+        return &slot.statistics;
+      }
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+void I2CTracer::SetClock(I2CClockFunction clock) {
+  trace_clock = clock;
+}
+
+uint32_t I2CTracer::Now() {
+  return trace_clock != nullptr ? trace_clock() : 0;
+}
+
+void I2CTracer::Record(uint8_t i2c_addr, I2CTraceDirection direction, uint8_t num_of_bytes,
+                       uint8_t status, uint32_t start_us) {
+  const uint32_t kDuration = Now() - start_us;
+
+  I2CTraceDeviceStatistics *statistics = FindOrClaimDevice(i2c_addr);
+  if (statistics != nullptr) {
+    statistics->i2c_addr = i2c_addr;
+    statistics->transactions++;
+    if (status != 0) {
+      statistics->errors++;
+    }
+    statistics->status_counts[status < kI2cTraceStatusCodes ? status : kI2cTraceStatusCodes - 1]++;
+    statistics->latency_histogram[LatencyBucket(kDuration)]++;
+  }
+
+  // Claim a slot: its sequence equals the head position when it is free
+  uint32_t position = trace_head.load(std::memory_order_relaxed);
+  TraceSlot *slot;
+  for (;;) {
+    slot = &trace_ring[position & kIndexMask];
+    const int32_t kDifference = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - position);
+    if (kDifference == 0) {
+      if (trace_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (kDifference < 0) {
+      trace_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = trace_head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->record.timestamp_us = start_us;
+  slot->record.duration_us = kDuration;
+  slot->record.i2c_addr = i2c_addr;
+  slot->record.direction = direction;
+  slot->record.num_of_bytes = num_of_bytes;
+  slot->record.status = status;
+  slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+size_t I2CTracer::Drain(I2CTraceRecord *dest, size_t max_records) {
+  size_t num_of_records = 0;
+  while (num_of_records < max_records) {
+    TraceSlot &slot = trace_ring[trace_tail & kIndexMask];
+    if (slot.sequence.load(std::memory_order_acquire) != trace_tail + 1) {
+      break;  // Not yet published
+    }
+    dest[num_of_records++] = slot.record;
+    slot.sequence.store(trace_tail + kI2cTraceBufferSize, std::memory_order_release);
+    trace_tail++;
+  }
+  return num_of_records;
+}
+
+const I2CTraceDeviceStatistics *I2CTracer::GetDeviceStatistics(uint8_t i2c_addr) {
+  for (DeviceSlot &slot : device_slots) {
+    if (slot.i2c_addr.load(std::memory_order_acquire) == i2c_addr) {
+      return &slot.statistics;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t I2CTracer::Dropped() {
+  return trace_dropped.load(std::memory_order_relaxed);
+}
+
+void I2CTracer::Reset() {
+  for (uint32_t i = 0; i < kI2cTraceBufferSize; i++) {
+    trace_ring[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  trace_head.store(0, std::memory_order_relaxed);
+  trace_tail = 0;
+  trace_dropped.store(0, std::memory_order_relaxed);
+  for (DeviceSlot &slot : device_slots) {
+    slot.statistics = {};
+    slot.i2c_addr.store(kFreeDeviceSlot, std::memory_order_release);
+  }
+}
+
+#ifndef __arm__
+bool I2CTracer::DumpToFile(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+
+  static const char *const kDirectionNames[] = {"write", "read", "write_read"};
+  fprintf(file, "timestamp_us,duration_us,address,direction,bytes,status\n");
+  I2CTraceRecord records[16];
+  size_t num_of_records;
+  while ((num_of_records = Drain(records, 16)) > 0) {
+    for (size_t i = 0; i < num_of_records; i++) {
+      fprintf(file, "%u,%u,0x%02X,%s,%u,%u\n", records[i].timestamp_us, records[i].duration_us,
+              records[i].i2c_addr, kDirectionNames[records[i].direction],
+              records[i].num_of_bytes, records[i].status);
+    }
+  }
+
+  fprintf(file, "\n# dropped %u\n", Dropped());
+  for (DeviceSlot &slot : device_slots) {
+    if (slot.i2c_addr.load(std::memory_order_acquire) == kFreeDeviceSlot) {
+      continue;
+    }
+    const I2CTraceDeviceStatistics &statistics = slot.statistics;
+    fprintf(file, "# device 0x%02X transactions %u errors %u\n# status",
+            statistics.i2c_addr, statistics.transactions, statistics.errors);
+    for (uint32_t count : statistics.status_counts) {
+      fprintf(file, " %u", count);
+    }
+    fprintf(file, "\n# latency_histogram");
+    for (uint32_t count : statistics.latency_histogram) {
+      fprintf(file, " %u", count);
+    }
+    fprintf(file, "\n");
+  }
+  return fclose(file) == 0;
+}
+#endif  // __arm__
+#endif  // I2C_TRACE_ENABLE
@@ -0,0 +1,131 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_TRACE_HPP_
+#define I2C_TRACE_HPP_
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bus transaction tracing, only compiled in when I2C_TRACE_ENABLE is defined.
+ * Without it the I2C_TRACE_* macros expand to nothing and the driver does not
+ * pay a single instruction for it.
+ */
+#ifdef I2C_TRACE_ENABLE
+#include <atomic>
+#include <i2c_helper.hpp>
+
+inline constexpr uint16_t kI2cTraceBufferSize = 128;   // Must be a power of two
+inline constexpr uint8_t kI2cTraceMaxDevices = 8;
+inline constexpr uint8_t kI2cTraceHistogramBuckets = 12;
+inline constexpr uint8_t kI2cTraceStatusCodes = 8;     // Result codes above this share the last counter
+
+enum I2CTraceDirection {
+  kI2cTraceWrite = 0,
+  kI2cTraceRead,
+  kI2cTraceWriteRead,
+};
+
+struct I2CTraceRecord {
+  uint32_t timestamp_us;   /**< Start of the transaction */
+  uint32_t duration_us;
+  uint8_t i2c_addr;
+  uint8_t direction;       /**< I2CTraceDirection */
+  uint8_t num_of_bytes;    /**< Bytes written plus bytes read */
+  uint8_t status;          /**< Result code as returned by the bus, 0 is success */
+};
+
+/**
+ * @brief Per device counters
+ *
+ * @note Latency bucket 0 holds everything below 32 us, every next bucket doubles
+ *       the upper bound, the last bucket holds everything slower.
+ *       NACKs are counted under the result code the bus reports for them.
+ *       Counters are not atomic, transactions on one device are expected to be serialised by its bus.
+ */
+struct I2CTraceDeviceStatistics {
+  uint8_t i2c_addr;
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t status_counts[kI2cTraceStatusCodes];
+  uint32_t latency_histogram[kI2cTraceHistogramBuckets];
+};
+
+/**
+ * @brief Global trace of all I2CDriver transactions
+ *
+ * Records go into a bounded lock-free multi-producer/single-consumer ring, so any
+ * task can record while one consumer drains. When the ring is full new records are
+ * dropped and counted instead of blocking the bus.
+ *
+ * @note On ARMv6-M (Cortex-M0+) the compare-exchange comes from the toolchain's atomic library.
+ */
+class I2CTracer {
+ public:
+  static void SetClock(I2CClockFunction clock);
+  static uint32_t Now();
+
+  static void Record(uint8_t i2c_addr, I2CTraceDirection direction, uint8_t num_of_bytes,
+                     uint8_t status, uint32_t start_us);
+
+  /**
+   * @brief Move the oldest records out of the ring, single consumer only
+   *
+   * @return Number of records copied into dest
+   */
+  static size_t Drain(I2CTraceRecord *dest, size_t max_records);
+
+  /**
+   * @return Statistics of the device, or nullptr when it was never seen
+   */
+  static const I2CTraceDeviceStatistics *GetDeviceStatistics(uint8_t i2c_addr);
+
+  static uint32_t Dropped();
+
+  /**
+   * @brief Clear records and statistics, the bus must be idle
+   */
+  static void Reset();
+
+#ifndef __arm__
+  /**
+   * @brief Drain the trace to a CSV file, followed by the device statistics
+   */
+  static bool DumpToFile(const char *path);
+#endif
+};
+
+#define I2C_TRACE_BEGIN() const uint32_t i2c_trace_start_us = I2CTracer::Now()
+#define I2C_TRACE_END(addr, direction, num_of_bytes, status) \
+  I2CTracer::Record((addr), (direction), (num_of_bytes), (status), i2c_trace_start_us)
+#else
+#define I2C_TRACE_BEGIN()
+#define I2C_TRACE_END(addr, direction, num_of_bytes, status)
+#endif  // I2C_TRACE_ENABLE
+
+#endif  // I2C_TRACE_HPP_
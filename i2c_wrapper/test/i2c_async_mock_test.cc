@@ -0,0 +1,205 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <i2c_async_simulator.hpp>
+
+using ::testing::Return;
+using ::testing::InSequence;
+using ::testing::Invoke;
+using ::testing::_;
+
+namespace {
+
+const uint8_t kI2CAddress = 0x29;
+const uint8_t kRegister[2] = {0x00, 0x62};
+const uint8_t kReadBackBytes[2] = {0xAF, 0x05};
+
+struct CompletionLog {
+  I2CTransaction *order[4];
+  uint8_t num_of_completions;
+};
+
+void RecordCompletion(I2CTransaction *transaction, void *context) {
+  CompletionLog *log = static_cast<CompletionLog *>(context);
+  log->order[log->num_of_completions++] = transaction;
+}
+
+size_t CopyReadBackBytes(uint8_t *buffer, size_t length) {
+  memcpy(buffer, kReadBackBytes, length);
+  return length;
+}
+
+I2CTransaction MakeTransaction(const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len,
+                               CompletionLog *log) {
+  I2CTransaction transaction{};
+  transaction.i2c_addr = kI2CAddress;
+  transaction.tx_buffer = tx;
+  transaction.tx_len = tx_len;
+  transaction.rx_buffer = rx;
+  transaction.rx_len = rx_len;
+  transaction.callback = RecordCompletion;
+  transaction.context = log;
+  return transaction;
+}
+
+}  // namespace
+
+TEST(I2CAsyncTest, writeReadRunsBothPhasesBeforeCompleting) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CAsyncEngine engine(&i2c_peripheral_mock);
+  I2CAsyncSimulator simulator(&engine);
+  CompletionLog log{};
+  uint8_t rx[2] = {};
+  I2CTransaction transaction = MakeTransaction(kRegister, sizeof(kRegister), rx, sizeof(rx), &log);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+    EXPECT_CALL(i2c_peripheral_mock, write(kRegister, sizeof(kRegister)));
+    EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).WillOnce(Return(0));
+    EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, sizeof(rx)));
+    EXPECT_CALL(i2c_peripheral_mock, readBytes(rx, sizeof(rx))).WillOnce(Invoke(CopyReadBackBytes));
+  }
+  ASSERT_TRUE(engine.Submit(&transaction));
+  EXPECT_EQ(transaction.state, kI2cTransactionBusy);
+  simulator.TransferComplete();  // write phase
+  EXPECT_EQ(log.num_of_completions, 0);
+  simulator.TransferComplete();  // read phase
+  EXPECT_EQ(log.num_of_completions, 1);
+  EXPECT_EQ(transaction.state, kI2cTransactionDone);
+  EXPECT_EQ(rx[0], kReadBackBytes[0]);
+  EXPECT_EQ(rx[1], kReadBackBytes[1]);
+  EXPECT_FALSE(engine.Busy());
+}
+
+TEST(I2CAsyncTest, queuedTransactionsCompleteInOrder) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CAsyncEngine engine(&i2c_peripheral_mock);
+  I2CAsyncSimulator simulator(&engine);
+  CompletionLog log{};
+  const uint8_t kWriteBytes[3] = {0x00, 0x18, 0x01};
+  I2CTransaction first = MakeTransaction(kWriteBytes, sizeof(kWriteBytes), nullptr, 0, &log);
+  I2CTransaction second = MakeTransaction(kWriteBytes, 2, nullptr, 0, &log);
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(kWriteBytes, _)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).Times(2).WillRepeatedly(Return(0));
+
+  ASSERT_TRUE(engine.Submit(&first));
+  ASSERT_TRUE(engine.Submit(&second));
+  EXPECT_EQ(second.state, kI2cTransactionQueued);
+  EXPECT_EQ(engine.Pending(), 1);
+  simulator.TransferComplete();
+  EXPECT_EQ(second.state, kI2cTransactionBusy);
+  simulator.TransferComplete();
+  ASSERT_EQ(log.num_of_completions, 2);
+  EXPECT_EQ(log.order[0], &first);
+  EXPECT_EQ(log.order[1], &second);
+}
+
+TEST(I2CAsyncTest, nackSkipsReadPhaseAndReportsError) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CAsyncEngine engine(&i2c_peripheral_mock);
+  I2CAsyncSimulator simulator(&engine);
+  CompletionLog log{};
+  const uint8_t kNackOnAddress = 2;
+  uint8_t rx[1];
+  I2CTransaction transaction = MakeTransaction(kRegister, sizeof(kRegister), rx, sizeof(rx), &log);
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+  EXPECT_CALL(i2c_peripheral_mock, write(kRegister, sizeof(kRegister)));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).WillOnce(Return(kNackOnAddress));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(_, _)).Times(0);
+
+  ASSERT_TRUE(engine.Submit(&transaction));
+  simulator.TransferComplete();
+  EXPECT_EQ(log.num_of_completions, 1);
+  EXPECT_EQ(transaction.state, kI2cTransactionError);
+  EXPECT_EQ(transaction.status, kNackOnAddress);
+}
+
+TEST(I2CAsyncTest, failedStartCompletesInSubmitAndStartsNext) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CAsyncEngine engine(&i2c_peripheral_mock);
+  I2CAsyncSimulator simulator(&engine);
+  CompletionLog log{};
+  const uint8_t kBusBusy = 5;
+  const uint8_t kWriteBytes[2] = {0x00, 0x18};
+  I2CTransaction transactions[4];
+  for (I2CTransaction &transaction : transactions) {
+    transaction = MakeTransaction(kWriteBytes, sizeof(kWriteBytes), nullptr, 0, &log);
+  }
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(kWriteBytes, sizeof(kWriteBytes))).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).Times(2).WillRepeatedly(Return(0));
+
+  // Never reaches the bus: completes inside Submit, no interrupt will follow
+  simulator.FailNextStart(kBusBusy);
+  ASSERT_TRUE(engine.Submit(&transactions[0]));
+  EXPECT_EQ(transactions[0].state, kI2cTransactionError);
+  EXPECT_EQ(transactions[0].status, kBusBusy);
+  EXPECT_FALSE(engine.Busy());
+
+  // A queued transaction that fails to start is skipped over to the next one
+  ASSERT_TRUE(engine.Submit(&transactions[1]));
+  ASSERT_TRUE(engine.Submit(&transactions[2]));
+  ASSERT_TRUE(engine.Submit(&transactions[3]));
+  simulator.FailNextStart(kBusBusy);
+  simulator.TransferComplete();
+  EXPECT_EQ(transactions[1].state, kI2cTransactionDone);
+  EXPECT_EQ(transactions[2].state, kI2cTransactionError);
+  EXPECT_EQ(transactions[3].state, kI2cTransactionBusy);
+  EXPECT_EQ(engine.Pending(), 0);
+  simulator.TransferComplete();
+  ASSERT_EQ(log.num_of_completions, 4);
+  for (uint8_t i = 0; i < 4; i++) {
+    EXPECT_EQ(log.order[i], &transactions[i]);
+  }
+  EXPECT_EQ(transactions[3].state, kI2cTransactionDone);
+  EXPECT_FALSE(engine.Busy());
+}
+
+TEST(I2CAsyncTest, submitRejectsWhenQueueIsFull) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CAsyncEngine engine(&i2c_peripheral_mock);
+  I2CAsyncSimulator simulator(&engine);
+  CompletionLog log{};
+  const uint8_t kWriteBytes[1] = {0x00};
+  I2CTransaction transactions[kI2cAsyncQueueSize + 2];
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(_));
+  EXPECT_CALL(i2c_peripheral_mock, write(kWriteBytes, 1));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).WillOnce(Return(0));
+
+  // One transaction goes on the bus, the rest fills the queue
+  for (uint8_t i = 0; i < kI2cAsyncQueueSize + 1; i++) {
+    transactions[i] = MakeTransaction(kWriteBytes, 1, nullptr, 0, &log);
+    EXPECT_TRUE(engine.Submit(&transactions[i]));
+  }
+  transactions[kI2cAsyncQueueSize + 1] = MakeTransaction(kWriteBytes, 1, nullptr, 0, &log);
+  EXPECT_FALSE(engine.Submit(&transactions[kI2cAsyncQueueSize + 1]));
+  EXPECT_EQ(engine.Pending(), kI2cAsyncQueueSize);
+}
@@ -0,0 +1,273 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <i2c_helper.hpp>
+#include <i2c_bus_scheduler.hpp>
+#include <vector>
+
+using ::testing::Return;
+using ::testing::NiceMock;
+using ::testing::_;
+
+namespace {
+
+uint32_t simulated_time_us = 0;
+std::vector<uint32_t> delays;
+
+uint32_t SimulatedClock() {
+  return simulated_time_us;
+}
+
+void SimulatedDelay(uint32_t delay_us) {
+  delays.push_back(delay_us);
+  simulated_time_us += delay_us;
+}
+
+// Fake bus lines: a slave holds SDA low until it has seen sda_low_pulses falling SCL edges
+struct FakeBusLines {
+  bool began;
+  bool ended;
+  bool scl;
+  bool sda;
+  uint8_t sda_low_pulses;
+  uint8_t pulses;
+  bool stop_seen;
+} lines;
+
+void LinesBegin() {
+  lines.began = true;
+}
+
+void LinesEnd() {
+  lines.ended = true;
+}
+
+void LinesSetScl(bool level) {
+  if (lines.scl && !level) {
+    lines.pulses++;
+  }
+  lines.scl = level;
+}
+
+void LinesSetSda(bool level) {
+  if (lines.scl && !lines.sda && level) {
+    lines.stop_seen = true;
+  }
+  lines.sda = level;
+}
+
+bool LinesReadSda() {
+  return lines.pulses >= lines.sda_low_pulses;
+}
+
+const I2CBusRecoveryPins kRecoveryPins = {
+    LinesBegin, LinesSetScl, LinesSetSda, LinesReadSda, LinesEnd, SimulatedDelay, 5,
+};
+
+void ResetFakes(uint8_t sda_low_pulses) {
+  simulated_time_us = 0;
+  delays.clear();
+  lines = {};
+  lines.sda_low_pulses = sda_low_pulses;
+}
+
+}  // namespace
+
+TEST(I2CBusRecoveryTest, retriesWithBackoffUntilSuccess) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 3;
+  policy.backoff_us = 100;
+  policy.delay = SimulatedDelay;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[2] = {0x01, 0x02};
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillOnce(Return(2)).WillOnce(Return(2)).WillOnce(Return(0));
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), 0);
+  EXPECT_EQ(delays, std::vector<uint32_t>({100, 200}));
+}
+
+TEST(I2CBusRecoveryTest, reportsLastErrorAfterMaxRetries) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 2;
+  driver.SetRetryPolicy(policy);
+
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission()).Times(3).WillRepeatedly(Return(3));
+  EXPECT_EQ(driver.WriteReg(0x0010, 0x01), 3);
+}
+
+TEST(I2CBusRecoveryTest, singleAttemptWithoutPolicy) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission()).WillOnce(Return(2));
+  EXPECT_EQ(driver.WriteReg16(0x0010, 0x0102), 2);
+}
+
+TEST(I2CBusRecoveryTest, failedReadLeavesDataUntouched) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).WillOnce(Return(2)).WillOnce(Return(4));
+  EXPECT_CALL(i2c_peripheral_mock, read()).Times(0);
+  uint8_t data = 0xAA;
+  EXPECT_EQ(driver.ReadReg(0x0010, &data), 2);
+  EXPECT_EQ(data, 0xAA);
+  uint16_t data16 = 0xAAAA;
+  EXPECT_EQ(driver.ReadReg16(0x0010, &data16), 4);
+  EXPECT_EQ(data16, 0xAAAA);
+}
+
+TEST(I2CBusRecoveryTest, deadlineStopsRetries) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0);
+  I2CRetryPolicy policy = {};
+  policy.deadline_us = 500;
+  policy.max_retries = 10;
+  policy.backoff_us = 100;
+  policy.clock = SimulatedClock;
+  policy.delay = SimulatedDelay;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[1] = {0x01};
+  ON_CALL(i2c_peripheral_mock, endTransmission(true)).WillByDefault(Return(2));
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), kI2cStatusDeadlineExceeded);
+  // 100 + 200 fit in the deadline, waiting another 400 would not
+  EXPECT_EQ(delays, std::vector<uint32_t>({100, 200}));
+}
+
+TEST(I2CBusRecoveryTest, backoffSaturatesPastShiftWidth) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 40;
+  policy.backoff_us = 1;
+  policy.delay = SimulatedDelay;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[1] = {0x01};
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).Times(41).WillRepeatedly(Return(2));
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), 2);
+  ASSERT_EQ(delays.size(), 40u);
+  EXPECT_EQ(delays[31], 1u << 31);
+  for (size_t i = 32; i < delays.size(); i++) {
+    EXPECT_EQ(delays[i], UINT32_MAX) << "retry " << i;
+  }
+}
+
+TEST(I2CBusRecoveryTest, deadlineHoldsForBackoffsThatWouldWrap) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0);
+  I2CRetryPolicy policy = {};
+  policy.deadline_us = 0xF0000000;
+  policy.max_retries = 40;
+  policy.backoff_us = 0x40000000;
+  policy.clock = SimulatedClock;
+  policy.delay = SimulatedDelay;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[1] = {0x01};
+  ON_CALL(i2c_peripheral_mock, endTransmission(true)).WillByDefault(Return(2));
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), kI2cStatusDeadlineExceeded);
+  // The third backoff does not fit in 32 bits, it must not wrap to a short wait
+  EXPECT_EQ(delays, std::vector<uint32_t>({0x40000000, 0x80000000}));
+}
+
+TEST(I2CBusRecoveryTest, clocksOutStuckSlaveAndReinitialises) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(3);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 3;
+  policy.recovery_threshold = 2;
+  policy.recovery = &kRecoveryPins;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[1] = {0x01};
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillOnce(Return(2)).WillOnce(Return(2)).WillOnce(Return(0));
+  EXPECT_CALL(i2c_peripheral_mock, begin()).Times(1);
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), 0);
+  EXPECT_TRUE(lines.began);
+  EXPECT_TRUE(lines.ended);
+  EXPECT_TRUE(lines.stop_seen);
+  // Three pulses to free SDA, one more to set up the STOP
+  EXPECT_EQ(lines.pulses, 4);
+}
+
+TEST(I2CBusRecoveryTest, reportsBusThatStaysStuck) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  ResetFakes(0xFF);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 5;
+  policy.recovery_threshold = 1;
+  policy.recovery = &kRecoveryPins;
+  driver.SetRetryPolicy(policy);
+
+  const uint8_t kData[1] = {0x01};
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).WillOnce(Return(2));
+  EXPECT_EQ(driver.SendBytes(kData, sizeof(kData)), kI2cStatusBusStuck);
+  EXPECT_EQ(lines.pulses, kI2cRecoveryClockPulses + 1);
+}
+
+TEST(I2CBusRecoveryTest, schedulerAppliesPolicyPerDevice) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  ResetFakes(0);
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 1;
+  const uint8_t kRetried = scheduler.AddDevice(0x29, kI2cPriorityHigh, kI2cSpeed_1MHz, &policy);
+  const uint8_t kSingleAttempt = scheduler.AddDevice(0x25, kI2cPriorityLow);
+
+  uint8_t tx[1] = {0x01};
+  I2CTransaction retried = {};
+  retried.tx_buffer = tx;
+  retried.tx_len = sizeof(tx);
+  I2CTransaction single = retried;
+  ASSERT_TRUE(scheduler.Submit(kRetried, &retried));
+  ASSERT_TRUE(scheduler.Submit(kSingleAttempt, &single));
+
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillOnce(Return(2)).WillOnce(Return(0))   // 0x29, second attempt succeeds
+      .WillOnce(Return(2));                      // 0x25, no retry
+  EXPECT_EQ(scheduler.RunAll(), 2);
+  EXPECT_EQ(retried.status, 0);
+  EXPECT_EQ(single.status, 2);
+}
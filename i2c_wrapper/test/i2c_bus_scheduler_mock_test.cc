@@ -0,0 +1,239 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <i2c_bus_scheduler.hpp>
+#include <vector>
+
+using ::testing::Return;
+using ::testing::Invoke;
+using ::testing::InSequence;
+using ::testing::NiceMock;
+using ::testing::_;
+
+namespace {
+
+// Roughly one byte (9 clocks) at 100 kHz
+const uint32_t kByteTimeUs = 90;
+uint32_t simulated_time_us = 0;
+
+uint32_t SimulatedClock() {
+  return simulated_time_us;
+}
+
+/**
+ * Simulated peripheral: advances the clock for every byte on the bus
+ * and logs the address every transfer was sent to.
+ */
+class SimulatedBus {
+ public:
+  explicit SimulatedBus(NiceMock<I2CPeripheralMock> *mock) {
+    ON_CALL(*mock, beginTransmission(_)).WillByDefault(Invoke([this](uint8_t address) {
+      addresses.push_back(address);
+      simulated_time_us += kByteTimeUs;
+    }));
+    ON_CALL(*mock, write(_, _)).WillByDefault(Invoke([](const uint8_t *, size_t quantity) {
+      simulated_time_us += quantity * kByteTimeUs;
+      return quantity;
+    }));
+    ON_CALL(*mock, endTransmission(_)).WillByDefault(Invoke([this](bool) {
+      return nack_next ? 2 : 0;
+    }));
+    ON_CALL(*mock, requestFrom(_, _)).WillByDefault(Invoke([](uint8_t, size_t quantity) {
+      return quantity;
+    }));
+    ON_CALL(*mock, requestFrom(_, _, _)).WillByDefault(Invoke([](uint8_t, size_t quantity, bool) {
+      return quantity;
+    }));
+    ON_CALL(*mock, readBytes(_, _)).WillByDefault(Invoke([](uint8_t *, size_t length) {
+      simulated_time_us += (length + 1) * kByteTimeUs;
+      return length;
+    }));
+  }
+  std::vector<uint8_t> addresses;
+  bool nack_next = false;
+};
+
+const uint8_t kSdp810 = 0x25;
+const uint8_t kVl6180x = 0x29;
+const uint8_t kAds7138 = 0x10;
+const uint8_t kRegister[2] = {0x00, 0x4F};
+
+std::vector<I2CTransaction *> completion_order;
+
+void RecordCompletion(I2CTransaction *transaction, void *) {
+  completion_order.push_back(transaction);
+}
+
+I2CTransaction MakeRead(uint8_t *rx, uint8_t rx_len) {
+  I2CTransaction transaction{};
+  transaction.callback = RecordCompletion;
+  transaction.tx_buffer = kRegister;
+  transaction.tx_len = sizeof(kRegister);
+  transaction.rx_buffer = rx;
+  transaction.rx_len = rx_len;
+  return transaction;
+}
+
+}  // namespace
+
+TEST(I2CBusSchedulerTest, runsByPriorityThenDeadline) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  SimulatedBus bus(&i2c_peripheral_mock);
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  const uint8_t kVentilation = scheduler.AddDevice(kSdp810, kI2cPriorityHigh);
+  const uint8_t kCompression = scheduler.AddDevice(kVl6180x, kI2cPriorityMedium);
+  const uint8_t kFingerPosition = scheduler.AddDevice(kAds7138, kI2cPriorityLow);
+
+  uint8_t rx[5][2];
+  I2CTransaction finger = MakeRead(rx[0], 2);
+  I2CTransaction compression_late = MakeRead(rx[1], 1);
+  I2CTransaction compression_early = MakeRead(rx[2], 1);
+  I2CTransaction ventilation = MakeRead(rx[3], 2);
+  I2CTransaction compression_no_deadline = MakeRead(rx[4], 1);
+
+  ASSERT_TRUE(scheduler.Submit(kFingerPosition, &finger));
+  ASSERT_TRUE(scheduler.Submit(kCompression, &compression_no_deadline));
+  ASSERT_TRUE(scheduler.Submit(kCompression, &compression_late, 5000));
+  ASSERT_TRUE(scheduler.Submit(kCompression, &compression_early, 2000));
+  ASSERT_TRUE(scheduler.Submit(kVentilation, &ventilation, 10000));
+  EXPECT_EQ(scheduler.Pending(), 5);
+
+  completion_order.clear();
+  EXPECT_EQ(scheduler.RunAll(), 5);
+  const std::vector<uint8_t> kExpectedOrder = {kSdp810, kVl6180x, kVl6180x, kVl6180x, kAds7138};
+  EXPECT_EQ(bus.addresses, kExpectedOrder);
+  // Same device and priority: earliest deadline first, no deadline last
+  const std::vector<I2CTransaction *> kExpectedCompletions =
+      {&ventilation, &compression_early, &compression_late, &compression_no_deadline, &finger};
+  EXPECT_EQ(completion_order, kExpectedCompletions);
+  EXPECT_EQ(compression_early.state, kI2cTransactionDone);
+  EXPECT_EQ(ventilation.i2c_addr, kSdp810);
+}
+
+TEST(I2CBusSchedulerTest, equalTransactionsRunInSubmissionOrder) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  SimulatedBus bus(&i2c_peripheral_mock);
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  const uint8_t kFirst = scheduler.AddDevice(0x30, kI2cPriorityMedium);
+  const uint8_t kSecond = scheduler.AddDevice(0x31, kI2cPriorityMedium);
+  const uint8_t kThird = scheduler.AddDevice(0x32, kI2cPriorityMedium);
+  uint8_t rx[3];
+  I2CTransaction transactions[3] = {MakeRead(&rx[0], 1), MakeRead(&rx[1], 1), MakeRead(&rx[2], 1)};
+  scheduler.Submit(kThird, &transactions[0]);
+  scheduler.Submit(kFirst, &transactions[1]);
+  scheduler.Submit(kSecond, &transactions[2]);
+  scheduler.RunAll();
+  const std::vector<uint8_t> kExpectedOrder = {0x32, 0x30, 0x31};
+  EXPECT_EQ(bus.addresses, kExpectedOrder);
+}
+
+TEST(I2CBusSchedulerTest, keepsBusAndDeviceStatistics) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  SimulatedBus bus(&i2c_peripheral_mock);
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  const uint8_t kVentilation = scheduler.AddDevice(kSdp810, kI2cPriorityHigh);
+  const uint8_t kCompression = scheduler.AddDevice(kVl6180x, kI2cPriorityMedium);
+  uint8_t rx[2][2];
+  I2CTransaction on_time = MakeRead(rx[0], 2);
+  I2CTransaction too_late = MakeRead(rx[1], 1);
+
+  scheduler.Submit(kVentilation, &on_time, 10000);
+  scheduler.Submit(kCompression, &too_late, 100);
+  bus.nack_next = false;
+  scheduler.RunNext();
+  bus.nack_next = true;
+  scheduler.RunNext();
+  // Bus idle for as long as it was busy
+  const uint32_t kBusyTime = simulated_time_us;
+  simulated_time_us += kBusyTime;
+
+  I2CBusStatistics bus_statistics = scheduler.GetBusStatistics();
+  EXPECT_EQ(bus_statistics.transactions, 2u);
+  EXPECT_EQ(bus_statistics.errors, 1u);
+  EXPECT_EQ(bus_statistics.deadline_misses, 1u);
+  EXPECT_EQ(bus_statistics.busy_time_us, kBusyTime);
+  EXPECT_EQ(scheduler.GetUtilisation(), 5000);
+
+  I2CBusStatistics compression_statistics = scheduler.GetDeviceStatistics(kCompression);
+  EXPECT_EQ(compression_statistics.transactions, 1u);
+  EXPECT_EQ(compression_statistics.errors, 1u);
+  EXPECT_EQ(too_late.state, kI2cTransactionError);
+  EXPECT_EQ(scheduler.GetDeviceStatistics(kVentilation).errors, 0u);
+
+  scheduler.ResetStatistics();
+  EXPECT_EQ(scheduler.GetBusStatistics().transactions, 0u);
+  EXPECT_EQ(scheduler.GetUtilisation(), 0);
+}
+
+TEST(I2CBusSchedulerTest, rejectsUnknownDeviceAndFullQueue) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  uint8_t rx;
+  I2CTransaction transaction = MakeRead(&rx, 1);
+  EXPECT_FALSE(scheduler.Submit(0, &transaction));
+  const uint8_t kDevice = scheduler.AddDevice(kVl6180x, kI2cPriorityMedium);
+  for (uint8_t i = 0; i < kI2cSchedulerQueueSize; i++) {
+    EXPECT_TRUE(scheduler.Submit(kDevice, &transaction));
+  }
+  EXPECT_FALSE(scheduler.Submit(kDevice, &transaction));
+}
+
+TEST(I2CBusSchedulerTest, busRunsAtSpeedOfSlowestDevice) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_1MHz, SimulatedClock);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_peripheral_mock, setClock(kI2cSpeed_1MHz));
+    EXPECT_CALL(i2c_peripheral_mock, setClock(kI2cSpeed_400KHz));
+  }
+  scheduler.AddDevice(kAds7138, kI2cPriorityLow, kI2cSpeed_1MHz);
+  scheduler.Init();
+  EXPECT_EQ(scheduler.GetBusSpeed(), kI2cSpeed_1MHz);
+
+  // The VL6180X joins later and only does Fast-mode, the bus is restarted once
+  scheduler.AddDevice(kVl6180x, kI2cPriorityMedium, kI2cSpeed_400KHz);
+  scheduler.AddDevice(kSdp810, kI2cPriorityHigh, kI2cSpeed_1MHz);
+  EXPECT_EQ(scheduler.GetBusSpeed(), kI2cSpeed_400KHz);
+}
+
+TEST(I2CBusSchedulerTest, boardLimitCapsBusSpeed) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  simulated_time_us = 0;
+  I2CBusScheduler scheduler(&i2c_peripheral_mock, kI2cSpeed_100KHz, SimulatedClock);
+  scheduler.AddDevice(kAds7138, kI2cPriorityLow, kI2cSpeed_1MHz);
+  EXPECT_CALL(i2c_peripheral_mock, setClock(kI2cSpeed_100KHz));
+  scheduler.Init();
+  EXPECT_EQ(scheduler.GetBusSpeed(), kI2cSpeed_100KHz);
+}
@@ -0,0 +1,150 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <i2c_helper.hpp>
+#include <i2c_trace.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using ::testing::Return;
+using ::testing::NiceMock;
+using ::testing::_;
+
+namespace {
+
+uint32_t simulated_time_us = 0;
+
+// Every clock read advances time, so a transaction lasts the step between its two reads
+uint32_t clock_step_us = 0;
+
+uint32_t SteppingClock() {
+  uint32_t now = simulated_time_us;
+  simulated_time_us += clock_step_us;
+  return now;
+}
+
+void ResetTrace(uint32_t step_us) {
+  simulated_time_us = 1000;
+  clock_step_us = step_us;
+  I2CTracer::SetClock(SteppingClock);
+  I2CTracer::Reset();
+}
+
+}  // namespace
+
+TEST(I2CTraceTest, recordsEveryTransaction) {
+  const uint8_t kI2CAddress = 0x29;
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_400KHz, kI2CAddress);
+  ResetTrace(40);
+
+  const uint8_t kTx[2] = {0x00, 0x4D};
+  uint8_t rx[1];
+  ON_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, sizeof(rx))).WillByDefault(Return(sizeof(rx)));
+  driver.WriteRead(kTx, sizeof(kTx), rx, sizeof(rx));
+  driver.ChangeAddress(0x25);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).WillOnce(Return(2));
+  EXPECT_EQ(driver.SendBytes(kTx, sizeof(kTx)), 2);
+
+  I2CTraceRecord records[4];
+  ASSERT_EQ(I2CTracer::Drain(records, 4), 2u);
+  EXPECT_EQ(records[0].timestamp_us, 1000u);
+  EXPECT_EQ(records[0].duration_us, 40u);
+  EXPECT_EQ(records[0].i2c_addr, kI2CAddress);
+  EXPECT_EQ(records[0].direction, kI2cTraceWriteRead);
+  EXPECT_EQ(records[0].num_of_bytes, 3);
+  EXPECT_EQ(records[0].status, 0);
+  EXPECT_EQ(records[1].i2c_addr, 0x25);
+  EXPECT_EQ(records[1].direction, kI2cTraceWrite);
+  EXPECT_EQ(records[1].status, 2);
+  EXPECT_EQ(I2CTracer::Drain(records, 4), 0u);
+}
+
+TEST(I2CTraceTest, keepsPerDeviceHistogramAndStatusCounts) {
+  const uint8_t kI2CAddress = 0x40;
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, kI2CAddress);
+  const uint8_t kData[1] = {0x55};
+
+  ResetTrace(10);       // Bucket 0: < 32 us
+  driver.SendBytes(kData, sizeof(kData));
+  clock_step_us = 100;  // Bucket 2: 64..127 us
+  driver.SendBytes(kData, sizeof(kData));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true)).WillOnce(Return(3));
+  driver.SendBytes(kData, sizeof(kData));
+
+  const I2CTraceDeviceStatistics *statistics = I2CTracer::GetDeviceStatistics(kI2CAddress);
+  ASSERT_NE(statistics, nullptr);
+  EXPECT_EQ(statistics->transactions, 3u);
+  EXPECT_EQ(statistics->errors, 1u);
+  EXPECT_EQ(statistics->status_counts[0], 2u);
+  EXPECT_EQ(statistics->status_counts[3], 1u);
+  EXPECT_EQ(statistics->latency_histogram[0], 1u);
+  EXPECT_EQ(statistics->latency_histogram[2], 2u);
+  EXPECT_EQ(I2CTracer::GetDeviceStatistics(0x41), nullptr);
+}
+
+TEST(I2CTraceTest, dropsRecordsWhenFull) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  const uint8_t kData[1] = {0x55};
+  ResetTrace(1);
+
+  for (uint16_t i = 0; i < kI2cTraceBufferSize + 5; i++) {
+    driver.SendBytes(kData, sizeof(kData));
+  }
+  EXPECT_EQ(I2CTracer::Dropped(), 5u);
+  EXPECT_EQ(I2CTracer::GetDeviceStatistics(0x29)->transactions, kI2cTraceBufferSize + 5u);
+
+  I2CTraceRecord record;
+  EXPECT_EQ(I2CTracer::Drain(&record, 1), 1u);
+  driver.SendBytes(kData, sizeof(kData));  // The freed slot can be used again
+  EXPECT_EQ(I2CTracer::Dropped(), 5u);
+}
+
+TEST(I2CTraceTest, dumpsTraceToFile) {
+  NiceMock<I2CPeripheralMock> i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_100KHz, 0x29);
+  const uint8_t kData[1] = {0x55};
+  ResetTrace(50);
+  driver.SendBytes(kData, sizeof(kData));
+
+  const char *kPath = "i2c_trace_test.csv";
+  ASSERT_TRUE(I2CTracer::DumpToFile(kPath));
+  std::ifstream file(kPath);
+  std::string header;
+  std::string line;
+  std::getline(file, header);
+  std::getline(file, line);
+  EXPECT_EQ(header, "timestamp_us,duration_us,address,direction,bytes,status");
+  EXPECT_EQ(line, "1000,50,0x29,write,1,0");
+  std::remove(kPath);
+}
@@ -29,6 +29,7 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <i2c_helper.hpp>
+#include <vector>
 
 using ::testing::Return;
 using ::testing::InSequence;
@@ -45,6 +46,40 @@ TEST(I2CWrapperTest, initCallsRightMethods) {
   driver.Init();
 }
 
+TEST(I2CWrapperTest, computesBaudForEverySpeed) {
+  /* Values from the SERCOM formula at 48 MHz, rounded up */
+  EXPECT_EQ(I2CComputeBaud(kI2cDefaultSourceClockHz, kI2cSpeed_100KHz), 211);
+  EXPECT_EQ(I2CComputeBaud(kI2cDefaultSourceClockHz, kI2cSpeed_400KHz), 48);
+  EXPECT_EQ(I2CComputeBaud(kI2cDefaultSourceClockHz, kI2cSpeed_1MHz), 17);
+  /* SCL may come out a little slow, never faster than the mode allows */
+  for (I2CSpeed speed : {kI2cSpeed_100KHz, kI2cSpeed_400KHz, kI2cSpeed_1MHz}) {
+    const uint32_t kRate = I2CBaudToSpeed(kI2cDefaultSourceClockHz,
+                                          I2CComputeBaud(kI2cDefaultSourceClockHz, speed), speed);
+    EXPECT_LE(kRate, static_cast<uint32_t>(speed));
+    EXPECT_GT(kRate, speed * 95u / 100u);
+  }
+  /* 8 MHz is too slow for Fm+, 200 MHz too fast for a 8-bit BAUD at 100 kHz */
+  EXPECT_EQ(I2CComputeBaud(8000000, kI2cSpeed_1MHz), kI2cInvalidBaud);
+  EXPECT_EQ(I2CComputeBaud(200000000, kI2cSpeed_100KHz), kI2cInvalidBaud);
+}
+
+TEST(I2CWrapperTest, initSelectsFastestSupportedSpeed) {
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock, kI2cSpeed_1MHz, 0x48);
+  EXPECT_CALL(i2c_peripheral_mock, begin()).Times(2);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_peripheral_mock, setClock(kI2cSpeed_1MHz));
+    EXPECT_CALL(i2c_peripheral_mock, setClock(kI2cSpeed_400KHz));
+  }
+  driver.Init();
+  EXPECT_EQ(driver.GetSpeed(), kI2cSpeed_1MHz);
+
+  driver.SetSourceClock(8000000);
+  driver.Init();
+  EXPECT_EQ(driver.GetSpeed(), kI2cSpeed_400KHz);
+}
+
 TEST(I2CWrapperTest, write_regCallsRightMethods) {
   const uint8_t kI2CAddress = 0x29;
   /* Mock class and i2c_driver instantiation*/
@@ -105,7 +140,7 @@ TEST(I2CWrapperTest, read_regCallsRightMethods) {
   I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
                                kI2cSpeed_100KHz, kI2CAddress);
   /* Parameters used in this test*/
-  const uint16_t kReg = 0x05;
+  const uint16_t kReg = 0x0205;
   const uint8_t kDataToReturn = 0x53;
   /* Generate mock method input parameters*/
   const uint8_t kRegUpperByte = (kReg >> 8) & 0xFF;
@@ -120,7 +155,8 @@ TEST(I2CWrapperTest, read_regCallsRightMethods) {
   }
   EXPECT_CALL(i2c_peripheral_mock, endTransmission(false));
   EXPECT_CALL(i2c_peripheral_mock,
-              requestFrom(kI2CAddress, kRequestAmountOfBytes));
+              requestFrom(kI2CAddress, kRequestAmountOfBytes))
+      .WillOnce(Return(kRequestAmountOfBytes));
   EXPECT_CALL(i2c_peripheral_mock, read())
       .WillRepeatedly(Return(kDataToReturn));
   /* The object method which calls to mock methods under the hood*/
@@ -152,7 +188,8 @@ TEST(I2CWrapperTest, read_reg16CallsRightMethods) {
     EXPECT_CALL(i2c_peripheral_mock, write(kRegLowerByte));
     EXPECT_CALL(i2c_peripheral_mock, endTransmission(false));
     EXPECT_CALL(i2c_peripheral_mock,
-                requestFrom(kI2CAddress, kRequestAmountOfBytes));
+                requestFrom(kI2CAddress, kRequestAmountOfBytes))
+        .WillOnce(Return(kRequestAmountOfBytes));
     EXPECT_CALL(i2c_peripheral_mock, read())
         .WillOnce(Return(kDataUpperByte));
     EXPECT_CALL(i2c_peripheral_mock, read())
@@ -181,16 +218,273 @@ TEST(I2CWrapperTest, readBytesCallsRightMethods) {
 
   uint8_t test_buffer[8];
   /* The expected function calls*/
-  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, kRequestAmountOfBytes, kRequestStopBit));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, kRequestAmountOfBytes, kRequestStopBit))
+      .WillOnce(Return(kRequestAmountOfBytes));
   EXPECT_CALL(i2c_peripheral_mock, readBytes(test_buffer, kRequestAmountOfBytes))
       .WillOnce(Invoke(CopyTestArray));
   /* The object method which calls to mock methods under the hood*/
-  driver.ReadBytes(test_buffer, kRequestAmountOfBytes);
+  EXPECT_EQ(driver.ReadBytes(test_buffer, kRequestAmountOfBytes), 0);
+  /* Check if returned value matched the value that mock function returned*/
+  for (uint8_t i = 0; i < kRequestAmountOfBytes; i++)
+    EXPECT_EQ(test_buffer[i], kTestingBytes[i]);
+}
+
+TEST(I2CWrapperTest, writeReadCallsRightMethods) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  /* Parameters used in this test*/
+  const uint8_t kWriteAmountOfBytes = 2;
+  const uint8_t kRequestAmountOfBytes = 8;
+  /* Generate mock method input parameters*/
+  const bool kRequestStopBit = false;
+
+  uint8_t test_buffer[8];
+  /* The expected function calls*/
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+    EXPECT_CALL(i2c_peripheral_mock, write(kTestingBytes, kWriteAmountOfBytes));
+    EXPECT_CALL(i2c_peripheral_mock, endTransmission(kRequestStopBit))
+        .WillOnce(Return(0));
+    EXPECT_CALL(i2c_peripheral_mock,
+                requestFrom(kI2CAddress, kRequestAmountOfBytes))
+        .WillOnce(Return(kRequestAmountOfBytes));
+    EXPECT_CALL(i2c_peripheral_mock, readBytes(test_buffer, kRequestAmountOfBytes))
+        .WillOnce(Invoke(CopyTestArray));
+  }
+  /* The object method which calls to mock methods under the hood*/
+  uint8_t status = driver.WriteRead(kTestingBytes, kWriteAmountOfBytes,
+                                    test_buffer, kRequestAmountOfBytes);
   /* Check if returned value matched the value that mock function returned*/
+  EXPECT_EQ(status, 0);
   for (uint8_t i = 0; i < kRequestAmountOfBytes; i++)
     EXPECT_EQ(test_buffer[i], kTestingBytes[i]);
 }
 
+TEST(I2CWrapperTest, writeReadSkipsReadOnNack) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  const uint8_t kNackOnAddress = 2;
+  uint8_t test_buffer[1];
+  /* The expected function calls*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+  EXPECT_CALL(i2c_peripheral_mock, write(kTestingBytes, 1));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false))
+      .WillOnce(Return(kNackOnAddress));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(testing::_, testing::_)).Times(0);
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.WriteRead(kTestingBytes, 1, test_buffer, 1), kNackOnAddress);
+}
+
+TEST(I2CWrapperTest, shortReadsReportAnError) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  uint8_t test_buffer[4] = {};
+  uint8_t data = 0xAA;
+  /* The slave stops sending early: nothing may be read from the receive buffer*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::Matcher<uint8_t>(testing::_))).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(kTestingBytes, 1));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).Times(2).WillRepeatedly(Return(0));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, 1)).WillOnce(Return(0));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, 4)).WillOnce(Return(2));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, 4, true)).WillOnce(Return(3));
+  EXPECT_CALL(i2c_peripheral_mock, read()).Times(0);
+  EXPECT_CALL(i2c_peripheral_mock, readBytes(testing::_, testing::_)).Times(0);
+  /* The object methods which call to mock methods under the hood*/
+  EXPECT_EQ(driver.ReadReg(0x0010, &data), kI2cStatusShortRead);
+  EXPECT_EQ(data, 0xAA);
+  EXPECT_EQ(driver.WriteRead(kTestingBytes, 1, test_buffer, sizeof(test_buffer)), kI2cStatusShortRead);
+  EXPECT_EQ(driver.ReadBytes(test_buffer, sizeof(test_buffer)), kI2cStatusShortRead);
+}
+
+TEST(I2CWrapperTest, readBytesRetriesShortReads) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  I2CRetryPolicy policy = {};
+  policy.max_retries = 2;
+  driver.SetRetryPolicy(policy);
+  uint8_t test_buffer[8];
+  /* The expected function calls*/
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, sizeof(test_buffer), true))
+      .WillOnce(Return(0))
+      .WillOnce(Return(sizeof(test_buffer)));
+  EXPECT_CALL(i2c_peripheral_mock, readBytes(test_buffer, sizeof(test_buffer)))
+      .WillOnce(Invoke(CopyTestArray));
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.ReadBytes(test_buffer, sizeof(test_buffer)), 0);
+  EXPECT_EQ(test_buffer[0], kTestingBytes[0]);
+}
+
+std::vector<std::vector<uint8_t>> written_transactions;
+
+size_t RecordWrittenTransaction(const uint8_t *data, size_t quantity) {
+  written_transactions.emplace_back(data, data + quantity);
+  return quantity;
+}
+
+TEST(I2CWrapperTest, writeRegTableMergesConsecutiveRegisters) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  /* Parameters used in this test*/
+  const I2CRegisterWrite kTable[] = {
+      {0x0207, 0x01, 1}, {0x0208, 0x02, 1},   // burst
+      {0x0096, 0x00, 1},                       // single
+      {0x00ff, 0x05, 1}, {0x0100, 0x1234, 2}, {0x0102, 0x07, 1},  // burst across 16-bit register
+  };
+  const std::vector<std::vector<uint8_t>> kExpected = {
+      {0x02, 0x07, 0x01, 0x02},
+      {0x00, 0x96, 0x00},
+      {0x00, 0xff, 0x05, 0x12, 0x34, 0x07},
+  };
+  written_transactions.clear();
+  /* The expected function calls*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(kExpected.size());
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::_, testing::_))
+      .WillRepeatedly(Invoke(RecordWrittenTransaction));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillRepeatedly(Return(0));
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.WriteRegTable(kTable, RegTableSize(kTable)), 0);
+  EXPECT_EQ(written_transactions, kExpected);
+}
+
+TEST(I2CWrapperTest, writeRegTableWithoutAutoIncrementWritesEachEntry) {
+  const uint8_t kI2CAddress = 0x10;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  const I2CRegisterWrite kTable[] = {{0x1801, 0x02, 1}, {0x1802, 0xFF, 1}};
+  const std::vector<std::vector<uint8_t>> kExpected = {{0x18, 0x01, 0x02}, {0x18, 0x02, 0xFF}};
+  written_transactions.clear();
+  /* The expected function calls*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::_, testing::_))
+      .WillRepeatedly(Invoke(RecordWrittenTransaction));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillRepeatedly(Return(0));
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.WriteRegTable(kTable, RegTableSize(kTable), false), 0);
+  EXPECT_EQ(written_transactions, kExpected);
+}
+
+TEST(I2CWrapperTest, registerCacheServesRepeatedReads) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  const I2CRegisterRange kCacheable[] = {{0x0040, 0x0041}};
+  I2CRegisterCache cache(kCacheable, RegTableSize(kCacheable));
+  driver.AttachRegisterCache(&cache);
+  /* Parameters used in this test*/
+  const uint16_t kCacheableReg = 0x0040;
+  const uint16_t kVolatileReg = 0x004F;
+  /* The expected function calls, one bus read per register*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(3);
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::Matcher<uint8_t>(testing::_))).Times(6);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).Times(3);
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, 2)).WillOnce(Return(2));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kI2CAddress, 1)).Times(2).WillRepeatedly(Return(1));
+  EXPECT_CALL(i2c_peripheral_mock, read())
+      .WillOnce(Return(0x00)).WillOnce(Return(0x64))
+      .WillOnce(Return(0x04)).WillOnce(Return(0x04));
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.ReadReg16(kCacheableReg), 0x64);
+  EXPECT_EQ(driver.ReadReg16(kCacheableReg), 0x64);
+  EXPECT_EQ(driver.ReadReg(kVolatileReg), 0x04);
+  EXPECT_EQ(driver.ReadReg(kVolatileReg), 0x04);
+  I2CRegisterCacheStatistics statistics = cache.GetStatistics();
+  EXPECT_EQ(statistics.hits, 1u);
+  EXPECT_EQ(statistics.misses, 1u);
+}
+
+TEST(I2CWrapperTest, registerCacheElidesUnchangedWrites) {
+  const uint8_t kI2CAddress = 0x29;
+  /* Mock class and i2c_driver instantiation*/
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  const I2CRegisterRange kCacheable[] = {{0x003F, 0x003F}, {0x010A, 0x010A}};
+  I2CRegisterCache cache(kCacheable, RegTableSize(kCacheable));
+  driver.AttachRegisterCache(&cache);
+  const I2CRegisterWrite kTable[] = {
+      {0x010A, 0x30, 1}, {0x003F, 0x46, 1}, {0x010A, 0x30, 1}, {0x003F, 0x40, 1},
+  };
+  const std::vector<std::vector<uint8_t>> kExpected = {
+      {0x01, 0x0A, 0x30}, {0x00, 0x3F, 0x46}, {0x00, 0x3F, 0x40},
+  };
+  written_transactions.clear();
+  /* The expected function calls*/
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress)).Times(kExpected.size());
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::_, testing::_))
+      .WillRepeatedly(Invoke(RecordWrittenTransaction));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(true))
+      .WillRepeatedly(Return(0));
+  /* The object method which calls to mock methods under the hood*/
+  EXPECT_EQ(driver.WriteRegTable(kTable, RegTableSize(kTable)), 0);
+  EXPECT_EQ(written_transactions, kExpected);
+  // Same value again: served from the shadow copy without touching the bus
+  driver.WriteReg(0x003F, 0x40);
+  EXPECT_EQ(driver.ReadReg(0x003F), 0x40);
+  EXPECT_EQ(cache.GetStatistics().elided_writes, 2u);
+
+  // After invalidation (e.g. power-cycle) writes go to the bus again
+  cache.Invalidate();
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::Matcher<uint8_t>(testing::_))).Times(3);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission());
+  driver.WriteReg(0x003F, 0x40);
+}
+
+TEST(I2CWrapperTest, changeAddressDetachesRegisterCache) {
+  const uint8_t kI2CAddress = 0x29;
+  const uint8_t kOtherAddress = 0x48;
+  I2CPeripheralMock i2c_peripheral_mock;
+  I2CDriver driver = I2CDriver(&i2c_peripheral_mock,
+                               kI2cSpeed_100KHz, kI2CAddress);
+  const I2CRegisterRange kCacheable[] = {{0x0040, 0x0040}};
+  I2CRegisterCache cache(kCacheable, RegTableSize(kCacheable));
+  driver.AttachRegisterCache(&cache);
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kI2CAddress));
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::Matcher<uint8_t>(testing::_))).Times(3);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission()).WillOnce(Return(0));
+  driver.WriteReg(0x0040, 0x12);
+  // Same address: the cache stays and the repeated write is elided
+  driver.ChangeAddress(kI2CAddress);
+  driver.WriteReg(0x0040, 0x12);
+  testing::Mock::VerifyAndClearExpectations(&i2c_peripheral_mock);
+
+  // Another device: its register 0x0040 is read and written on the bus, the cache is left alone
+  driver.ChangeAddress(kOtherAddress);
+  EXPECT_CALL(i2c_peripheral_mock, beginTransmission(kOtherAddress)).Times(2);
+  EXPECT_CALL(i2c_peripheral_mock, write(testing::Matcher<uint8_t>(testing::_))).Times(5);
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission(false)).WillOnce(Return(0));
+  EXPECT_CALL(i2c_peripheral_mock, requestFrom(kOtherAddress, 1)).WillOnce(Return(1));
+  EXPECT_CALL(i2c_peripheral_mock, read()).WillOnce(Return(0x77));
+  EXPECT_CALL(i2c_peripheral_mock, endTransmission()).WillOnce(Return(0));
+  EXPECT_EQ(driver.ReadReg(0x0040), 0x77);
+  driver.WriteReg(0x0040, 0x12);
+  EXPECT_EQ(cache.GetStatistics().elided_writes, 1u);
+  EXPECT_EQ(cache.GetStatistics().hits, 0u);
+}
+
 TEST(I2CWrapperTest, sendBytesCallsRightMethods) {
   const uint8_t kI2CAddress = 0x29;
   /* Mock class and i2c_driver instantiation*/
@@ -0,0 +1,87 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include "i2c_async_simulator.hpp"
+
+I2CAsyncSimulator *I2CAsyncSimulator::attached_ = nullptr;
+
+I2CAsyncSimulator::I2CAsyncSimulator(I2CAsyncEngine *engine) {
+  this->engine_ = engine;
+  attached_ = this;
+}
+
+I2CAsyncSimulator::~I2CAsyncSimulator() {
+  if (attached_ == this) {
+    attached_ = nullptr;
+  }
+}
+
+void I2CAsyncSimulator::TransferComplete() {
+  engine_->OnTransferComplete(transfer_status_);
+}
+
+I2CAsyncSimulator *I2CAsyncSimulator::AttachedTo(const I2CAsyncEngine *engine) {
+  return attached_ != nullptr && attached_->engine_ == engine ? attached_ : nullptr;
+}
+
+uint8_t I2CAsyncSimulator::TakeStartStatus() {
+  const uint8_t kStatus = start_status_;
+  start_status_ = 0;
+  return kStatus;
+}
+
+// Backend of the engine for the mock build, the transfer-done interrupt is raised by the simulator
+
+uint8_t I2CAsyncEngine::StartWrite(uint8_t i2c_addr, const uint8_t *buffer, uint8_t num_of_bytes, bool send_stop) {
+  I2CAsyncSimulator *simulator = I2CAsyncSimulator::AttachedTo(this);
+  const uint8_t kStartStatus = simulator != nullptr ? simulator->TakeStartStatus() : 0;
+  if (kStartStatus != 0) {
+    return kStartStatus;
+  }
+  i2c_peripheral_->beginTransmission(i2c_addr);
+  i2c_peripheral_->write(buffer, num_of_bytes);
+  const uint8_t kStatus = i2c_peripheral_->endTransmission(send_stop);
+  if (simulator != nullptr) {
+    simulator->SetTransferStatus(kStatus);
+  }
+  return 0;
+}
+
+uint8_t I2CAsyncEngine::StartRead(uint8_t i2c_addr, uint8_t *buffer, uint8_t num_of_bytes) {
+  I2CAsyncSimulator *simulator = I2CAsyncSimulator::AttachedTo(this);
+  const uint8_t kStartStatus = simulator != nullptr ? simulator->TakeStartStatus() : 0;
+  if (kStartStatus != 0) {
+    return kStartStatus;
+  }
+  i2c_peripheral_->requestFrom(i2c_addr, num_of_bytes);
+  i2c_peripheral_->readBytes(buffer, num_of_bytes);
+  if (simulator != nullptr) {
+    simulator->SetTransferStatus(0);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef I2C_ASYNC_SIMULATOR_HPP_
+#define I2C_ASYNC_SIMULATOR_HPP_
+#ifndef __arm__
+#include <stdint.h>
+#include <i2c_async.hpp>
+
+/**
+ * @brief Simulated backend of an I2CAsyncEngine for the mock build
+ *
+ * The transfer is executed on the peripheral mock right away, but its completion is only
+ * reported once TransferComplete() is called, like the transfer-done interrupt would on target.
+ * One simulator can be attached at a time.
+ */
+class I2CAsyncSimulator {
+ public:
+  explicit I2CAsyncSimulator(I2CAsyncEngine *engine);
+  ~I2CAsyncSimulator();
+
+  /**
+   * @brief Complete the transfer that is on the bus
+   */
+  void TransferComplete();
+
+  /**
+   * @brief The next transfer fails to start with this status, like a busy or faulted peripheral
+   */
+  void FailNextStart(uint8_t status) {
+    start_status_ = status;
+  }
+
+  /**
+   * @return The simulator attached to engine, nullptr when there is none
+   */
+  static I2CAsyncSimulator *AttachedTo(const I2CAsyncEngine *engine);
+
+  uint8_t TakeStartStatus();
+
+  void SetTransferStatus(uint8_t status) {
+    transfer_status_ = status;
+  }
+
+ private:
+  static I2CAsyncSimulator *attached_;
+  I2CAsyncEngine *engine_;
+  uint8_t transfer_status_ = 0;
+  uint8_t start_status_ = 0;
+};
+#endif  // __arm__
+#endif  // I2C_ASYNC_SIMULATOR_HPP_
@@ -32,23 +32,63 @@
 #include <gmock/gmock.h>
 #include <stdint.h>
 #include <i2c_peripheral_mock.hpp>
+#include <i2c_register_table.hpp>
+#include <i2c_register_cache.hpp>
+#include <i2c_bus_recovery.hpp>
 
 #define I2C_PERIPHERAL_T I2CPeripheralMock*
 
 typedef enum {
-  kI2cSpeed_100KHz = 100000, kI2cSpeed_400KHz = 400000,
+  kI2cSpeed_100KHz = 100000, kI2cSpeed_400KHz = 400000, kI2cSpeed_1MHz = 1000000,
 } I2CSpeed;
 
+/**
+ * @brief Monotonic microsecond clock, used for deadlines, statistics and tracing
+ */
+typedef uint32_t (*I2CClockFunction)(void);
+
+struct I2CRetryPolicy {
+  uint32_t deadline_us;
+  uint8_t max_retries;
+  uint32_t backoff_us;
+  uint8_t recovery_threshold;
+  I2CClockFunction clock;
+  I2CDelayFunction delay;
+  const I2CBusRecoveryPins *recovery;
+};
+
 class I2CDriver {
  public:
   MOCK_METHOD(void, Init, ());
-  MOCK_METHOD(void, WriteReg, (uint16_t reg, uint8_t data));
-  MOCK_METHOD(void, WriteReg16, (uint16_t reg, uint16_t data));
+  MOCK_METHOD(void, SetRetryPolicy, (const I2CRetryPolicy &retry_policy));
+  MOCK_METHOD(uint8_t, WriteReg, (uint16_t reg, uint8_t data));
+  MOCK_METHOD(uint8_t, WriteReg16, (uint16_t reg, uint16_t data));
+  MOCK_METHOD(uint8_t, ReadReg, (uint16_t reg, uint8_t *data));
+  MOCK_METHOD(uint8_t, ReadReg16, (uint16_t reg, uint16_t *data));
   MOCK_METHOD(uint8_t, ReadReg, (uint16_t reg));
   MOCK_METHOD(uint16_t, ReadReg16, (uint16_t reg));
-  MOCK_METHOD(void, ReadBytes, (uint8_t * buffer, uint8_t num_of_bytes));
-  MOCK_METHOD(void, SendBytes, (uint8_t * buffer, uint8_t num_of_bytes));
+  MOCK_METHOD(uint8_t, WriteRead, (const uint8_t *tx_buffer, uint8_t tx_len, uint8_t *rx_buffer, uint8_t rx_len));
+  MOCK_METHOD(uint8_t, ReadBytes, (uint8_t * buffer, uint8_t num_of_bytes));
+  MOCK_METHOD(uint8_t, SendBytes, (const uint8_t *buffer, uint8_t num_of_bytes));
+  MOCK_METHOD(uint8_t, SendByte, (const uint8_t data));
   MOCK_METHOD(void, ChangeAddress, (uint8_t new_i2c_address));
+  MOCK_METHOD(bool, SensorAvailable, ());
+  MOCK_METHOD(void, AttachRegisterCache, (I2CRegisterCache *register_cache));
+  // Not mocked: replays the table as separate register writes,
+  // so tests can keep expecting WriteReg/WriteReg16 per register.
+  // RegTableWritten tells whether the driver allowed consecutive registers to be merged.
+  uint8_t WriteRegTable(const I2CRegisterWrite *table, size_t num_of_entries, bool auto_increment = true) {
+    RegTableWritten(num_of_entries, auto_increment);
+    for (size_t i = 0; i < num_of_entries; i++) {
+      if (table[i].width == 2) {
+        WriteReg16(table[i].reg, table[i].value);
+      } else {
+        WriteReg(table[i].reg, table[i].value);
+      }
+    }
+    return 0;
+  }
+  MOCK_METHOD(void, RegTableWritten, (size_t num_of_entries, bool auto_increment));
   MOCK_METHOD(void, constructor_called, (I2C_PERIPHERAL_T i2c_peripheral, I2CSpeed speed, uint8_t i2c_addr));
 };
 
@@ -36,10 +36,11 @@
 class I2CPeripheralMock {
  public:
   MOCK_METHOD0(begin, void());
+  MOCK_METHOD1(setClock, void(uint32_t clock));
   MOCK_METHOD1(beginTransmission, void(uint8_t address));
   MOCK_METHOD1(write, size_t(uint8_t ucData));
   MOCK_METHOD2(write, size_t(const uint8_t *data, size_t quantity));
-  MOCK_METHOD0(endTransmission, void());
+  MOCK_METHOD0(endTransmission, uint8_t());
   MOCK_METHOD2(requestFrom, uint8_t(uint8_t address, size_t quantity));
   MOCK_METHOD2(readBytes, size_t(uint8_t * buffer, size_t length));
   MOCK_METHOD0(read, int());
@@ -29,8 +29,14 @@
 #ifndef SENSOR_BASE_HPP_
 #define SENSOR_BASE_HPP_
 
+#include <stddef.h>
 #include <i2c_helper.hpp>
 #include "sensor_helper.hpp"
+#include "sensor_timestamp.hpp"
+#include "sensor_ring_buffer.hpp"
+
+/* Samples moved per FillSampleBuffer call, they pass through the stack */
+inline constexpr size_t kSensorFillBlockSize = 8;
 
 class UniversalSensor {
  public:
@@ -50,6 +56,50 @@ class UniversalSensor {
    */
   virtual SensorData_t GetSensorData() = 0;
 
+  /**
+   * @brief Read a block of samples in one call
+   *
+   * @note Drivers with a hardware buffer override this to drain it in one go,
+   *       the default takes max_samples readings with GetSensorData
+   *
+   * @param samples Destination for at least max_samples samples
+   * @return Number of samples written to samples
+   */
+  virtual size_t ReadSamples(SensorData_t *samples, size_t max_samples) {
+    for (size_t i = 0; i < max_samples; i++) {
+      samples[i] = GetSensorData();
+    }
+    return max_samples;
+  }
+
+  /**
+   * @brief Buffer filled by FillSampleBuffer, or by the driver's own interrupt handler
+   *
+   * @param sample_buffer Ring with this sensor as its only producer, nullptr to detach
+   */
+  void AttachSampleBuffer(SensorSampleRing *sample_buffer) {
+    sample_buffer_ = sample_buffer;
+  }
+
+  SensorSampleRing *GetSampleBuffer() const {
+    return sample_buffer_;
+  }
+
+  /**
+   * @brief Producer side: read one block of samples into the attached buffer
+   *
+   * @return Number of samples stored, samples that did not fit are counted as dropped by the buffer
+   */
+  size_t FillSampleBuffer(size_t max_samples) {
+    if (sample_buffer_ == nullptr) {
+      return 0;
+    }
+    SensorData_t samples[kSensorFillBlockSize];
+    const size_t kNumOfSamples = ReadSamples(samples, max_samples < kSensorFillBlockSize ? max_samples
+                                                                                          : kSensorFillBlockSize);
+    return sample_buffer_->PushBatch(samples, kNumOfSamples);
+  }
+
   /**
    * @brief Get the sensortype
    * 
@@ -66,6 +116,9 @@ class UniversalSensor {
     * @brief Check is sensor is available based on i2c RXNACK status
   */
   virtual const bool Available() = 0;
+
+ protected:
+  SensorSampleRing *sample_buffer_ = nullptr;
 };
 
 #endif  // SENSOR_BASE_H
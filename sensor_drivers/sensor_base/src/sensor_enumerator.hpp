@@ -0,0 +1,221 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_ENUMERATOR_HPP_
+#define SENSOR_ENUMERATOR_HPP_
+
+#include <stddef.h>
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "sensor_base.hpp"
+
+/**
+ * @brief What a scan changed on one port
+ */
+struct SensorScanResult {
+  uint8_t added;      /**< Sensors identified and initialised */
+  uint8_t removed;    /**< Sensors that stopped answering and went back to the pool */
+};
+
+/*
+ * Finds out which sensor sits on a port, instead of hardcoding the driver per port.
+ *
+ * Every Sensors type provides:
+ *   static constexpr uint8_t kProbeAddresses[]     addresses the part can answer on
+ *   static bool Identify(I2CDriver *handle)        checks the ID registers, handle is set to the address
+ * and, when it has more than one address, SetI2CAddress(uint8_t) to pick the one it was found on.
+ *
+ * The sensor objects come from a pool of PoolSize objects per type inside the enumerator,
+ * nothing is allocated. As in the drivers, every port has its own I2CDriver and one sensor:
+ * the drivers only select their address in Initialize, so a second sensor on the same handle
+ * would talk to the first one's address. Scanning stops at the first sensor identified,
+ * in the order of Sensors.
+ *
+ * Scan is also the hot-plug rescan: while the sensor keeps answering it costs one address
+ * probe (an empty write), about 25 us at 400 kHz, so a rescan fits in one sample period of the
+ * fastest sensor. Only a newly found sensor adds its identification and initialisation to the
+ * call it was found in.
+ */
+template <size_t PoolSize, typename... Sensors>
+class SensorEnumerator {
+  static_assert((std::is_base_of_v<UniversalSensor, Sensors> && ...),
+                "SensorEnumerator takes UniversalSensor implementations");
+
+ public:
+  static constexpr size_t kMaxSensors = PoolSize * sizeof...(Sensors);
+
+  /**
+   * @brief Release the sensor that stopped answering, or identify the one that appeared
+   *
+   * @param handle I2C driver of the port, left at the address of the sensor found on it
+   */
+  SensorScanResult Scan(I2CDriver *handle) {
+    SensorScanResult result = {};
+    size_t index = 0;
+    while (index < num_of_sensors_) {
+      Entry &entry = sensors_[index];
+      if (entry.handle == handle) {
+        handle->ChangeAddress(entry.i2c_addr);
+        if (!handle->SensorAvailable()) {
+          // A device probed at the same address later must not see the shadow copy of this one
+          handle->AttachRegisterCache(nullptr);
+          Remove(index);
+          result.removed++;
+          continue;
+        }
+      }
+      index++;
+    }
+
+    if (!Occupied(handle)) {
+      ScanTypes(handle, &result, std::index_sequence_for<Sensors...>{});
+    }
+
+    for (index = 0; index < num_of_sensors_; index++) {
+      if (sensors_[index].handle == handle) {
+        handle->ChangeAddress(sensors_[index].i2c_addr);
+        break;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * @return Number of sensors found on all ports
+   */
+  size_t NumOfSensors() const {
+    return num_of_sensors_;
+  }
+
+  /**
+   * @return Initialised sensor, in order of discovery
+   */
+  UniversalSensor *GetSensor(size_t index) {
+    return index < num_of_sensors_ ? sensors_[index].sensor : nullptr;
+  }
+
+  /**
+   * @return Port the sensor at index was found on
+   */
+  I2CDriver *GetHandle(size_t index) {
+    return index < num_of_sensors_ ? sensors_[index].handle : nullptr;
+  }
+
+ private:
+  struct Entry {
+    UniversalSensor *sensor;
+    I2CDriver *handle;
+    uint8_t i2c_addr;
+    uint8_t type_index;
+    uint8_t slot;
+  };
+
+  template <typename Sensor, typename = void>
+  struct HasSetI2CAddress : std::false_type {};
+
+  template <typename Sensor>
+  struct HasSetI2CAddress<Sensor, std::void_t<decltype(std::declval<Sensor &>().SetI2CAddress(uint8_t{}))>>
+      : std::true_type {};
+
+  std::tuple<std::array<Sensors, PoolSize>...> pool_;
+  bool in_use_[sizeof...(Sensors)][PoolSize] = {};
+  Entry sensors_[kMaxSensors] = {};
+  size_t num_of_sensors_ = 0;
+
+  bool Occupied(const I2CDriver *handle) const {
+    for (size_t i = 0; i < num_of_sensors_; i++) {
+      if (sensors_[i].handle == handle) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Bound(const I2CDriver *handle, uint8_t i2c_addr) const {
+    for (size_t i = 0; i < num_of_sensors_; i++) {
+      if (sensors_[i].handle == handle && sensors_[i].i2c_addr == i2c_addr) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Remove(size_t index) {
+    Entry &entry = sensors_[index];
+    entry.sensor->Uninitialize();
+    in_use_[entry.type_index][entry.slot] = false;
+    for (size_t i = index + 1; i < num_of_sensors_; i++) {
+      sensors_[i - 1] = sensors_[i];
+    }
+    num_of_sensors_--;
+  }
+
+  template <size_t... TypeIndex>
+  void ScanTypes(I2CDriver *handle, SensorScanResult *result, std::index_sequence<TypeIndex...>) {
+    (ScanType<TypeIndex>(handle, result), ...);
+  }
+
+  template <size_t TypeIndex>
+  void ScanType(I2CDriver *handle, SensorScanResult *result) {
+    using Sensor = std::tuple_element_t<TypeIndex, std::tuple<Sensors...>>;
+    if (Occupied(handle)) {
+      return;
+    }
+    for (const uint8_t kAddr : Sensor::kProbeAddresses) {
+      if (Bound(handle, kAddr)) {
+        continue;
+      }
+      handle->ChangeAddress(kAddr);
+      if (!handle->SensorAvailable() || !Sensor::Identify(handle)) {
+        continue;
+      }
+      size_t slot = 0;
+      while (slot < PoolSize && in_use_[TypeIndex][slot]) {
+        slot++;
+      }
+      if (slot == PoolSize) {
+        return;
+      }
+
+      Sensor &sensor = std::get<TypeIndex>(pool_)[slot];
+      if constexpr (HasSetI2CAddress<Sensor>::value) {
+        sensor.SetI2CAddress(kAddr);
+      }
+      sensor.Sensor::Initialize(handle);
+      in_use_[TypeIndex][slot] = true;
+      sensors_[num_of_sensors_++] = {&sensor, handle, kAddr, static_cast<uint8_t>(TypeIndex),
+                                     static_cast<uint8_t>(slot)};
+      result->added++;
+      return;
+    }
+  }
+};
+
+#endif  // SENSOR_ENUMERATOR_HPP_
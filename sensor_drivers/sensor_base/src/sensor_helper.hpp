@@ -30,6 +30,16 @@
 #define SENSOR_HELPER_HPP
 
 inline constexpr uint8_t kMaxAmountOfSensorBytes = 8;
+
+/**
+ * @brief Type of the values in SensorData_t::buffer, every value takes one buffer slot
+ */
+enum SensorElementType {
+  kSensorElementU16 = 0,
+  kSensorElementI16,
+  kSensorElementU8,
+};
+
 /**
  * @brief Sensordata struct contains the read sensor data with samplenum and sensortype
  *
@@ -37,10 +47,12 @@ inline constexpr uint8_t kMaxAmountOfSensorBytes = 8;
  *
  */
 typedef struct SensorData {
-  uint16_t sample_num;                          /**< index / counter */
+  uint32_t sample_num;                          /**< sequence number, gaps show dropped samples */
+  uint32_t timestamp_us;                        /**< capture time on the shared sensor clock, see sensor_timestamp.hpp */
   uint16_t sensor_id;                           /**< high byte: real sensor_id as defined in SensorType enum, low byte: subsensor (e.g. 0..8 for finger position sensor) */
   uint16_t buffer[kMaxAmountOfSensorBytes];     /**< actual data of sensor */
-  uint8_t num_of_bytes;                         /**< number of bytes as stored in the buffer */
+  uint8_t num_of_bytes;                         /**< payload size in bytes: number of values times the size of element_type */
+  uint8_t element_type;                         /**< SensorElementType of the values in buffer */
   uint8_t status;                               /**< sensor status */
 } SensorData_t;
 
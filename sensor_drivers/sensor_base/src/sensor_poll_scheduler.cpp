@@ -0,0 +1,306 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <sensor_poll_scheduler.hpp>
+
+static uint64_t GreatestCommonDivisor(uint64_t a, uint64_t b) {
+  while (b != 0) {
+    const uint64_t kRemainder = a % b;
+    a = b;
+    b = kRemainder;
+  }
+  return a;
+}
+
+uint8_t SensorPollScheduler::AddSensor(UniversalSensor *sensor, uint32_t rate_hz, uint32_t read_cost_us) {
+  if (num_of_sensors_ == kSensorPollMaxSensors || sensor == nullptr || sensor->GetSampleBuffer() == nullptr
+      || rate_hz == 0 || rate_hz > 1000000) {
+    return kSensorPollInvalidSensor;
+  }
+  sensors_[num_of_sensors_].sensor = sensor;
+  sensors_[num_of_sensors_].period_us = 1000000 / rate_hz;
+  sensors_[num_of_sensors_].read_cost_us = read_cost_us;
+  sensors_[num_of_sensors_].statistics = {};
+  num_of_sensors_++;
+  num_of_slots_ = 0;
+  return num_of_sensors_ - 1;
+}
+
+SensorScheduleStatus SensorPollScheduler::BuildSchedule() {
+  num_of_slots_ = 0;
+  started_ = false;
+  if (num_of_sensors_ == 0) {
+    return kSensorScheduleEmpty;
+  }
+  if (GetUtilisation() > bus_budget_) {
+    return kSensorScheduleOverBudget;
+  }
+
+  uint64_t hyperperiod = 1;
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    const uint64_t kPeriod = sensors_[i].period_us;
+    hyperperiod = hyperperiod / GreatestCommonDivisor(hyperperiod, kPeriod) * kPeriod;
+    if (hyperperiod > kSensorPollMaxHyperperiodUs) {
+      return kSensorScheduleTooLong;
+    }
+  }
+
+  // Rate monotonic: shortest period first, sensors with equal periods in the order they were added
+  uint8_t order[kSensorPollMaxSensors];
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    uint8_t position = i;
+    while (position > 0 && sensors_[order[position - 1]].period_us > sensors_[i].period_us) {
+      order[position] = order[position - 1];
+      position--;
+    }
+    order[position] = i;
+  }
+
+  // Play one hyperperiod of non-preemptive reads, a read that started keeps the bus until it is done
+  uint32_t next_release[kSensorPollMaxSensors] = {};
+  uint32_t release[kSensorPollMaxSensors] = {};
+  bool pending[kSensorPollMaxSensors] = {};
+  uint32_t min_delay[kSensorPollMaxSensors];
+  uint32_t max_delay[kSensorPollMaxSensors] = {};
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    min_delay[i] = UINT32_MAX;
+  }
+
+  uint32_t now = 0;
+  for (;;) {
+    for (uint8_t i = 0; i < num_of_sensors_; i++) {
+      if (next_release[i] <= now && next_release[i] < hyperperiod) {
+        if (pending[i]) {
+          return kSensorScheduleMissesDeadline;
+        }
+        pending[i] = true;
+        release[i] = next_release[i];
+        next_release[i] += sensors_[i].period_us;
+      }
+    }
+
+    uint8_t next = kSensorPollInvalidSensor;
+    for (uint8_t i = 0; i < num_of_sensors_ && next == kSensorPollInvalidSensor; i++) {
+      if (pending[order[i]]) {
+        next = order[i];
+      }
+    }
+    if (next == kSensorPollInvalidSensor) {
+      uint32_t earliest = UINT32_MAX;
+      for (uint8_t i = 0; i < num_of_sensors_; i++) {
+        if (next_release[i] < hyperperiod && next_release[i] < earliest) {
+          earliest = next_release[i];
+        }
+      }
+      if (earliest == UINT32_MAX) {
+        break;
+      }
+      now = earliest;
+      continue;
+    }
+
+    const Sensor &kSensor = sensors_[next];
+    if (now + kSensor.read_cost_us > release[next] + kSensor.period_us) {
+      return kSensorScheduleMissesDeadline;
+    }
+    if (num_of_slots_ == kSensorPollMaxSlots) {
+      num_of_slots_ = 0;
+      return kSensorScheduleTooLong;
+    }
+    slots_[num_of_slots_].offset_us = now;
+    slots_[num_of_slots_].sensor = next;
+    num_of_slots_++;
+
+    const uint32_t kDelay = now - release[next];
+    min_delay[next] = kDelay < min_delay[next] ? kDelay : min_delay[next];
+    max_delay[next] = kDelay > max_delay[next] ? kDelay : max_delay[next];
+    pending[next] = false;
+    now += kSensor.read_cost_us;
+  }
+
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    sensors_[i].statistics.planned_jitter_us = max_delay[i] - min_delay[i];
+  }
+  hyperperiod_us_ = static_cast<uint32_t>(hyperperiod);
+  return kSensorScheduleOk;
+}
+
+uint32_t SensorPollScheduler::RunOnce() {
+  if (num_of_slots_ == 0) {
+    return kSensorPollMaxHyperperiodUs;
+  }
+  const uint32_t kNow = clock_();
+  if (!started_) {
+    started_ = true;
+    frame_start_us_ = kNow;
+    next_slot_ = 0;
+  }
+
+  const Slot &kSlot = slots_[next_slot_];
+  const uint32_t kDue = frame_start_us_ + kSlot.offset_us;
+  if (static_cast<int32_t>(kDue - kNow) > 0) {
+    return kDue - kNow;
+  }
+
+  Sensor &sensor = sensors_[kSlot.sensor];
+  // Detached after AddSensor: FillSampleBuffer would not read, so nothing is counted
+  if (sensor.sensor->GetSampleBuffer() != nullptr) {
+    const uint32_t kLateness = kNow - kDue;
+    sensor.statistics.reads++;
+    if (kLateness > sensor.statistics.max_lateness_us) {
+      sensor.statistics.max_lateness_us = kLateness;
+    }
+    if (kLateness >= sensor.period_us) {
+      sensor.statistics.overruns++;
+    }
+
+    sensor.sensor->FillSampleBuffer(1);
+  }
+
+  const uint32_t kEnd = clock_();
+  if (kEnd - kNow > sensor.statistics.max_duration_us) {
+    sensor.statistics.max_duration_us = kEnd - kNow;
+  }
+
+  next_slot_++;
+  if (next_slot_ == num_of_slots_) {
+    next_slot_ = 0;
+    frame_start_us_ += hyperperiod_us_;
+  }
+  // A whole hyperperiod behind: start over instead of running a burst of stale reads
+  if (static_cast<int32_t>(kEnd - (frame_start_us_ + slots_[next_slot_].offset_us))
+      >= static_cast<int32_t>(hyperperiod_us_)) {
+    started_ = false;
+  }
+  return 0;
+}
+
+void SensorPollScheduler::RunLoop() {
+  while (running_) {
+    const uint32_t kWait = RunOnce();
+    if (kWait > 0) {
+      delay_(kWait);
+    }
+  }
+}
+
+void SensorPollScheduler::RunUntil(uint32_t end_us) {
+  running_ = true;
+  while (running_ && static_cast<int32_t>(clock_() - end_us) < 0) {
+    const uint32_t kWait = RunOnce();
+    const uint32_t kRemaining = end_us - clock_();
+    if (kWait > 0 && static_cast<int32_t>(kRemaining) > 0) {
+      delay_(kWait < kRemaining ? kWait : kRemaining);
+    }
+  }
+}
+
+void SensorPollScheduler::Run() {
+  running_ = true;
+  RunLoop();
+}
+
+#ifdef __arm__
+#ifdef Arduino
+bool SensorPollScheduler::Start(uint16_t /* stack_depth */, uint32_t /* priority */) {
+  return false;
+}
+
+void SensorPollScheduler::Join() {
+  Stop();
+}
+#else
+void SensorPollScheduler::Task(void *scheduler) {
+  SensorPollScheduler *self = static_cast<SensorPollScheduler *>(scheduler);
+  self->RunLoop();
+  // The last access to self, Join may destroy the scheduler as soon as it is notified
+  taskENTER_CRITICAL();
+  TaskHandle_t joiner = self->joiner_;
+  self->task_ = nullptr;
+  taskEXIT_CRITICAL();
+  if (joiner != nullptr) {
+    xTaskNotifyGive(joiner);
+  }
+  vTaskDelete(nullptr);
+}
+
+bool SensorPollScheduler::Start(uint16_t stack_depth, uint32_t priority) {
+  if (task_ != nullptr) {
+    return false;
+  }
+  running_ = true;
+  return xTaskCreate(Task, "sensor_poll", stack_depth, this, priority, &task_) == pdPASS;
+}
+
+void SensorPollScheduler::Join() {
+  taskENTER_CRITICAL();
+  const bool kRunning = task_ != nullptr;
+  joiner_ = kRunning ? xTaskGetCurrentTaskHandle() : nullptr;
+  taskEXIT_CRITICAL();
+  Stop();
+  if (kRunning) {
+    // The task deletes itself after its current read or delay
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+#endif
+#else
+bool SensorPollScheduler::Start(uint16_t /* stack_depth */, uint32_t /* priority */) {
+  if (thread_.joinable()) {
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread([this] { RunLoop(); });
+  return true;
+}
+
+void SensorPollScheduler::Join() {
+  Stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+#endif  // __arm__
+
+uint16_t SensorPollScheduler::GetUtilisation() const {
+  uint64_t utilisation = 0;
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    // Rounded up, a schedule should never look cheaper than it is
+    utilisation += (static_cast<uint64_t>(sensors_[i].read_cost_us) * kSensorPollFullBudget
+                    + sensors_[i].period_us - 1) / sensors_[i].period_us;
+  }
+  return utilisation > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(utilisation);
+}
+
+void SensorPollScheduler::ResetStatistics() {
+  for (uint8_t i = 0; i < num_of_sensors_; i++) {
+    const uint32_t kPlannedJitter = sensors_[i].statistics.planned_jitter_us;
+    sensors_[i].statistics = {};
+    sensors_[i].statistics.planned_jitter_us = kPlannedJitter;
+  }
+}
@@ -0,0 +1,201 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_POLL_SCHEDULER_HPP_
+#define SENSOR_POLL_SCHEDULER_HPP_
+
+#include <stdint.h>
+#include <i2c_helper.hpp>
+#include "sensor_base.hpp"
+
+#ifdef __arm__
+#ifndef Arduino
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
+#else
+#include <atomic>
+#include <thread>
+#endif  // __arm__
+
+inline constexpr uint8_t kSensorPollMaxSensors = 8;
+inline constexpr uint8_t kSensorPollMaxSlots = 64;                  /**< Reads in one hyperperiod */
+inline constexpr uint32_t kSensorPollMaxHyperperiodUs = 1000000;
+inline constexpr uint8_t kSensorPollInvalidSensor = 0xFF;
+inline constexpr uint16_t kSensorPollFullBudget = 1000;             /**< Bus budget in 0.1% steps */
+
+enum SensorScheduleStatus {
+  kSensorScheduleOk = 0,
+  kSensorScheduleEmpty,             /**< No sensors added */
+  kSensorScheduleOverBudget,        /**< The reads need more bus time than the budget allows */
+  kSensorScheduleMissesDeadline,    /**< A read can not finish within its period */
+  kSensorScheduleTooLong,           /**< Hyperperiod or number of reads in it too large for the table */
+};
+
+struct SensorPollStatistics {
+  uint32_t reads;
+  uint32_t overruns;            /**< Reads that started a whole period or more after their slot */
+  uint32_t max_lateness_us;     /**< Worst start delay against the planned slot */
+  uint32_t max_duration_us;     /**< Longest read, compare with the read cost it was planned with */
+  uint32_t planned_jitter_us;   /**< Spread of the planned start times against the nominal period */
+};
+
+/**
+ * @brief Reads every sensor at its own rate from a static, rate-monotonic schedule
+ *
+ * BuildSchedule plays the non-preemptive reads through one hyperperiod, shortest period first,
+ * and stores the planned start time of every read. At run time the table is replayed against
+ * the clock, so every read starts at the same offset in every hyperperiod and only the jitter
+ * of the wake-up remains. Samples go to the sample buffer attached to each sensor.
+ *
+ * The clock and delay are injected, a simulated clock makes the Linux build deterministic.
+ */
+class SensorPollScheduler {
+ public:
+  /**
+   * @param delay Waits the given number of microseconds, e.g. vTaskDelay based on target
+   * @param bus_budget Share of the bus time the reads may take, in 0.1% steps
+   */
+  SensorPollScheduler(I2CClockFunction clock, I2CDelayFunction delay, uint16_t bus_budget = kSensorPollFullBudget) {
+    this->clock_ = clock;
+    this->delay_ = delay;
+    this->bus_budget_ = bus_budget;
+  }
+
+  ~SensorPollScheduler() {
+    Join();
+  }
+
+  /**
+   * @param rate_hz Target sample rate
+   * @param read_cost_us Bus time one read takes, e.g. taken from the I2C trace statistics
+   * @return Index of the sensor, or kSensorPollInvalidSensor when the table is full
+   *         or the sensor has no sample buffer attached to read into
+   */
+  uint8_t AddSensor(UniversalSensor *sensor, uint32_t rate_hz, uint32_t read_cost_us);
+
+  /**
+   * @brief Compute the schedule, call after the last AddSensor and before running
+   */
+  SensorScheduleStatus BuildSchedule();
+
+  /**
+   * @brief Run the read that is due
+   *
+   * @return Microseconds until the next read is due, 0 when a read was run
+   */
+  uint32_t RunOnce();
+
+  /**
+   * @brief Run reads and sleep in between until the clock passes end_us
+   */
+  void RunUntil(uint32_t end_us);
+
+  /**
+   * @brief Run reads and sleep in between until Stop is called
+   */
+  void Run();
+
+  void Stop() {
+    running_ = false;
+  }
+
+  /**
+   * @brief Run the scheduler in its own FreeRTOS task on target, or its own thread on Linux
+   *
+   * @return false when the task could not be created, or on Arduino which has no tasks
+   */
+  bool Start(uint16_t stack_depth, uint32_t priority);
+
+  /**
+   * @brief Stop the task or thread started by Start and wait until it has finished
+   *
+   * @note Returns after the read or delay the task is in, so at most one hyperperiod.
+   *       On FreeRTOS this takes a task notification of the calling task, never call it from the scheduler's own task.
+   */
+  void Join();
+
+  SensorPollStatistics GetStatistics(uint8_t sensor) const {
+    return sensors_[sensor].statistics;
+  }
+
+  /**
+   * @brief Bus time the schedule takes, in 0.1% steps
+   */
+  uint16_t GetUtilisation() const;
+
+  uint32_t GetHyperperiod() const {
+    return hyperperiod_us_;
+  }
+
+  void ResetStatistics();
+
+ private:
+  struct Sensor {
+    UniversalSensor *sensor;
+    uint32_t period_us;
+    uint32_t read_cost_us;
+    SensorPollStatistics statistics;
+  };
+
+  struct Slot {
+    uint32_t offset_us;     /**< Planned start in the hyperperiod */
+    uint8_t sensor;
+  };
+
+  I2CClockFunction clock_;
+  I2CDelayFunction delay_;
+  uint16_t bus_budget_;
+
+  Sensor sensors_[kSensorPollMaxSensors] = {};
+  uint8_t num_of_sensors_ = 0;
+
+  Slot slots_[kSensorPollMaxSlots] = {};
+  uint8_t num_of_slots_ = 0;
+  uint32_t hyperperiod_us_ = 0;
+
+  bool started_ = false;
+  uint32_t frame_start_us_ = 0;
+  uint8_t next_slot_ = 0;
+
+  void RunLoop();
+
+#ifdef __arm__
+  volatile bool running_ = false;
+#ifndef Arduino
+  TaskHandle_t task_ = nullptr;
+  TaskHandle_t joiner_ = nullptr;
+  static void Task(void *scheduler);
+#endif
+#else
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+#endif  // __arm__
+};
+
+#endif  // SENSOR_POLL_SCHEDULER_HPP_
@@ -0,0 +1,162 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_RING_BUFFER_HPP_
+#define SENSOR_RING_BUFFER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "sensor_helper.hpp"
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring over caller provided storage
+ *
+ * @note Exactly one context may push (a task, an ISR or a DMA completion handler)
+ *       and exactly one task may pop. Push and pop are wait-free and only need
+ *       atomic 32-bit loads and stores, so no compare-exchange support is needed.
+ *       Indices run freely and wrap at 32 bits, the capacity must be a power of two.
+ */
+template<typename T>
+class SpscRing {
+ public:
+  SpscRing(T *storage, uint32_t capacity) {
+    this->storage_ = storage;
+    this->mask_ = capacity - 1;
+  }
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  /**
+   * @brief Producer side: store one element
+   *
+   * @return false when the ring is full, the element is then counted as dropped
+   */
+  bool Push(const T &element) {
+    const uint32_t kHead = head_.load(std::memory_order_relaxed);
+    if (kHead - tail_.load(std::memory_order_acquire) > mask_) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    storage_[kHead & mask_] = element;
+    head_.store(kHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Producer side: store as many elements as fit, publishing them all at once
+   *
+   * @return Number of elements stored, the rest is counted as dropped
+   */
+  size_t PushBatch(const T *elements, size_t num_of_elements) {
+    const uint32_t kHead = head_.load(std::memory_order_relaxed);
+    const uint32_t kFree = mask_ + 1 - (kHead - tail_.load(std::memory_order_acquire));
+    const size_t kNumOfPushed = num_of_elements < kFree ? num_of_elements : kFree;
+    for (size_t i = 0; i < kNumOfPushed; i++) {
+      storage_[(kHead + i) & mask_] = elements[i];
+    }
+    head_.store(kHead + kNumOfPushed, std::memory_order_release);
+    if (kNumOfPushed != num_of_elements) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + (num_of_elements - kNumOfPushed),
+                     std::memory_order_relaxed);
+    }
+    return kNumOfPushed;
+  }
+
+  /**
+   * @brief Consumer side: take the oldest element
+   *
+   * @return false when the ring is empty
+   */
+  bool Pop(T *element) {
+    return PopBatch(element, 1) == 1;
+  }
+
+  /**
+   * @brief Consumer side: take up to max_elements of the oldest elements
+   *
+   * @return Number of elements copied to elements
+   */
+  size_t PopBatch(T *elements, size_t max_elements) {
+    const uint32_t kTail = tail_.load(std::memory_order_relaxed);
+    const uint32_t kAvailable = head_.load(std::memory_order_acquire) - kTail;
+    const size_t kNumOfPopped = max_elements < kAvailable ? max_elements : kAvailable;
+    for (size_t i = 0; i < kNumOfPopped; i++) {
+      elements[i] = storage_[(kTail + i) & mask_];
+    }
+    tail_.store(kTail + kNumOfPopped, std::memory_order_release);
+    return kNumOfPopped;
+  }
+
+  /**
+   * @brief Number of stored elements, exact only when called from the producer or consumer
+   */
+  size_t Size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  size_t Capacity() const {
+    return mask_ + 1;
+  }
+
+  /**
+   * @brief Elements rejected because the ring was full
+   */
+  uint32_t Dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  T *storage_;
+  uint32_t mask_;
+  std::atomic<uint32_t> head_{0};     // Written by the producer only
+  std::atomic<uint32_t> tail_{0};     // Written by the consumer only
+  std::atomic<uint32_t> dropped_{0};  // Written by the producer only
+};
+
+/**
+ * @brief SpscRing with its own storage for Capacity elements
+ */
+template<typename T, uint32_t Capacity>
+class SpscRingBuffer : public SpscRing<T> {
+  static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  SpscRingBuffer() : SpscRing<T>(storage_, Capacity) {}
+
+ private:
+  T storage_[Capacity];
+};
+
+typedef SpscRing<SensorData_t> SensorSampleRing;
+
+template<uint32_t Capacity>
+using SensorSampleBuffer = SpscRingBuffer<SensorData_t, Capacity>;
+
+#endif  // SENSOR_RING_BUFFER_HPP_
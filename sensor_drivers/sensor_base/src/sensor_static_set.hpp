@@ -0,0 +1,174 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_STATIC_SET_HPP_
+#define SENSOR_STATIC_SET_HPP_
+
+#include <stddef.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "sensor_base.hpp"
+
+/*
+ * A fixed set of concrete sensors that is polled without virtual calls.
+ *
+ * Every call is qualified with the concrete type (sensor.Sensor::GetSensorData()), which binds it
+ * at compile time, so small bodies such as GetSensorType inline into the polling loop.
+ * The sensors are still UniversalSensor objects: Get<I>() and GetSensors() hand them to code that
+ * uses the virtual interface.
+ */
+template <typename... Sensors>
+class StaticSensorSet {
+  static_assert((std::is_base_of_v<UniversalSensor, Sensors> && ...),
+                "StaticSensorSet takes UniversalSensor implementations");
+
+ public:
+  static constexpr size_t kNumOfSensors = sizeof...(Sensors);
+
+  /**
+   * @brief The sensor at index, with its concrete type
+   */
+  template <size_t Index>
+  auto &Get() {
+    return std::get<Index>(sensors_);
+  }
+
+  /**
+   * @brief Initialise all sensors
+   *
+   * @param handles One I2C driver per sensor, in the order of Sensors
+   */
+  void Initialize(I2CDriver *const (&handles)[kNumOfSensors]) {
+    ForEachIndexed([&](auto &sensor, size_t index) {
+      using Sensor = std::remove_reference_t<decltype(sensor)>;
+      sensor.Sensor::Initialize(handles[index]);
+    });
+  }
+
+  /**
+   * @brief Read one sample of every sensor
+   *
+   * @param samples Destination for kNumOfSensors samples, in the order of Sensors
+   */
+  void GetSensorData(SensorData_t *samples) {
+    ForEachIndexed([&](auto &sensor, size_t index) {
+      using Sensor = std::remove_reference_t<decltype(sensor)>;
+      samples[index] = sensor.Sensor::GetSensorData();
+    });
+  }
+
+  /**
+   * @brief Read a block of samples of the sensor at Index
+   *
+   * @note Uses the driver's own ReadSamples when it has one, otherwise loops over GetSensorData
+   */
+  template <size_t Index>
+  size_t ReadSamples(SensorData_t *samples, size_t max_samples) {
+    using Sensor = std::tuple_element_t<Index, std::tuple<Sensors...>>;
+    Sensor &sensor = std::get<Index>(sensors_);
+    if constexpr (HasOwnReadSamples<Sensor>()) {
+      return sensor.Sensor::ReadSamples(samples, max_samples);
+    } else {
+      for (size_t i = 0; i < max_samples; i++) {
+        samples[i] = sensor.Sensor::GetSensorData();
+      }
+      return max_samples;
+    }
+  }
+
+  /**
+   * @param types Destination for kNumOfSensors sensor types
+   */
+  void GetSensorTypes(uint8_t *types) {
+    ForEachIndexed([&](auto &sensor, size_t index) {
+      using Sensor = std::remove_reference_t<decltype(sensor)>;
+      types[index] = sensor.Sensor::GetSensorType();
+    });
+  }
+
+  /**
+   * @return Bit i set when sensor i answers
+   */
+  uint32_t Available() {
+    static_assert(kNumOfSensors <= 32, "Available() returns one bit per sensor");
+    uint32_t available = 0;
+    ForEachIndexed([&](auto &sensor, size_t index) {
+      using Sensor = std::remove_reference_t<decltype(sensor)>;
+      available |= static_cast<uint32_t>(sensor.Sensor::Available()) << index;
+    });
+    return available;
+  }
+
+  void Uninitialize() {
+    ForEach([](auto &sensor) {
+      using Sensor = std::remove_reference_t<decltype(sensor)>;
+      sensor.Sensor::Uninitialize();
+    });
+  }
+
+  /**
+   * @brief Call function(sensor) for every sensor, with the sensor's concrete type
+   */
+  template <typename Function>
+  void ForEach(Function &&function) {
+    std::apply([&](auto &...sensor) { (function(sensor), ...); }, sensors_);
+  }
+
+  /**
+   * @brief Adapter for code that works on the virtual interface
+   *
+   * @param sensors Destination for kNumOfSensors pointers, in the order of Sensors
+   */
+  void GetSensors(UniversalSensor **sensors) {
+    ForEachIndexed([&](auto &sensor, size_t index) {
+      sensors[index] = &sensor;
+    });
+  }
+
+ private:
+  std::tuple<Sensors...> sensors_;
+
+  template <typename Sensor>
+  static constexpr bool HasOwnReadSamples() {
+    // An inherited member keeps the class of its declaration in its pointer type
+    return !std::is_same_v<decltype(&Sensor::ReadSamples), size_t (UniversalSensor::*)(SensorData_t *, size_t)>;
+  }
+
+  template <typename Function>
+  void ForEachIndexed(Function &&function) {
+    ForEachIndexed(function, std::index_sequence_for<Sensors...>{});
+  }
+
+  template <typename Function, size_t... Index>
+  void ForEachIndexed(Function &function, std::index_sequence<Index...>) {
+    (function(std::get<Index>(sensors_), Index), ...);
+  }
+};
+
+#endif  // SENSOR_STATIC_SET_HPP_
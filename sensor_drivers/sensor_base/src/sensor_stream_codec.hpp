@@ -0,0 +1,360 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_STREAM_CODEC_HPP_
+#define SENSOR_STREAM_CODEC_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_helper.hpp"
+#include "sensor_wire_format.hpp"
+
+/*
+ * Streaming compression for the samples of one sensor. Every record starts with a tag byte:
+ *
+ *  keyframe  0x80
+ *            length of the wire record
+ *            the sample in the wire format of sensor_wire_format.hpp
+ *            CRC-8 over the length and the wire record
+ *  delta     bit 7 clear, bit 6 status follows, bit 5 fixed width elements, bit 4..0 zero
+ *            varint  sample_num - previous sample_num - 1
+ *            varint  timestamp_us - previous timestamp_us
+ *            [status]
+ *            elements: per channel the zig-zagged 16-bit delta to the previous sample,
+ *                      either as varints or as a width byte followed by count * width bits, LSB first
+ *
+ * Keyframes are sent every keyframe_interval records and whenever the sensor, element type
+ * or element count changes, so a receiver can join or resync at any keyframe. 0x80 is also a common
+ * varint byte, a candidate keyframe is only accepted when its length, CRC and wire record agree.
+ * Both sides only keep the previous sample, RAM use is fixed.
+ */
+inline constexpr uint8_t kSensorStreamKeyframeTag = 0x80;
+inline constexpr uint8_t kSensorStreamStatusFlag = 0x40;
+inline constexpr uint8_t kSensorStreamPackedFlag = 0x20;
+inline constexpr uint8_t kSensorStreamCrcInit = 0xFF;
+inline constexpr uint8_t kSensorStreamCrcPolynomial = 0x31;
+inline constexpr size_t kSensorStreamKeyframeOverhead = 3;
+inline constexpr size_t kSensorStreamMaxRecordSize = 1 + 5 + 5 + 1 + 3 * kMaxAmountOfSensorBytes;
+static_assert(kSensorStreamKeyframeOverhead + kSensorWireMaxSize <= kSensorStreamMaxRecordSize,
+              "A keyframe must fit kSensorStreamMaxRecordSize");
+static_assert(kSensorWireMaxSize <= 0xFF, "The keyframe length is a single byte");
+
+enum SensorStreamResult {
+  kSensorStreamSample,        /**< A sample was decoded */
+  kSensorStreamIncomplete,    /**< The record is not complete yet, call again with more data */
+  kSensorStreamSkipped,       /**< Not in sync, bytes were skipped while looking for a keyframe */
+};
+
+namespace sensor_stream {
+
+inline uint16_t ZigZag(int16_t value) {
+  return static_cast<uint16_t>((static_cast<uint16_t>(value) << 1) ^ static_cast<uint16_t>(value >> 15));
+}
+
+inline int16_t UnZigZag(uint16_t value) {
+  return static_cast<int16_t>((value >> 1) ^ static_cast<uint16_t>(-(value & 1)));
+}
+
+inline uint8_t *PutVarint(uint8_t *dest, uint32_t value) {
+  while (value >= 0x80) {
+    *dest++ = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  *dest++ = static_cast<uint8_t>(value);
+  return dest;
+}
+
+/**
+ * @return Pointer past the varint, or nullptr when it runs past end
+ */
+inline const uint8_t *GetVarint(const uint8_t *src, const uint8_t *end, uint32_t *value) {
+  *value = 0;
+  for (uint8_t shift = 0; shift < 35 && src < end; shift += 7) {
+    const uint8_t kByte = *src++;
+    *value |= static_cast<uint32_t>(kByte & 0x7F) << shift;
+    if ((kByte & 0x80) == 0) {
+      return src;
+    }
+  }
+  return nullptr;
+}
+
+inline uint8_t VarintSize(uint32_t value) {
+  uint8_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+inline uint8_t BitWidth(uint16_t value) {
+  uint8_t width = 0;
+  while (value != 0) {
+    value >>= 1;
+    width++;
+  }
+  return width;
+}
+
+inline uint8_t Crc8(const uint8_t *data, size_t num_of_bytes) {
+  uint8_t crc = kSensorStreamCrcInit;
+  for (size_t i = 0; i < num_of_bytes; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ kSensorStreamCrcPolynomial : crc << 1;
+    }
+  }
+  return crc;
+}
+
+inline bool SameLayout(const SensorData_t &a, const SensorData_t &b) {
+  return a.sensor_id == b.sensor_id && a.element_type == b.element_type && a.num_of_bytes == b.num_of_bytes;
+}
+
+}  // namespace sensor_stream
+
+class SensorStreamEncoder {
+ public:
+  explicit SensorStreamEncoder(uint16_t keyframe_interval) {
+    this->keyframe_interval_ = keyframe_interval;
+  }
+
+  /**
+   * @brief Make the next record a keyframe, e.g. after the receiver reported a loss
+   */
+  void ForceKeyframe() {
+    have_previous_ = false;
+  }
+
+  /**
+   * @brief Append the record for sample to dest
+   *
+   * @return Bytes written, 0 when dest is too small or the sample can not be encoded;
+   *         kSensorStreamMaxRecordSize bytes always fit any record
+   */
+  size_t Encode(const SensorData_t &sample, uint8_t *dest, size_t dest_size) {
+    using namespace sensor_stream;
+    if (!have_previous_ || records_since_keyframe_ + 1 >= keyframe_interval_
+        || !SameLayout(sample, previous_)) {
+      if (dest_size < kSensorStreamKeyframeOverhead) {
+        return 0;
+      }
+      const size_t kSize = SensorWireEncode(sample, dest + 2, dest_size - kSensorStreamKeyframeOverhead);
+      if (kSize == 0) {
+        return 0;
+      }
+      dest[0] = kSensorStreamKeyframeTag;
+      dest[1] = static_cast<uint8_t>(kSize);
+      dest[kSize + 2] = Crc8(dest + 1, kSize + 1);
+      Remember(sample, true);
+      return kSize + kSensorStreamKeyframeOverhead;
+    }
+
+    const uint8_t kCount = SensorElementCount(sample);
+    uint16_t deltas[kMaxAmountOfSensorBytes];
+    uint8_t varint_size = 0;
+    uint8_t width = 0;
+    for (uint8_t i = 0; i < kCount; i++) {
+      deltas[i] = ZigZag(static_cast<int16_t>(sample.buffer[i] - previous_.buffer[i]));
+      varint_size += VarintSize(deltas[i]);
+      const uint8_t kWidth = BitWidth(deltas[i]);
+      width = kWidth > width ? kWidth : width;
+    }
+    const uint8_t kPackedSize = 1 + (kCount * width + 7) / 8;
+    const bool kPacked = kPackedSize < varint_size;
+
+    uint8_t record[kSensorStreamMaxRecordSize];
+    uint8_t *write = record + 1;
+    record[0] = 0;
+    write = PutVarint(write, sample.sample_num - previous_.sample_num - 1);
+    write = PutVarint(write, sample.timestamp_us - previous_.timestamp_us);
+    if (sample.status != previous_.status) {
+      record[0] |= kSensorStreamStatusFlag;
+      *write++ = sample.status;
+    }
+    if (kPacked) {
+      record[0] |= kSensorStreamPackedFlag;
+      *write++ = width;
+      uint32_t bits = 0;
+      uint8_t num_of_bits = 0;
+      for (uint8_t i = 0; i < kCount; i++) {
+        bits |= static_cast<uint32_t>(deltas[i]) << num_of_bits;
+        num_of_bits += width;
+        while (num_of_bits >= 8) {
+          *write++ = bits & 0xFF;
+          bits >>= 8;
+          num_of_bits -= 8;
+        }
+      }
+      if (num_of_bits > 0) {
+        *write++ = bits & 0xFF;
+      }
+    } else {
+      for (uint8_t i = 0; i < kCount; i++) {
+        write = PutVarint(write, deltas[i]);
+      }
+    }
+
+    const size_t kSize = write - record;
+    if (kSize > dest_size) {
+      return 0;
+    }
+    for (size_t i = 0; i < kSize; i++) {
+      dest[i] = record[i];
+    }
+    Remember(sample, false);
+    return kSize;
+  }
+
+ private:
+  uint16_t keyframe_interval_;
+  uint16_t records_since_keyframe_ = 0;
+  bool have_previous_ = false;
+  SensorData_t previous_ = {};
+
+  void Remember(const SensorData_t &sample, bool keyframe) {
+    previous_ = sample;
+    have_previous_ = true;
+    records_since_keyframe_ = keyframe ? 0 : records_since_keyframe_ + 1;
+  }
+};
+
+class SensorStreamDecoder {
+ public:
+  /**
+   * @brief Drop the reference sample, e.g. after lost data, and wait for the next keyframe
+   */
+  void Reset() {
+    synced_ = false;
+  }
+
+  /**
+   * @brief Decode the record at the start of src
+   *
+   * @param consumed Number of bytes used from src, 0 when the record is incomplete
+   */
+  SensorStreamResult Decode(const uint8_t *src, size_t src_size, SensorData_t *sample, size_t *consumed) {
+    using namespace sensor_stream;
+    *consumed = 0;
+    if (src_size == 0) {
+      return kSensorStreamIncomplete;
+    }
+
+    if (src[0] == kSensorStreamKeyframeTag) {
+      if (src_size < 2) {
+        return kSensorStreamIncomplete;
+      }
+      const size_t kSize = src[1];
+      if (kSize >= kSensorWireHeaderSize && kSize <= kSensorWireMaxSize) {
+        if (src_size < kSize + kSensorStreamKeyframeOverhead) {
+          return kSensorStreamIncomplete;
+        }
+        SensorData_t keyframe = {};
+        if (Crc8(src + 1, kSize + 1) == src[kSize + 2] && SensorWireDecode(src + 2, kSize, &keyframe) == kSize) {
+          previous_ = keyframe;
+          synced_ = true;
+          *sample = keyframe;
+          *consumed = kSize + kSensorStreamKeyframeOverhead;
+          return kSensorStreamSample;
+        }
+      }
+      // A damaged keyframe, the records after it refer to a sample we never got
+      synced_ = false;
+    }
+    if (!synced_ || (src[0] & kSensorStreamKeyframeTag) != 0) {
+      *consumed = 1;
+      return kSensorStreamSkipped;
+    }
+
+    const uint8_t *end = src + src_size;
+    uint32_t sequence_gap;
+    uint32_t time_delta;
+    const uint8_t *read = GetVarint(src + 1, end, &sequence_gap);
+    if (read == nullptr || (read = GetVarint(read, end, &time_delta)) == nullptr) {
+      return kSensorStreamIncomplete;
+    }
+    SensorData_t decoded = previous_;
+    decoded.sample_num += sequence_gap + 1;
+    decoded.timestamp_us += time_delta;
+    if (src[0] & kSensorStreamStatusFlag) {
+      if (read == end) {
+        return kSensorStreamIncomplete;
+      }
+      decoded.status = *read++;
+    }
+
+    const uint8_t kCount = SensorElementCount(previous_);
+    if (src[0] & kSensorStreamPackedFlag) {
+      if (read == end) {
+        return kSensorStreamIncomplete;
+      }
+      const uint8_t kWidth = *read++;
+      if (kWidth > 16) {
+        synced_ = false;
+        *consumed = 1;
+        return kSensorStreamSkipped;
+      }
+      if (end - read < (kCount * kWidth + 7) / 8) {
+        return kSensorStreamIncomplete;
+      }
+      uint32_t bits = 0;
+      uint8_t num_of_bits = 0;
+      for (uint8_t i = 0; i < kCount; i++) {
+        while (num_of_bits < kWidth) {
+          bits |= static_cast<uint32_t>(*read++) << num_of_bits;
+          num_of_bits += 8;
+        }
+        const uint16_t kDelta = bits & ((1u << kWidth) - 1);
+        bits >>= kWidth;
+        num_of_bits -= kWidth;
+        decoded.buffer[i] = previous_.buffer[i] + UnZigZag(kDelta);
+      }
+    } else {
+      for (uint8_t i = 0; i < kCount; i++) {
+        uint32_t delta;
+        read = GetVarint(read, end, &delta);
+        if (read == nullptr) {
+          return kSensorStreamIncomplete;
+        }
+        decoded.buffer[i] = previous_.buffer[i] + UnZigZag(static_cast<uint16_t>(delta));
+      }
+    }
+
+    previous_ = decoded;
+    *sample = decoded;
+    *consumed = read - src;
+    return kSensorStreamSample;
+  }
+
+ private:
+  bool synced_ = false;
+  SensorData_t previous_ = {};
+};
+
+#endif  // SENSOR_STREAM_CODEC_HPP_
@@ -0,0 +1,76 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_TIMESTAMP_HPP_
+#define SENSOR_TIMESTAMP_HPP_
+
+#include <stdint.h>
+#include <i2c_helper.hpp>
+
+#ifdef __arm__
+#ifdef Arduino
+#include <Arduino.h>
+inline uint32_t SensorDefaultClock() {
+  return micros();
+}
+#else
+#include <FreeRTOS.h>
+#include <task.h>
+/* Tick resolution only, install a hardware timer with SetSensorClock for finer timestamps */
+inline uint32_t SensorDefaultClock() {
+  return xTaskGetTickCount() * (1000000 / configTICK_RATE_HZ);  // portTICK_PERIOD_MS is 0 above 1 kHz
+}
+#endif
+#else
+#include <chrono>
+inline uint32_t SensorDefaultClock() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif  // __arm__
+
+/* One clock for all sensors, so samples of different sensors can be aligned */
+inline I2CClockFunction sensor_clock = SensorDefaultClock;
+
+/**
+ * @brief Replace the clock used for sample timestamps, e.g. with a free running hardware timer
+ *
+ * @param clock Monotonic microsecond clock, wrapping at 32 bits
+ */
+inline void SetSensorClock(I2CClockFunction clock) {
+  sensor_clock = clock;
+}
+
+/**
+ * @brief Capture time for a sample, take it right after the bus transaction that read the sample
+ */
+inline uint32_t SensorTimestampUs() {
+  return sensor_clock();
+}
+
+#endif  // SENSOR_TIMESTAMP_HPP_
@@ -0,0 +1,145 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_WIRE_FORMAT_HPP_
+#define SENSOR_WIRE_FORMAT_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_helper.hpp"
+
+/*
+ * Packed, self-describing record for one SensorData_t, all fields little endian:
+ *
+ *  offset  size  field
+ *  0       1     descriptor: bit 7..6 format version, bit 5..4 element type, bit 3..0 element count
+ *  1       2     sensor_id
+ *  3       4     sample_num
+ *  7       4     timestamp_us
+ *  11      1     status
+ *  12      n     elements, 1 or 2 bytes each depending on the element type
+ *
+ * A one value compression sample takes 13 bytes instead of the 32 of the struct.
+ */
+inline constexpr uint8_t kSensorWireVersion = 1;
+inline constexpr size_t kSensorWireHeaderSize = 12;
+inline constexpr size_t kSensorWireMaxSize = kSensorWireHeaderSize + 2 * kMaxAmountOfSensorBytes;
+
+constexpr uint8_t SensorElementSize(uint8_t element_type) {
+  return element_type == kSensorElementU8 ? 1 : 2;
+}
+
+/**
+ * @return Number of elements in the sample, num_of_bytes divided by the element size
+ */
+constexpr uint8_t SensorElementCount(const SensorData_t &sample) {
+  return sample.num_of_bytes / SensorElementSize(sample.element_type);
+}
+
+/**
+ * @return Size of the encoded record, or 0 when the sample can not be encoded
+ */
+inline size_t SensorWireEncodedSize(const SensorData_t &sample) {
+  if (sample.element_type > kSensorElementU8 || SensorElementCount(sample) > kMaxAmountOfSensorBytes) {
+    return 0;
+  }
+  return kSensorWireHeaderSize + SensorElementCount(sample) * SensorElementSize(sample.element_type);
+}
+
+/**
+ * @brief Encode a sample straight into dest
+ *
+ * @return Number of bytes written, or 0 when dest is too small or the sample can not be encoded
+ */
+inline size_t SensorWireEncode(const SensorData_t &sample, uint8_t *dest, size_t dest_size) {
+  const size_t kSize = SensorWireEncodedSize(sample);
+  if (kSize == 0 || kSize > dest_size) {
+    return 0;
+  }
+  const uint8_t kCount = SensorElementCount(sample);
+  dest[0] = (kSensorWireVersion << 6) | (sample.element_type << 4) | kCount;
+  dest[1] = sample.sensor_id & 0xFF;
+  dest[2] = sample.sensor_id >> 8;
+  for (uint8_t i = 0; i < 4; i++) {
+    dest[3 + i] = (sample.sample_num >> (8 * i)) & 0xFF;
+    dest[7 + i] = (sample.timestamp_us >> (8 * i)) & 0xFF;
+  }
+  dest[11] = sample.status;
+
+  uint8_t *payload = dest + kSensorWireHeaderSize;
+  if (sample.element_type == kSensorElementU8) {
+    for (uint8_t i = 0; i < kCount; i++) {
+      payload[i] = sample.buffer[i] & 0xFF;
+    }
+  } else {
+    for (uint8_t i = 0; i < kCount; i++) {
+      payload[2 * i] = sample.buffer[i] & 0xFF;
+      payload[2 * i + 1] = sample.buffer[i] >> 8;
+    }
+  }
+  return kSize;
+}
+
+/**
+ * @brief Decode one record from the start of src
+ *
+ * @return Number of bytes consumed, or 0 when src does not start with a complete valid record
+ */
+inline size_t SensorWireDecode(const uint8_t *src, size_t src_size, SensorData_t *sample) {
+  if (src_size < kSensorWireHeaderSize || (src[0] >> 6) != kSensorWireVersion) {
+    return 0;
+  }
+  const uint8_t kType = (src[0] >> 4) & 0x03;
+  const uint8_t kCount = src[0] & 0x0F;
+  if (kType > kSensorElementU8 || kCount > kMaxAmountOfSensorBytes) {
+    return 0;
+  }
+  const size_t kSize = kSensorWireHeaderSize + kCount * SensorElementSize(kType);
+  if (src_size < kSize) {
+    return 0;
+  }
+
+  sample->element_type = kType;
+  sample->num_of_bytes = kCount * SensorElementSize(kType);
+  sample->sensor_id = src[1] | (src[2] << 8);
+  sample->sample_num = 0;
+  sample->timestamp_us = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    sample->sample_num |= static_cast<uint32_t>(src[3 + i]) << (8 * i);
+    sample->timestamp_us |= static_cast<uint32_t>(src[7 + i]) << (8 * i);
+  }
+  sample->status = src[11];
+
+  const uint8_t *payload = src + kSensorWireHeaderSize;
+  for (uint8_t i = 0; i < kCount; i++) {
+    sample->buffer[i] = kType == kSensorElementU8 ? payload[i] : (payload[2 * i] | (payload[2 * i + 1] << 8));
+  }
+  return kSize;
+}
+
+#endif  // SENSOR_WIRE_FORMAT_HPP_
@@ -0,0 +1,185 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <sensor_enumerator.hpp>
+#include <stub_sensor.hpp>
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace {
+
+// Bus with parts at fixed addresses, a part answers its ID register with id
+class FakeBus {
+ public:
+  explicit FakeBus(NiceMock<I2CDriver> *handle) {
+    ON_CALL(*handle, ChangeAddress(_)).WillByDefault(Invoke([this](uint8_t addr) { addr_ = addr; }));
+    ON_CALL(*handle, SensorAvailable()).WillByDefault(Invoke([this] { probes_++; return ids_[addr_] != 0; }));
+    ON_CALL(*handle, ReadReg(_, _)).WillByDefault(Invoke([this](uint16_t, uint8_t *data) {
+      *data = ids_[addr_];
+      return ids_[addr_] != 0 ? 0 : 2;
+    }));
+  }
+
+  uint8_t ids_[128] = {};
+  uint8_t addr_ = 0;
+  uint32_t probes_ = 0;
+};
+
+template <uint8_t Id>
+class ProbedSensor : public StubSensor<Id> {
+ public:
+  static bool Identify(I2CDriver *handle) {
+    uint8_t id = 0;
+    return handle->ReadReg(0x00, &id) == 0 && id == Id;
+  }
+  void Initialize(I2CDriver *handle) override {
+    StubSensor<Id>::Initialize(handle);
+    initialisations_++;
+  }
+  const bool Available() override {
+    return this->handle_ != nullptr;
+  }
+
+  uint32_t initialisations_ = 0;
+};
+
+class RangeSensor final : public ProbedSensor<0xB4> {
+ public:
+  static constexpr uint8_t kProbeAddresses[] = {0x29};
+};
+
+class ImuSensor final : public ProbedSensor<0x24> {
+ public:
+  static constexpr uint8_t kProbeAddresses[] = {0x68, 0x69};
+  void SetI2CAddress(uint8_t i2c_addr) {
+    i2c_addr_ = i2c_addr;
+  }
+  uint8_t i2c_addr_ = 0;
+};
+
+typedef SensorEnumerator<2, RangeSensor, ImuSensor> TestEnumerator;
+
+}  // namespace
+
+TEST(SensorEnumeratorTest, findsAndInitialisesIdentifiedSensors) {
+  NiceMock<I2CDriver> port;
+  FakeBus bus(&port);
+  bus.ids_[0x69] = 0x24;
+  bus.ids_[0x68] = 0x77;    // answers, but is not a BMI270
+
+  TestEnumerator enumerator;
+  const SensorScanResult kResult = enumerator.Scan(&port);
+  EXPECT_EQ(kResult.added, 1);
+  EXPECT_EQ(kResult.removed, 0);
+  ASSERT_EQ(enumerator.NumOfSensors(), 1u);
+  EXPECT_EQ(enumerator.GetSensor(0)->GetSensorType(), 0x24);
+  EXPECT_TRUE(enumerator.GetSensor(0)->Available());
+  EXPECT_EQ(static_cast<ImuSensor *>(enumerator.GetSensor(0))->i2c_addr_, 0x69);
+  EXPECT_EQ(enumerator.GetHandle(0), &port);
+  EXPECT_EQ(enumerator.GetSensor(1), nullptr);
+  // The driver talks to the address the handle is left at
+  EXPECT_EQ(bus.addr_, 0x69);
+}
+
+TEST(SensorEnumeratorTest, stopsAtFirstSensorOnAPort) {
+  NiceMock<I2CDriver> port;
+  FakeBus bus(&port);
+  bus.ids_[0x29] = 0xB4;
+  bus.ids_[0x69] = 0x24;
+
+  // The drivers only select their address in Initialize, a second one would talk to the first's address
+  TestEnumerator enumerator;
+  EXPECT_EQ(enumerator.Scan(&port).added, 1);
+  EXPECT_EQ(enumerator.Scan(&port).added, 0);
+  ASSERT_EQ(enumerator.NumOfSensors(), 1u);
+  EXPECT_EQ(enumerator.GetSensor(0)->GetSensorType(), 0xB4);
+  EXPECT_EQ(bus.addr_, 0x29);
+
+  // Unplugging it frees the port for the other part
+  bus.ids_[0x29] = 0;
+  const SensorScanResult kResult = enumerator.Scan(&port);
+  EXPECT_EQ(kResult.removed, 1);
+  EXPECT_EQ(kResult.added, 1);
+  EXPECT_EQ(enumerator.GetSensor(0)->GetSensorType(), 0x24);
+  EXPECT_EQ(bus.addr_, 0x69);
+}
+
+TEST(SensorEnumeratorTest, steadyRescanOnlyProbesAddresses) {
+  NiceMock<I2CDriver> port;
+  FakeBus bus(&port);
+  bus.ids_[0x29] = 0xB4;
+  TestEnumerator enumerator;
+  enumerator.Scan(&port);
+
+  // One empty write to the known address, no register reads, no initialisation
+  bus.probes_ = 0;
+  EXPECT_CALL(port, ReadReg(_, _)).Times(0);
+  const SensorScanResult kResult = enumerator.Scan(&port);
+  EXPECT_EQ(kResult.added + kResult.removed, 0);
+  EXPECT_EQ(bus.probes_, 1u);
+  EXPECT_EQ(static_cast<RangeSensor *>(enumerator.GetSensor(0))->initialisations_, 1u);
+}
+
+TEST(SensorEnumeratorTest, hotPlugReturnsSensorsToThePool) {
+  NiceMock<I2CDriver> port_a;
+  NiceMock<I2CDriver> port_b;
+  NiceMock<I2CDriver> port_c;
+  FakeBus bus_a(&port_a);
+  FakeBus bus_b(&port_b);
+  FakeBus bus_c(&port_c);
+  bus_a.ids_[0x29] = 0xB4;
+  bus_b.ids_[0x29] = 0xB4;
+  bus_c.ids_[0x29] = 0xB4;
+
+  TestEnumerator enumerator;
+  EXPECT_EQ(enumerator.Scan(&port_a).added, 1);
+  EXPECT_EQ(enumerator.Scan(&port_b).added, 1);
+  // Both pool objects are in use
+  EXPECT_EQ(enumerator.Scan(&port_c).added, 0);
+
+  RangeSensor *unplugged = static_cast<RangeSensor *>(enumerator.GetSensor(0));
+  bus_a.ids_[0x29] = 0;
+  // The shadow copy of the unplugged sensor is dropped from its port
+  EXPECT_CALL(port_a, AttachRegisterCache(nullptr));
+  const SensorScanResult kResult = enumerator.Scan(&port_a);
+  EXPECT_EQ(kResult.removed, 1);
+  EXPECT_FALSE(unplugged->Available());
+  ASSERT_EQ(enumerator.NumOfSensors(), 1u);
+  EXPECT_EQ(enumerator.GetHandle(0), &port_b);
+
+  EXPECT_EQ(enumerator.Scan(&port_c).added, 1);
+  EXPECT_EQ(enumerator.GetSensor(1), unplugged);
+  EXPECT_EQ(enumerator.GetHandle(1), &port_c);
+}
@@ -0,0 +1,192 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sensor_poll_scheduler.hpp>
+#include <stub_sensor.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint32_t> sim_now_us{0};
+
+uint32_t SimulatedClock() {
+  return sim_now_us;
+}
+
+void SimulatedDelay(uint32_t delay_us) {
+  sim_now_us += delay_us;
+}
+
+// A read takes cost_us of simulated bus time
+class TimedSensor : public StubSensor<> {
+ public:
+  explicit TimedSensor(uint32_t cost_us) {
+    cost_us_ = cost_us;
+    AttachSampleBuffer(&samples_);
+  }
+  SensorData_t GetSensorData() override {
+    SensorData_t sample = {};
+    sample.timestamp_us = sim_now_us;
+    starts_.push_back(sample.timestamp_us);
+    sim_now_us += cost_us_;
+    return sample;
+  }
+
+  uint32_t cost_us_;
+  std::vector<uint32_t> starts_;
+  SensorSampleBuffer<2048> samples_;
+};
+
+}  // namespace
+
+TEST(SensorPollSchedulerTest, readsEverySensorAtItsRate) {
+  sim_now_us = 5;
+  TimedSensor sdp810(300);
+  TimedSensor vl6180x(400);
+  TimedSensor ads7138(500);
+  TimedSensor bmi270(600);
+  SensorPollScheduler scheduler(SimulatedClock, SimulatedDelay, 800);
+  // Added in no particular order, the schedule goes by rate
+  EXPECT_EQ(scheduler.AddSensor(&vl6180x, 100, vl6180x.cost_us_), 0);
+  EXPECT_EQ(scheduler.AddSensor(&sdp810, 500, sdp810.cost_us_), 1);
+  EXPECT_EQ(scheduler.AddSensor(&ads7138, 200, ads7138.cost_us_), 2);
+  EXPECT_EQ(scheduler.AddSensor(&bmi270, 100, bmi270.cost_us_), 3);
+  ASSERT_EQ(scheduler.BuildSchedule(), kSensorScheduleOk);
+  EXPECT_EQ(scheduler.GetHyperperiod(), 10000u);
+  EXPECT_EQ(scheduler.GetUtilisation(), 150 + 40 + 100 + 60);
+
+  scheduler.RunUntil(sim_now_us + 1000000);
+  EXPECT_EQ(sdp810.samples_.Size(), 500u);
+  EXPECT_EQ(vl6180x.samples_.Size(), 100u);
+  EXPECT_EQ(ads7138.samples_.Size(), 200u);
+  EXPECT_EQ(bmi270.samples_.Size(), 100u);
+
+  // The fastest sensor is never blocked, every read is exactly one period after the previous one
+  EXPECT_EQ(scheduler.GetStatistics(1).planned_jitter_us, 0u);
+  for (size_t i = 1; i < sdp810.starts_.size(); i++) {
+    ASSERT_EQ(sdp810.starts_[i] - sdp810.starts_[i - 1], 2000u) << "read " << i;
+  }
+  // Slower sensors repeat the same offsets every hyperperiod
+  for (size_t i = 2; i < ads7138.starts_.size(); i++) {
+    ASSERT_EQ(ads7138.starts_[i] - ads7138.starts_[i - 2], 10000u) << "read " << i;
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    EXPECT_EQ(scheduler.GetStatistics(i).overruns, 0u);
+    EXPECT_EQ(scheduler.GetStatistics(i).max_lateness_us, 0u);
+  }
+  EXPECT_EQ(scheduler.GetStatistics(3).max_duration_us, 600u);
+}
+
+TEST(SensorPollSchedulerTest, rejectsSchedulesThatDoNotFit) {
+  TimedSensor fast(400);
+  TimedSensor slow(1700);
+  TimedSensor odd(10);
+
+  SensorPollScheduler empty(SimulatedClock, SimulatedDelay);
+  EXPECT_EQ(empty.BuildSchedule(), kSensorScheduleEmpty);
+
+  SensorPollScheduler tight_budget(SimulatedClock, SimulatedDelay, 300);
+  tight_budget.AddSensor(&fast, 1000, fast.cost_us_);
+  EXPECT_EQ(tight_budget.BuildSchedule(), kSensorScheduleOverBudget);
+
+  // Fits the bus, but the slow read blocks the fast sensor past its next release
+  SensorPollScheduler blocking(SimulatedClock, SimulatedDelay);
+  blocking.AddSensor(&fast, 1000, fast.cost_us_);
+  blocking.AddSensor(&slow, 50, slow.cost_us_);
+  EXPECT_EQ(blocking.BuildSchedule(), kSensorScheduleMissesDeadline);
+
+  SensorPollScheduler coprime(SimulatedClock, SimulatedDelay);
+  coprime.AddSensor(&fast, 6, fast.cost_us_);
+  coprime.AddSensor(&odd, 7, odd.cost_us_);
+  EXPECT_EQ(coprime.BuildSchedule(), kSensorScheduleTooLong);
+
+  EXPECT_EQ(coprime.AddSensor(&odd, 0, odd.cost_us_), kSensorPollInvalidSensor);
+}
+
+TEST(SensorPollSchedulerTest, onlyCountsReadsIntoASampleBuffer) {
+  sim_now_us = 0;
+  TimedSensor attached(300);
+  TimedSensor detached(300);
+  detached.AttachSampleBuffer(nullptr);
+  SensorPollScheduler scheduler(SimulatedClock, SimulatedDelay);
+  EXPECT_EQ(scheduler.AddSensor(&detached, 100, detached.cost_us_), kSensorPollInvalidSensor);
+  ASSERT_EQ(scheduler.AddSensor(&attached, 100, attached.cost_us_), 0);
+  ASSERT_EQ(scheduler.BuildSchedule(), kSensorScheduleOk);
+
+  scheduler.RunUntil(sim_now_us + 100000);
+  EXPECT_EQ(scheduler.GetStatistics(0).reads, 10u);
+  // Detaching later stops the reads and the count
+  attached.AttachSampleBuffer(nullptr);
+  scheduler.RunUntil(sim_now_us + 100000);
+  EXPECT_EQ(scheduler.GetStatistics(0).reads, 10u);
+  EXPECT_EQ(attached.starts_.size(), 10u);
+}
+
+TEST(SensorPollSchedulerTest, reportsOverrunsWhenReadsTakeLongerThanPlanned) {
+  sim_now_us = 0;
+  TimedSensor sdp810(300);
+  TimedSensor vl6180x(400);
+  SensorPollScheduler scheduler(SimulatedClock, SimulatedDelay);
+  scheduler.AddSensor(&sdp810, 500, sdp810.cost_us_);
+  scheduler.AddSensor(&vl6180x, 100, vl6180x.cost_us_);
+  ASSERT_EQ(scheduler.BuildSchedule(), kSensorScheduleOk);
+
+  // The VL6180X turns out to stretch its clock far beyond the planned read time
+  vl6180x.cost_us_ = 4500;
+  scheduler.RunUntil(100000);
+  EXPECT_GT(scheduler.GetStatistics(0).overruns, 0u);
+  EXPECT_GE(scheduler.GetStatistics(0).max_lateness_us, 2000u);
+  EXPECT_EQ(scheduler.GetStatistics(1).max_duration_us, 4500u);
+
+  scheduler.ResetStatistics();
+  EXPECT_EQ(scheduler.GetStatistics(0).overruns, 0u);
+}
+
+TEST(SensorPollSchedulerTest, runsInItsOwnThread) {
+  sim_now_us = 0;
+  TimedSensor sdp810(300);
+  SensorPollScheduler scheduler(SimulatedClock, SimulatedDelay);
+  scheduler.AddSensor(&sdp810, 500, sdp810.cost_us_);
+  ASSERT_EQ(scheduler.BuildSchedule(), kSensorScheduleOk);
+
+  ASSERT_TRUE(scheduler.Start(256, 1));
+  EXPECT_FALSE(scheduler.Start(256, 1));
+  while (sdp810.samples_.Size() < 10) {
+    std::this_thread::yield();
+  }
+  scheduler.Join();
+
+  SensorData_t samples[10];
+  ASSERT_EQ(sdp810.samples_.PopBatch(samples, 10), 10u);
+  for (uint8_t i = 1; i < 10; i++) {
+    EXPECT_EQ(samples[i].timestamp_us - samples[i - 1].timestamp_us, 2000u);
+  }
+}
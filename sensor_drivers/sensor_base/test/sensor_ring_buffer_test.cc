@@ -0,0 +1,207 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <sensor_base.hpp>
+#include <sensor_ring_buffer.hpp>
+#include <stub_sensor.hpp>
+#include <thread>
+
+namespace {
+
+SensorData_t MakeSample(uint32_t sequence) {
+  SensorData_t sample = {};
+  sample.sample_num = sequence;
+  sample.timestamp_us = sequence * 3;
+  sample.num_of_bytes = kMaxAmountOfSensorBytes;
+  for (uint8_t i = 0; i < kMaxAmountOfSensorBytes; i++) {
+    sample.buffer[i] = static_cast<uint16_t>(sequence + i);
+  }
+  return sample;
+}
+
+// A torn copy shows up as a buffer that does not belong to its sequence number
+bool SampleIsIntact(const SensorData_t &sample) {
+  if (sample.timestamp_us != sample.sample_num * 3) {
+    return false;
+  }
+  for (uint8_t i = 0; i < kMaxAmountOfSensorBytes; i++) {
+    if (sample.buffer[i] != static_cast<uint16_t>(sample.sample_num + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class CountingSensor : public StubSensor<> {
+ public:
+  SensorData_t GetSensorData() override {
+    return MakeSample(next_++);
+  }
+
+ private:
+  uint32_t next_ = 0;
+};
+
+}  // namespace
+
+TEST(SensorRingBufferTest, popsInPushOrderAndCountsDrops) {
+  SensorSampleBuffer<4> ring;
+  for (uint32_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(ring.Push(MakeSample(i)));
+  }
+  EXPECT_FALSE(ring.Push(MakeSample(4)));
+  EXPECT_EQ(ring.Dropped(), 1u);
+  EXPECT_EQ(ring.Size(), 4u);
+
+  SensorData_t sample;
+  for (uint32_t i = 0; i < 4; i++) {
+    ASSERT_TRUE(ring.Pop(&sample));
+    EXPECT_EQ(sample.sample_num, i);
+  }
+  EXPECT_FALSE(ring.Pop(&sample));
+}
+
+TEST(SensorRingBufferTest, batchesWrapAround) {
+  SensorSampleBuffer<8> ring;
+  SensorData_t samples[8];
+  for (uint32_t i = 0; i < 8; i++) {
+    samples[i] = MakeSample(i);
+  }
+  EXPECT_EQ(ring.PushBatch(samples, 6), 6u);
+  EXPECT_EQ(ring.PopBatch(samples, 5), 5u);
+  // Head is at 6, this batch runs over the end of the storage
+  for (uint32_t i = 0; i < 8; i++) {
+    samples[i] = MakeSample(6 + i);
+  }
+  EXPECT_EQ(ring.PushBatch(samples, 8), 7u);
+  EXPECT_EQ(ring.Dropped(), 1u);
+
+  SensorData_t popped[8];
+  ASSERT_EQ(ring.PopBatch(popped, 8), 8u);
+  for (uint32_t i = 0; i < 8; i++) {
+    EXPECT_EQ(popped[i].sample_num, 5 + i);
+    EXPECT_TRUE(SampleIsIntact(popped[i]));
+  }
+}
+
+TEST(SensorRingBufferTest, threadedProducerLosesNothing) {
+  const uint32_t kNumOfSamples = 1000000;
+  SensorSampleBuffer<64> ring;
+
+  std::thread producer([&ring]() {
+    for (uint32_t i = 0; i < kNumOfSamples; i++) {
+      while (!ring.Push(MakeSample(i))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  bool intact = true;
+  SensorData_t popped[16];
+  while (expected < kNumOfSamples) {
+    const size_t kNumOfPopped = ring.PopBatch(popped, 16);
+    if (kNumOfPopped == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < kNumOfPopped; i++) {
+      intact &= popped[i].sample_num == expected && SampleIsIntact(popped[i]);
+      expected++;
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(intact);
+  EXPECT_EQ(ring.Size(), 0u);
+}
+
+TEST(SensorRingBufferTest, threadedOverrunOnlyDropsNewSamples) {
+  const uint32_t kNumOfSamples = 500000;
+  SensorSampleBuffer<16> ring;
+  std::atomic<bool> done{false};
+
+  // Like an ISR the producer never waits, samples that do not fit are dropped
+  std::thread producer([&ring, &done]() {
+    for (uint32_t i = 0; i < kNumOfSamples; i++) {
+      ring.Push(MakeSample(i));
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t num_of_popped = 0;
+  int64_t last = -1;
+  bool ordered = true;
+  SensorData_t popped[4];
+  for (;;) {
+    const bool kDone = done.load(std::memory_order_acquire);
+    const size_t kNumOfPopped = ring.PopBatch(popped, 4);
+    for (size_t i = 0; i < kNumOfPopped; i++) {
+      ordered &= static_cast<int64_t>(popped[i].sample_num) > last && SampleIsIntact(popped[i]);
+      last = popped[i].sample_num;
+    }
+    num_of_popped += kNumOfPopped;
+    if (kNumOfPopped == 0) {
+      if (kDone) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(num_of_popped + ring.Dropped(), kNumOfSamples);
+}
+
+TEST(SensorRingBufferTest, sensorFillsAttachedBuffer) {
+  CountingSensor sensor;
+  SensorSampleBuffer<8> ring;
+  EXPECT_EQ(sensor.FillSampleBuffer(4), 0u);
+
+  sensor.AttachSampleBuffer(&ring);
+  EXPECT_EQ(sensor.FillSampleBuffer(3), 3u);
+  EXPECT_EQ(sensor.FillSampleBuffer(kSensorFillBlockSize + 4), 5u);
+  EXPECT_EQ(ring.Dropped(), 3u);
+
+  SensorData_t popped[8];
+  ASSERT_EQ(ring.PopBatch(popped, 8), 8u);
+  EXPECT_EQ(popped[7].sample_num, 7u);
+}
+
+int main(int argc, char **argv) {
+  // ::testing::InitGoogleTest(&argc, argv);
+  // if you plan to use GMock, replace the line above with
+  ::testing::InitGoogleMock(&argc, argv);
+
+  if (RUN_ALL_TESTS()) {}
+
+  // Always return zero-code and allow PlatformIO to parse results
+  return 0;
+}
@@ -0,0 +1,118 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+/*
+ * Cost of polling a sensor set through the virtual UniversalSensor interface versus StaticSensorSet.
+ *
+ * Both loops read every sensor and its type, the sensors are stand-ins with the tiny bodies typical
+ * for the drivers, so the numbers show the dispatch cost and not the I2C transfers.
+ * The code size of each polling loop is taken from its own linker section (ELF targets only).
+ */
+
+#include <sensor_static_set.hpp>
+#include <stub_sensor.hpp>
+#include <chrono>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SENSOR_BENCHMARK_CYCLES() __rdtsc()
+#endif
+
+#if defined(__ELF__) && defined(__GNUC__)
+#define SENSOR_BENCHMARK_SECTION(name) __attribute__((noinline, section(#name)))
+extern "C" const char __start_poll_virtual[], __stop_poll_virtual[];
+extern "C" const char __start_poll_static[], __stop_poll_static[];
+#else
+#define SENSOR_BENCHMARK_SECTION(name) __attribute__((noinline))
+#endif
+
+namespace {
+
+inline constexpr uint32_t kRounds = 2000000;
+
+typedef StaticSensorSet<StubSensor<1>, StubSensor<2>, StubSensor<3>, StubSensor<4>> BenchmarkSet;
+
+SENSOR_BENCHMARK_SECTION(poll_virtual) uint32_t PollVirtual(UniversalSensor *const *sensors, size_t count) {
+  uint32_t checksum = 0;
+  for (size_t i = 0; i < count; i++) {
+    const SensorData_t kSample = sensors[i]->GetSensorData();
+    checksum += kSample.buffer[0] + sensors[i]->GetSensorType();
+  }
+  return checksum;
+}
+
+SENSOR_BENCHMARK_SECTION(poll_static) uint32_t PollStatic(BenchmarkSet *sensors) {
+  uint32_t checksum = 0;
+  sensors->ForEach([&](auto &sensor) {
+    using Sensor = std::remove_reference_t<decltype(sensor)>;
+    const SensorData_t kSample = sensor.Sensor::GetSensorData();
+    checksum += kSample.buffer[0] + sensor.Sensor::GetSensorType();
+  });
+  return checksum;
+}
+
+template <typename Poll>
+void Run(const char *name, size_t code_size, Poll poll) {
+  volatile uint32_t checksum = 0;
+#ifdef SENSOR_BENCHMARK_CYCLES
+  const uint64_t kCyclesStart = SENSOR_BENCHMARK_CYCLES();
+#endif
+  const auto kStart = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < kRounds; round++) {
+    checksum = checksum + poll();
+  }
+  const auto kEnd = std::chrono::steady_clock::now();
+  const double kSamples = static_cast<double>(kRounds) * BenchmarkSet::kNumOfSensors;
+  std::printf("%-8s %5zu B code  %6.2f ns/sample", name, code_size,
+              std::chrono::duration<double, std::nano>(kEnd - kStart).count() / kSamples);
+#ifdef SENSOR_BENCHMARK_CYCLES
+  std::printf("  %6.2f cycles/sample", (SENSOR_BENCHMARK_CYCLES() - kCyclesStart) / kSamples);
+#endif
+  std::printf("\n");
+}
+
+}  // namespace
+
+int main() {
+  BenchmarkSet sensors;
+  UniversalSensor *adapters[BenchmarkSet::kNumOfSensors];
+  sensors.GetSensors(adapters);
+  // Keep the compiler from resolving the virtual calls through the known array contents
+  UniversalSensor **volatile opaque = adapters;
+
+  size_t virtual_size = 0;
+  size_t static_size = 0;
+#if defined(__ELF__) && defined(__GNUC__)
+  virtual_size = __stop_poll_virtual - __start_poll_virtual;
+  static_size = __stop_poll_static - __start_poll_static;
+#endif
+  Run("virtual", virtual_size, [&] { return PollVirtual(opaque, BenchmarkSet::kNumOfSensors); });
+  Run("static", static_size, [&] { return PollStatic(&sensors); });
+  return 0;
+}
@@ -0,0 +1,98 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sensor_static_set.hpp>
+#include <stub_sensor.hpp>
+
+namespace {
+
+typedef StubSensor<0x10> FakeSensor;
+
+class BurstSensor final : public StubSensor<0x20> {
+ public:
+  size_t ReadSamples(SensorData_t *samples, size_t max_samples) override {
+    bursts_++;
+    return StubSensor::ReadSamples(samples, max_samples < 2 ? max_samples : 2);
+  }
+
+  uint32_t bursts_ = 0;
+};
+
+}  // namespace
+
+TEST(SensorStaticSetTest, visitsSensorsInDeclarationOrder) {
+  StaticSensorSet<FakeSensor, BurstSensor, FakeSensor> sensors;
+  EXPECT_EQ(sensors.kNumOfSensors, 3u);
+
+  I2CDriver *const kHandles[3] = {reinterpret_cast<I2CDriver *>(0x10), reinterpret_cast<I2CDriver *>(0x20),
+                                  reinterpret_cast<I2CDriver *>(0x30)};
+  sensors.Initialize(kHandles);
+  EXPECT_EQ(sensors.Get<0>().handle_, kHandles[0]);
+  EXPECT_EQ(sensors.Get<1>().handle_, kHandles[1]);
+  EXPECT_EQ(sensors.Get<2>().handle_, kHandles[2]);
+
+  uint8_t types[3];
+  sensors.GetSensorTypes(types);
+  EXPECT_EQ(types[0], 0x10);
+  EXPECT_EQ(types[1], 0x20);
+  EXPECT_EQ(types[2], 0x10);
+
+  SensorData_t samples[3];
+  sensors.GetSensorData(samples);
+  sensors.GetSensorData(samples);
+  EXPECT_EQ(samples[1].sensor_id, 0x20);
+  EXPECT_EQ(samples[2].sample_num, 2u);
+
+  sensors.Get<2>().available_ = false;
+  EXPECT_EQ(sensors.Available(), 0b011u);
+
+  sensors.Uninitialize();
+  EXPECT_EQ(sensors.Get<1>().handle_, nullptr);
+}
+
+TEST(SensorStaticSetTest, readSamplesPrefersTheDriverBurstRead) {
+  StaticSensorSet<FakeSensor, BurstSensor> sensors;
+  SensorData_t samples[4];
+  EXPECT_EQ(sensors.ReadSamples<0>(samples, 4), 4u);
+  EXPECT_EQ(samples[3].sample_num, 4u);
+  EXPECT_EQ(sensors.ReadSamples<1>(samples, 4), 2u);
+  EXPECT_EQ(sensors.Get<1>().bursts_, 1u);
+}
+
+TEST(SensorStaticSetTest, sensorsStayUsableThroughTheVirtualInterface) {
+  StaticSensorSet<FakeSensor, BurstSensor> sensors;
+  UniversalSensor *adapters[2];
+  sensors.GetSensors(adapters);
+  EXPECT_EQ(adapters[0], &sensors.Get<0>());
+  EXPECT_EQ(adapters[1]->GetSensorType(), 0x20);
+
+  SensorData_t samples[4];
+  EXPECT_EQ(adapters[1]->ReadSamples(samples, 4), 2u);
+  EXPECT_EQ(sensors.Get<1>().bursts_, 1u);
+}
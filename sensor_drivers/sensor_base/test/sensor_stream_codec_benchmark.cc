@@ -0,0 +1,183 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+/*
+ * Compression ratio and speed of the sensor stream codec.
+ *
+ * Usage: sensor_stream_codec_benchmark [fingerposition.csv] [ventilation.csv]
+ *
+ * A trace file holds one sample per line: timestamp_us followed by the raw values, comma separated.
+ * Without files, traces resembling a recording are generated: 100 Hz finger position with
+ * 8 slowly moving 12-bit channels, and 500 Hz SDP810 differential pressure ticks plus scale factor
+ * during ventilation.
+ */
+
+#include <sensor_stream_codec.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+inline constexpr uint16_t kKeyframeInterval = 64;
+inline constexpr int kRepetitions = 50;
+
+uint32_t NextNoise(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 16;
+}
+
+SensorData_t MakeSample(uint16_t sensor_id, SensorElementType type, uint8_t count) {
+  SensorData_t sample = {};
+  sample.sensor_id = sensor_id;
+  sample.element_type = type;
+  sample.num_of_bytes = count * SensorElementSize(type);
+  return sample;
+}
+
+std::vector<SensorData_t> FingerPositionTrace(size_t length) {
+  std::vector<SensorData_t> trace;
+  uint32_t noise = 1;
+  for (size_t n = 0; n < length; n++) {
+    SensorData_t sample = MakeSample(0x03, kSensorElementU16, 8);
+    sample.sample_num = n + 1;
+    sample.timestamp_us = 10000 * n + NextNoise(&noise) % 40;
+    for (uint8_t i = 0; i < 8; i++) {
+      const double kPress = std::sin(2 * M_PI * n / 60.0 + i * 0.3);
+      sample.buffer[i] = static_cast<uint16_t>(2048 + 900 * kPress * kPress + NextNoise(&noise) % 7);
+    }
+    trace.push_back(sample);
+  }
+  return trace;
+}
+
+std::vector<SensorData_t> VentilationTrace(size_t length) {
+  std::vector<SensorData_t> trace;
+  uint32_t noise = 2;
+  for (size_t n = 0; n < length; n++) {
+    SensorData_t sample = MakeSample(0x02, kSensorElementI16, 2);
+    sample.sample_num = n + 1;
+    sample.timestamp_us = 2000 * n + NextNoise(&noise) % 40;
+    const double kPhase = std::fmod(n / 2500.0, 1.0);
+    const double kFlow = kPhase < 0.3 ? std::sin(M_PI * kPhase / 0.3) : 0.0;
+    sample.buffer[0] = static_cast<uint16_t>(static_cast<int16_t>(6000 * kFlow + NextNoise(&noise) % 9 - 4));
+    sample.buffer[1] = 60;  // SDP810-500Pa scale factor
+    trace.push_back(sample);
+  }
+  return trace;
+}
+
+bool LoadTrace(const char *path, SensorData_t prototype, std::vector<SensorData_t> *trace) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream fields(line);
+    std::string field;
+    SensorData_t sample = prototype;
+    sample.sample_num = trace->size() + 1;
+    if (!std::getline(fields, field, ',')) {
+      continue;
+    }
+    sample.timestamp_us = std::stoul(field);
+    for (uint8_t i = 0; i < SensorElementCount(prototype) && std::getline(fields, field, ','); i++) {
+      sample.buffer[i] = static_cast<uint16_t>(std::stol(field));
+    }
+    trace->push_back(sample);
+  }
+  return !trace->empty();
+}
+
+void Run(const char *name, const std::vector<SensorData_t> &trace) {
+  std::vector<uint8_t> stream(trace.size() * kSensorStreamMaxRecordSize);
+  size_t stream_size = 0;
+  size_t wire_size = 0;
+  double encode_ns = 0;
+  double decode_ns = 0;
+  bool match = true;
+
+  for (int repetition = 0; repetition < kRepetitions; repetition++) {
+    SensorStreamEncoder encoder(kKeyframeInterval);
+    stream_size = 0;
+    wire_size = 0;
+    const auto kEncodeStart = std::chrono::steady_clock::now();
+    for (const SensorData_t &sample : trace) {
+      stream_size += encoder.Encode(sample, stream.data() + stream_size, kSensorStreamMaxRecordSize);
+      wire_size += SensorWireEncodedSize(sample);
+    }
+    const auto kEncodeEnd = std::chrono::steady_clock::now();
+
+    SensorStreamDecoder decoder;
+    SensorData_t decoded;
+    size_t offset = 0;
+    size_t consumed;
+    size_t index = 0;
+    const auto kDecodeStart = std::chrono::steady_clock::now();
+    while (offset < stream_size
+           && decoder.Decode(stream.data() + offset, stream_size - offset, &decoded, &consumed) == kSensorStreamSample) {
+      match &= decoded.buffer[0] == trace[index].buffer[0] && decoded.timestamp_us == trace[index].timestamp_us;
+      offset += consumed;
+      index++;
+    }
+    const auto kDecodeEnd = std::chrono::steady_clock::now();
+    match &= index == trace.size();
+
+    encode_ns += std::chrono::duration<double, std::nano>(kEncodeEnd - kEncodeStart).count();
+    decode_ns += std::chrono::duration<double, std::nano>(kDecodeEnd - kDecodeStart).count();
+  }
+
+  const double kSamples = static_cast<double>(trace.size()) * kRepetitions;
+  std::printf("%-15s %8zu samples  struct %8zu B  wire %8zu B  stream %8zu B  "
+              "ratio %5.2fx (wire %5.2fx)  encode %6.1f ns/sample  decode %6.1f ns/sample%s\n",
+              name, trace.size(), trace.size() * sizeof(SensorData_t), wire_size, stream_size,
+              static_cast<double>(trace.size() * sizeof(SensorData_t)) / stream_size,
+              static_cast<double>(wire_size) / stream_size,
+              encode_ns / kSamples, decode_ns / kSamples, match ? "" : "  MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<SensorData_t> finger_position;
+  std::vector<SensorData_t> ventilation;
+  if (argc < 2 || !LoadTrace(argv[1], MakeSample(0x03, kSensorElementU16, 8), &finger_position)) {
+    finger_position = FingerPositionTrace(60000);
+  }
+  if (argc < 3 || !LoadTrace(argv[2], MakeSample(0x02, kSensorElementI16, 2), &ventilation)) {
+    ventilation = VentilationTrace(300000);
+  }
+  Run("fingerposition", finger_position);
+  Run("ventilation", ventilation);
+  return 0;
+}
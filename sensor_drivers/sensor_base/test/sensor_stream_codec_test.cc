@@ -0,0 +1,271 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sensor_stream_codec.hpp>
+#include <vector>
+
+namespace {
+
+SensorData_t MakeSample(uint32_t num, int16_t step) {
+  SensorData_t sample = {};
+  sample.sensor_id = 0x0400;
+  sample.sample_num = num;
+  sample.timestamp_us = 1000 * num;
+  sample.element_type = kSensorElementI16;
+  sample.num_of_bytes = 2 * kMaxAmountOfSensorBytes;
+  for (uint8_t i = 0; i < kMaxAmountOfSensorBytes; i++) {
+    sample.buffer[i] = static_cast<uint16_t>(1000 * i + step * static_cast<int32_t>(num) * (i % 2 ? -1 : 1));
+  }
+  return sample;
+}
+
+void ExpectSameSample(const SensorData_t &decoded, const SensorData_t &sample) {
+  EXPECT_EQ(decoded.sensor_id, sample.sensor_id);
+  EXPECT_EQ(decoded.sample_num, sample.sample_num);
+  EXPECT_EQ(decoded.timestamp_us, sample.timestamp_us);
+  EXPECT_EQ(decoded.status, sample.status);
+  EXPECT_EQ(decoded.element_type, sample.element_type);
+  EXPECT_EQ(decoded.num_of_bytes, sample.num_of_bytes);
+  for (uint8_t i = 0; i < SensorElementCount(sample); i++) {
+    EXPECT_EQ(decoded.buffer[i], sample.buffer[i]) << "element " << static_cast<int>(i);
+  }
+}
+
+std::vector<uint8_t> EncodeAll(SensorStreamEncoder *encoder, const std::vector<SensorData_t> &samples) {
+  std::vector<uint8_t> stream;
+  for (const SensorData_t &sample : samples) {
+    uint8_t record[kSensorStreamMaxRecordSize];
+    const size_t kSize = encoder->Encode(sample, record, sizeof(record));
+    EXPECT_GT(kSize, 0u);
+    stream.insert(stream.end(), record, record + kSize);
+  }
+  return stream;
+}
+
+std::vector<SensorData_t> DecodeAll(SensorStreamDecoder *decoder, const std::vector<uint8_t> &stream) {
+  std::vector<SensorData_t> samples;
+  size_t offset = 0;
+  while (offset < stream.size()) {
+    SensorData_t sample;
+    size_t consumed;
+    const SensorStreamResult kResult = decoder->Decode(stream.data() + offset, stream.size() - offset,
+                                                       &sample, &consumed);
+    if (kResult == kSensorStreamIncomplete) {
+      break;
+    }
+    if (kResult == kSensorStreamSample) {
+      samples.push_back(sample);
+    }
+    offset += consumed;
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST(SensorStreamCodecTest, zigZagMapsSmallDeltasToSmallValues) {
+  EXPECT_EQ(sensor_stream::ZigZag(0), 0u);
+  EXPECT_EQ(sensor_stream::ZigZag(-1), 1u);
+  EXPECT_EQ(sensor_stream::ZigZag(1), 2u);
+  EXPECT_EQ(sensor_stream::ZigZag(INT16_MIN), 0xFFFFu);
+  for (int32_t value = INT16_MIN; value <= INT16_MAX; value++) {
+    ASSERT_EQ(sensor_stream::UnZigZag(sensor_stream::ZigZag(static_cast<int16_t>(value))), value);
+  }
+}
+
+TEST(SensorStreamCodecTest, roundTripsWrappingAndSteppingValues) {
+  SensorStreamEncoder encoder(16);
+  std::vector<SensorData_t> samples;
+  for (uint32_t num = 0; num < 100; num++) {
+    samples.push_back(MakeSample(num, static_cast<int16_t>(num < 50 ? 3 : 900)));
+  }
+  samples[10].status = 2;
+  samples[70].sample_num += 5;
+  samples[71].sample_num += 5;
+
+  SensorStreamDecoder decoder;
+  const std::vector<SensorData_t> kDecoded = DecodeAll(&decoder, EncodeAll(&encoder, samples));
+  ASSERT_EQ(kDecoded.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    ExpectSameSample(kDecoded[i], samples[i]);
+  }
+}
+
+TEST(SensorStreamCodecTest, sendsKeyframesAtTheIntervalAndOnLayoutChange) {
+  SensorStreamEncoder encoder(4);
+  uint8_t record[kSensorStreamMaxRecordSize];
+  std::vector<bool> keyframes;
+  for (uint32_t num = 0; num < 9; num++) {
+    SensorData_t sample = MakeSample(num, 1);
+    if (num >= 6) {
+      sample.num_of_bytes = 4;
+    }
+    ASSERT_GT(encoder.Encode(sample, record, sizeof(record)), 0u);
+    keyframes.push_back(record[0] == kSensorStreamKeyframeTag);
+  }
+  const std::vector<bool> kExpected = {true, false, false, false, true, false, true, false, false};
+  EXPECT_EQ(keyframes, kExpected);
+
+  encoder.ForceKeyframe();
+  ASSERT_GT(encoder.Encode(MakeSample(9, 1), record, sizeof(record)), 0u);
+  EXPECT_EQ(record[0], kSensorStreamKeyframeTag);
+}
+
+TEST(SensorStreamCodecTest, packsSmallDeltasInFixedWidth) {
+  SensorStreamEncoder encoder(100);
+  uint8_t record[kSensorStreamMaxRecordSize];
+  ASSERT_GT(encoder.Encode(MakeSample(0, 1), record, sizeof(record)), 0u);
+
+  // Eight deltas of +-1 zig-zag to at most 2 bits: tag, gap, time, width and two bytes of bits
+  const size_t kSize = encoder.Encode(MakeSample(1, 1), record, sizeof(record));
+  EXPECT_EQ(record[0], kSensorStreamPackedFlag);
+  EXPECT_EQ(kSize, 1u + 1u + 2u + 1u + 2u);
+
+  // Unchanged values cost no element bits at all
+  SensorData_t same = MakeSample(1, 1);
+  same.sample_num = 2;
+  same.timestamp_us = 2000;
+  EXPECT_EQ(encoder.Encode(same, record, sizeof(record)), 5u);
+}
+
+TEST(SensorStreamCodecTest, refusesRecordsThatDoNotFit) {
+  SensorStreamEncoder encoder(100);
+  uint8_t record[kSensorStreamMaxRecordSize];
+  EXPECT_EQ(encoder.Encode(MakeSample(0, 1), record, 4), 0u);
+  ASSERT_GT(encoder.Encode(MakeSample(0, 1), record, sizeof(record)), 0u);
+  EXPECT_EQ(encoder.Encode(MakeSample(1, 1), record, 3), 0u);
+
+  // A refused sample must not become the reference for the next delta
+  SensorStreamDecoder decoder;
+  size_t consumed;
+  SensorData_t decoded = {};
+  encoder.ForceKeyframe();
+  const size_t kKeySize = encoder.Encode(MakeSample(1, 1), record, sizeof(record));
+  ASSERT_EQ(decoder.Decode(record, kKeySize, &decoded, &consumed), kSensorStreamSample);
+  EXPECT_EQ(encoder.Encode(MakeSample(2, 1), record, 2), 0u);
+  const size_t kSize = encoder.Encode(MakeSample(3, 1), record, sizeof(record));
+  ASSERT_EQ(decoder.Decode(record, kSize, &decoded, &consumed), kSensorStreamSample);
+  ExpectSameSample(decoded, MakeSample(3, 1));
+}
+
+TEST(SensorStreamCodecTest, decoderWaitsForCompleteRecords) {
+  SensorStreamEncoder encoder(8);
+  std::vector<SensorData_t> samples;
+  for (uint32_t num = 0; num < 20; num++) {
+    samples.push_back(MakeSample(num, 200));
+  }
+  const std::vector<uint8_t> kStream = EncodeAll(&encoder, samples);
+
+  // Feed the stream one byte at a time, as it would arrive over a serial link
+  SensorStreamDecoder decoder;
+  std::vector<uint8_t> pending;
+  size_t decoded_count = 0;
+  for (uint8_t byte : kStream) {
+    pending.push_back(byte);
+    SensorData_t sample;
+    size_t consumed;
+    const SensorStreamResult kResult = decoder.Decode(pending.data(), pending.size(), &sample, &consumed);
+    ASSERT_NE(kResult, kSensorStreamSkipped);
+    if (kResult == kSensorStreamSample) {
+      ExpectSameSample(sample, samples[decoded_count++]);
+      pending.erase(pending.begin(), pending.begin() + consumed);
+    }
+  }
+  EXPECT_EQ(decoded_count, samples.size());
+  EXPECT_TRUE(pending.empty());
+}
+
+TEST(SensorStreamCodecTest, decoderResyncsOnTheNextKeyframe) {
+  SensorStreamEncoder encoder(10);
+  std::vector<SensorData_t> samples;
+  for (uint32_t num = 0; num < 30; num++) {
+    samples.push_back(MakeSample(num, 2));
+  }
+  const std::vector<uint8_t> kStream = EncodeAll(&encoder, samples);
+
+  // Join half way through the first group, the decoder has no reference sample yet
+  SensorStreamDecoder decoder;
+  const std::vector<uint8_t> kTail(kStream.begin() + kStream.size() / 6, kStream.end());
+  std::vector<SensorData_t> decoded = DecodeAll(&decoder, kTail);
+  ASSERT_EQ(decoded.size(), 20u);
+  for (size_t i = 0; i < decoded.size(); i++) {
+    ExpectSameSample(decoded[i], samples[10 + i]);
+  }
+
+  decoder.Reset();
+  SensorData_t sample;
+  size_t consumed;
+  uint8_t record[kSensorStreamMaxRecordSize];
+  ASSERT_GT(encoder.Encode(MakeSample(30, 2), record, sizeof(record)), 0u);
+  const size_t kSize = encoder.Encode(MakeSample(31, 2), record, sizeof(record));
+  ASSERT_NE(record[0], kSensorStreamKeyframeTag);
+  EXPECT_EQ(decoder.Decode(record, kSize, &sample, &consumed), kSensorStreamSkipped);
+}
+
+TEST(SensorStreamCodecTest, decoderRejectsCorruptedKeyframes) {
+  SensorStreamEncoder encoder(10);
+  std::vector<SensorData_t> samples;
+  std::vector<uint8_t> stream;
+  size_t second_keyframe = 0;
+  for (uint32_t num = 0; num < 30; num++) {
+    samples.push_back(MakeSample(num, 2));
+    uint8_t record[kSensorStreamMaxRecordSize];
+    const size_t kSize = encoder.Encode(samples.back(), record, sizeof(record));
+    ASSERT_GT(kSize, 0u);
+    if (num == 10) {
+      second_keyframe = stream.size();
+    }
+    stream.insert(stream.end(), record, record + kSize);
+  }
+
+  // A flipped bit in a keyframe loses its group, the deltas after it must not be decoded
+  std::vector<uint8_t> corrupted = stream;
+  corrupted[second_keyframe + 2 + kSensorWireHeaderSize] ^= 0x04;
+  SensorStreamDecoder decoder;
+  std::vector<SensorData_t> decoded = DecodeAll(&decoder, corrupted);
+  ASSERT_EQ(decoded.size(), 20u);
+  for (size_t i = 0; i < decoded.size(); i++) {
+    ExpectSameSample(decoded[i], samples[i < 10 ? i : i + 10]);
+  }
+
+  // Join mid-stream on a 0x80 followed by a well formed wire record, without length and CRC
+  SensorData_t bogus = MakeSample(77, 9);
+  uint8_t wire[kSensorWireMaxSize];
+  const size_t kWireSize = SensorWireEncode(bogus, wire, sizeof(wire));
+  ASSERT_GT(kWireSize, 0u);
+  std::vector<uint8_t> joined = {kSensorStreamKeyframeTag};
+  joined.insert(joined.end(), wire, wire + kWireSize);
+  joined.insert(joined.end(), stream.begin() + stream.size() / 6, stream.end());
+  decoder.Reset();
+  decoded = DecodeAll(&decoder, joined);
+  ASSERT_EQ(decoded.size(), 20u);
+  for (size_t i = 0; i < decoded.size(); i++) {
+    ExpectSameSample(decoded[i], samples[10 + i]);
+  }
+}
@@ -0,0 +1,111 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sensor_wire_format.hpp>
+
+namespace {
+
+SensorData_t MakeSample(SensorElementType type, uint8_t count) {
+  SensorData_t sample = {};
+  sample.sensor_id = 0x0305;
+  sample.sample_num = 0x12345678;
+  sample.timestamp_us = 0xCAFEBABE;
+  sample.status = 7;
+  sample.element_type = type;
+  sample.num_of_bytes = count * SensorElementSize(type);
+  for (uint8_t i = 0; i < count; i++) {
+    sample.buffer[i] = type == kSensorElementU8 ? 0xA0 + i : 0x8000 + 0x111 * i;
+  }
+  return sample;
+}
+
+}  // namespace
+
+TEST(SensorWireFormatTest, oneValueSampleTakesThirteenBytes) {
+  const SensorData_t kSample = MakeSample(kSensorElementU8, 1);
+  uint8_t encoded[kSensorWireMaxSize];
+  ASSERT_EQ(SensorWireEncode(kSample, encoded, sizeof(encoded)), 13u);
+  EXPECT_LT(13u, sizeof(SensorData_t) / 2);
+  const uint8_t kExpected[13] = {0x61, 0x05, 0x03, 0x78, 0x56, 0x34, 0x12,
+                                 0xBE, 0xBA, 0xFE, 0xCA, 0x07, 0xA0};
+  for (uint8_t i = 0; i < 13; i++) {
+    EXPECT_EQ(encoded[i], kExpected[i]) << "byte " << static_cast<int>(i);
+  }
+}
+
+TEST(SensorWireFormatTest, roundTripsEveryElementType) {
+  for (SensorElementType type : {kSensorElementU16, kSensorElementI16, kSensorElementU8}) {
+    for (uint8_t count = 0; count <= kMaxAmountOfSensorBytes; count++) {
+      const SensorData_t kSample = MakeSample(type, count);
+      uint8_t encoded[kSensorWireMaxSize];
+      const size_t kSize = SensorWireEncode(kSample, encoded, sizeof(encoded));
+      ASSERT_EQ(kSize, kSensorWireHeaderSize + count * SensorElementSize(type));
+
+      SensorData_t decoded = {};
+      ASSERT_EQ(SensorWireDecode(encoded, kSize, &decoded), kSize);
+      EXPECT_EQ(decoded.sensor_id, kSample.sensor_id);
+      EXPECT_EQ(decoded.sample_num, kSample.sample_num);
+      EXPECT_EQ(decoded.timestamp_us, kSample.timestamp_us);
+      EXPECT_EQ(decoded.status, kSample.status);
+      EXPECT_EQ(decoded.element_type, kSample.element_type);
+      EXPECT_EQ(decoded.num_of_bytes, kSample.num_of_bytes);
+      for (uint8_t i = 0; i < count; i++) {
+        EXPECT_EQ(decoded.buffer[i], kSample.buffer[i]);
+      }
+    }
+  }
+}
+
+TEST(SensorWireFormatTest, decodesBackToBackRecords) {
+  uint8_t stream[2 * kSensorWireMaxSize];
+  size_t length = SensorWireEncode(MakeSample(kSensorElementU8, 1), stream, sizeof(stream));
+  length += SensorWireEncode(MakeSample(kSensorElementU16, 8), stream + length, sizeof(stream) - length);
+
+  SensorData_t decoded;
+  const size_t kFirst = SensorWireDecode(stream, length, &decoded);
+  EXPECT_EQ(kFirst, 13u);
+  EXPECT_EQ(SensorWireDecode(stream + kFirst, length - kFirst, &decoded), kSensorWireMaxSize);
+  EXPECT_EQ(SensorElementCount(decoded), 8);
+}
+
+TEST(SensorWireFormatTest, rejectsWhatItCanNotHandle) {
+  uint8_t encoded[kSensorWireMaxSize];
+  SensorData_t decoded;
+  const SensorData_t kSample = MakeSample(kSensorElementI16, 2);
+
+  EXPECT_EQ(SensorWireEncode(kSample, encoded, kSensorWireHeaderSize + 3), 0u);
+  SensorData_t too_long = kSample;
+  too_long.num_of_bytes = 2 * (kMaxAmountOfSensorBytes + 1);
+  EXPECT_EQ(SensorWireEncode(too_long, encoded, sizeof(encoded)), 0u);
+
+  const size_t kSize = SensorWireEncode(kSample, encoded, sizeof(encoded));
+  EXPECT_EQ(SensorWireDecode(encoded, kSize - 1, &decoded), 0u);   // Truncated
+  encoded[0] = (encoded[0] & 0x3F) | (2 << 6);
+  EXPECT_EQ(SensorWireDecode(encoded, kSize, &decoded), 0u);       // Unknown version
+}
@@ -0,0 +1,66 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef STUB_SENSOR_HPP_
+#define STUB_SENSOR_HPP_
+
+#include <sensor_base.hpp>
+
+/**
+ * @brief Sensor without bus traffic for the sensor_base tests and benchmarks.
+ *        Every read counts up, override GetSensorData for other samples.
+ */
+template <uint8_t Type = 0>
+class StubSensor : public UniversalSensor {
+ public:
+  void Initialize(I2CDriver *handle) override {
+    handle_ = handle;
+  }
+  SensorData_t GetSensorData() override {
+    SensorData_t sample = {};
+    sample.sensor_id = Type;
+    sample.sample_num = ++reads_;
+    sample.buffer[0] = static_cast<uint16_t>(reads_ * Type);
+    return sample;
+  }
+  const uint8_t GetSensorType() override {
+    return Type;
+  }
+  void Uninitialize() override {
+    handle_ = nullptr;
+  }
+  const bool Available() override {
+    return available_;
+  }
+
+  I2CDriver *handle_ = nullptr;
+  uint32_t reads_ = 0;
+  bool available_ = true;
+};
+
+#endif  // STUB_SENSOR_HPP_
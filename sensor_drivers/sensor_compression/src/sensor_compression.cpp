@@ -67,24 +67,154 @@
 #define sleep(ms) usleep(1000*ms)
 #endif  // __arm__
 
+CompressionSensor::CompressionSensor()
+    : UniversalSensor(), register_cache_(kVl6180XCacheableRegisters, RegTableSize(kVl6180XCacheableRegisters)) {}
+
+bool CompressionSensor::Identify(I2CDriver *handle) {
+  uint8_t model_id = 0;
+  return handle->ReadReg(kVl6180XIdentificationModelId, &model_id) == 0 && model_id == kVl6180XModelIdValue;
+}
+
 void CompressionSensor::Initialize(I2CDriver* handle) {
   i2c_handle_ = handle;
   i2c_handle_->ChangeAddress(sensor_i2c_address_);
+  // The module may have been power-cycled, forget everything we knew about it
+  register_cache_.Invalidate();
+  i2c_handle_->AttachRegisterCache(&register_cache_);
   InitVL6180X();
   SetVL6180xDefautSettings();
   sensor_data_.sample_num = 0;
 }
 
 SensorData CompressionSensor::GetSensorData() {
-  uint8_t distance = GetDistance();
-  sensor_data_.num_of_bytes = 1;
+  return StoreSample(GetDistance());
+}
+
+size_t CompressionSensor::ReadSamples(SensorData_t *samples, size_t max_samples) {
+  if (!continuous_ranging_) {
+    return UniversalSensor::ReadSamples(samples, max_samples);
+  }
+  const bool kReady = sample_ready_interrupt_ ? WaitSampleReady(0) : RangeSampleReady();
+  if (max_samples == 0 || !kReady) {
+    return 0;
+  }
+  const uint8_t kDistance = ReadRangeResult();
+  // Cleared either way, GPIO1 only signals the next result once the previous one is acknowledged
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
+  if (range_status == RANGING_BUS_ERROR) {
+    return 0;
+  }
+  samples[0] = StoreSample(kDistance);
+  return 1;
+}
+
+SensorData CompressionSensor::StoreSample(uint8_t distance) {
+  sensor_data_.timestamp_us = SensorTimestampUs();
+  if (interleaved_) {
+    sensor_data_.num_of_bytes = 4;
+    sensor_data_.element_type = kSensorElementU16;
+    sensor_data_.buffer[1] = als_count_;
+  } else {
+    sensor_data_.num_of_bytes = 1;
+    sensor_data_.element_type = kSensorElementU8;
+  }
   sensor_data_.buffer[0] = distance;
   sensor_data_.sample_num++;
   sensor_data_.sensor_id = 0x01;
   sensor_data_.status = GetSensorRangeStatus();
-
+  if (continuous_ranging_ && range_status != RANGING_TIMEOUT && range_status != RANGING_BUS_ERROR) {
+    CountRangingSample(sensor_data_.timestamp_us);
+  }
   return sensor_data_;
 }
+
+bool CompressionSensor::StartContinuousRanging(uint16_t intermeasurement_period_ms,
+                                               uint8_t max_convergence_time_ms) {
+  const uint16_t kPeriodMs = intermeasurement_period_ms / 10 * 10;
+  if (kPeriodMs < kVl6180XMinIntermeasurementPeriodMs || kPeriodMs > kVl6180XMaxIntermeasurementPeriodMs ||
+      max_convergence_time_ms == 0 || max_convergence_time_ms > kVl6180XMaxConvergenceTimeMs ||
+      kPeriodMs < max_convergence_time_ms + kVl6180XReadoutAveragingMs) {
+    return false;
+  }
+  StopContinuousRanging();
+  i2c_handle_->WriteReg(kVl6180XSysrangeIntermeasurementPeriod, kPeriodMs / 10 - 1);
+  i2c_handle_->WriteReg(kVl6180XSysrangeMaxConvergenceTime, max_convergence_time_ms);
+  BeginContinuous(kVl6180XSysrangeStart, kPeriodMs);
+  return true;
+}
+
+/**
+    * @brief Interleaved mode (datasheet, INTERLEAVED_MODE__ENABLE): the ALS start bit and inter-measurement
+    *        period drive both measurements, range follows each ALS integration
+    */
+bool CompressionSensor::StartInterleavedRanging(uint16_t intermeasurement_period_ms, uint8_t max_convergence_time_ms,
+                                                uint16_t als_integration_ms) {
+  const uint16_t kPeriodMs = intermeasurement_period_ms / 10 * 10;
+  if (kPeriodMs < kVl6180XMinIntermeasurementPeriodMs || kPeriodMs > kVl6180XMaxIntermeasurementPeriodMs ||
+      max_convergence_time_ms == 0 || max_convergence_time_ms > kVl6180XMaxConvergenceTimeMs ||
+      als_integration_ms == 0 || als_integration_ms > kVl6180XMaxAlsIntegrationMs ||
+      kPeriodMs < als_integration_ms + max_convergence_time_ms + kVl6180XReadoutAveragingMs) {
+    return false;
+  }
+  StopContinuousRanging();
+  i2c_handle_->WriteReg(kVl6180XSysalsIntermeasurementPeriod, kPeriodMs / 10 - 1);
+  i2c_handle_->WriteReg(kVl6180XSysrangeMaxConvergenceTime, max_convergence_time_ms);
+  i2c_handle_->WriteReg16(kVl6180XSysalsIntegrationPeriod, Vl6180XAlsIntegrationRegister(als_integration_ms));
+  // GPIO1 would otherwise fire on the ALS result, before the range has converged
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptConfigGpio, kVl6180XInterruptConfigRange);
+  i2c_handle_->WriteReg(kVl6180XInterleavedModeEnable, 0x01);
+  interleaved_ = true;
+  als_scale_ = Vl6180XMakeAlsScale(als_scale_.gain, als_integration_ms);
+  BeginContinuous(kVl6180XSysalsStart, kPeriodMs);
+  return true;
+}
+
+void CompressionSensor::BeginContinuous(uint16_t start_register, uint16_t period_ms) {
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
+  ranging_period_ms_ = period_ms;
+  ranging_statistics_ = {};
+  continuous_ranging_ = true;
+  ArmSampleReady();
+  i2c_handle_->WriteReg(start_register, kVl6180XSysrangeContinuous);
+}
+
+void CompressionSensor::StopContinuousRanging() {
+  if (!continuous_ranging_) {
+    return;
+  }
+  if (interleaved_) {
+    i2c_handle_->WriteReg(kVl6180XSysalsStart, kVl6180XSysrangeSingleShot);
+    i2c_handle_->WriteReg(kVl6180XInterleavedModeEnable, 0x00);
+    i2c_handle_->WriteReg(kVl6180XSystemInterruptConfigGpio, kVl6180XInterruptConfigRangeAndAls);
+    interleaved_ = false;
+  } else {
+    i2c_handle_->WriteReg(kVl6180XSysrangeStart, kVl6180XSysrangeSingleShot);
+  }
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
+  continuous_ranging_ = false;
+}
+
+/**
+    * @brief Book a drained continuous result, gaps of whole periods are results the sensor overwrote
+    */
+void CompressionSensor::CountRangingSample(uint32_t timestamp_us) {
+  const uint32_t kPeriodUs = ranging_period_ms_ * 1000u;
+  if (ranging_statistics_.samples == 0) {
+    first_sample_us_ = timestamp_us;
+  } else {
+    const uint32_t kPeriods = (timestamp_us - last_sample_us_ + kPeriodUs / 2) / kPeriodUs;
+    if (kPeriods > 1) {
+      ranging_statistics_.dropped += kPeriods - 1;
+    }
+    const uint32_t kElapsedUs = timestamp_us - first_sample_us_;
+    if (kElapsedUs > 0) {
+      ranging_statistics_.achieved_rate_mhz =
+          static_cast<uint32_t>(static_cast<uint64_t>(ranging_statistics_.samples) * 1000000000ull / kElapsedUs);
+    }
+  }
+  last_sample_us_ = timestamp_us;
+  ranging_statistics_.samples++;
+}
 /**
     * @brief Sets recommended settings required to be loaded onto the VL6180X during the
 initialisation of the device
@@ -100,76 +230,12 @@ uint8_t CompressionSensor::InitVL6180X(void) {
   if (data != 1)
     return kVl6180XFailureReset;
 
-  i2c_handle_->WriteReg(0x0207, 0x01);
-  i2c_handle_->WriteReg(0x0208, 0x01);
-  i2c_handle_->WriteReg(0x0096, 0x00);
-  i2c_handle_->WriteReg(0x0097, 0xfd);
-  i2c_handle_->WriteReg(0x00e3, 0x01);
-  i2c_handle_->WriteReg(0x00e4, 0x03);
-  i2c_handle_->WriteReg(0x00e5, 0x02);
-  i2c_handle_->WriteReg(0x00e6, 0x01);
-  i2c_handle_->WriteReg(0x00e7, 0x03);
-  i2c_handle_->WriteReg(0x00f5, 0x02);
-  i2c_handle_->WriteReg(0x00d9, 0x05);
-  i2c_handle_->WriteReg(0x00db, 0xce);
-  i2c_handle_->WriteReg(0x00dc, 0x03);
-  i2c_handle_->WriteReg(0x00dd, 0xf8);
-  i2c_handle_->WriteReg(0x009f, 0x00);
-  i2c_handle_->WriteReg(0x00a3, 0x3c);
-  i2c_handle_->WriteReg(0x00b7, 0x00);
-  i2c_handle_->WriteReg(0x00bb, 0x3c);
-  i2c_handle_->WriteReg(0x00b2, 0x09);
-  i2c_handle_->WriteReg(0x00ca, 0x09);
-  i2c_handle_->WriteReg(0x0198, 0x01);
-  i2c_handle_->WriteReg(0x01b0, 0x17);
-  i2c_handle_->WriteReg(0x01ad, 0x00);
-  i2c_handle_->WriteReg(0x00ff, 0x05);
-  i2c_handle_->WriteReg(0x0100, 0x05);
-  i2c_handle_->WriteReg(0x0199, 0x05);
-  i2c_handle_->WriteReg(0x01a6, 0x1b);
-  i2c_handle_->WriteReg(0x01ac, 0x3e);
-  i2c_handle_->WriteReg(0x01a7, 0x1f);
-  i2c_handle_->WriteReg(0x0030, 0x00);
+  i2c_handle_->WriteRegTable(kVl6180XSr03Settings, RegTableSize(kVl6180XSr03Settings));
   return 0;
 }
 
 void CompressionSensor::SetVL6180xDefautSettings(void) {
-  // Recommended settings from datasheet
-
-  // Set GPIO1 high when sample complete
-  i2c_handle_->WriteReg(kVl6180XSystemInterruptConfigGpio,
-                        (4 << 3) | (4));
-
-  // Set GPIO1 high when sample complete
-  i2c_handle_->WriteReg(kVl6180XSystemModeGpio1, 0x10);
-
-  // Set Avg sample period
-  i2c_handle_->WriteReg(kVl6180XReadoutAveragingSamplePeriod, 0x30);
-  // Set the ALS gain
-  i2c_handle_->WriteReg(kVl6180XSysalsAnalogueGain, 0x46);
-  // Set auto calibration period
-  i2c_handle_->WriteReg(kVl6180XSysrangeVhvRepeatRate, 0xFF);
-  // Set ALS integration time to 100ms
-  i2c_handle_->WriteReg(kVl6180XSysalsIntegrationPeriod, 0x63);
-  // perform a single temperature calibration
-  i2c_handle_->WriteReg(kVl6180XSysrangeVhvRecalibrate, 0x01);
-
-  // Optional settings from datasheet:
-  // Set default ranging inter-measurement period to 100ms
-  i2c_handle_->WriteReg(kVl6180XSysrangeIntermeasurementPeriod, 0x09);
-  // Set default ALS inter-measurement period to 100ms
-  i2c_handle_->WriteReg(kVl6180XSysalsIntermeasurementPeriod, 0x0A);
-  // Configures interrupt on ‘New Sample Ready threshold event’
-  i2c_handle_->WriteReg(kVl6180XSystemInterruptConfigGpio, 0x24);
-
-  // Additional settings defaults from community
-  i2c_handle_->WriteReg(kVl6180XSysrangeMaxConvergenceTime, 0x32);
-  i2c_handle_->WriteReg(kVl6180XSysrangeRangeCheckEnables, 0x10 | 0x01);
-  i2c_handle_->WriteReg16(kVl6180XSysrangeEarlyConvergenceEstimate, 0x7B);
-  i2c_handle_->WriteReg16(kVl6180XSysalsIntegrationPeriod, 0x64);
-  i2c_handle_->WriteReg(kVl6180XReadoutAveragingSamplePeriod, 0x30);
-  i2c_handle_->WriteReg(kVl6180XSysalsAnalogueGain, 0x40);
-  i2c_handle_->WriteReg(kVl6180XFirmwareResultScaler, 0x01);
+  i2c_handle_->WriteRegTable(kVl6180XDefaultSettings, RegTableSize(kVl6180XDefaultSettings));
 }
 
 /**
@@ -178,14 +244,20 @@ void CompressionSensor::SetVL6180xDefautSettings(void) {
     * @return Availability status
     */
 uint8_t CompressionSensor::GetDistance(void) {
+  if (continuous_ranging_) {
+    return GetContinuousDistance();
+  }
+  if (sample_ready_interrupt_) {
+    return GetDistanceOnInterrupt();
+  }
   uint8_t distance = 0;
   uint8_t interrupt_status = 0;
   uint8_t timeout_counter = 0;
 
   i2c_handle_->WriteReg(kVl6180XSysrangeStart, 0x01);
-  interrupt_status = i2c_handle_->ReadReg(kVl6180XSysNewSampleReady);
-  while (interrupt_status != kVl6180XSysNewSampleReadyStatusOK) {
-    interrupt_status = i2c_handle_->ReadReg(kVl6180XSysNewSampleReady);
+  // A failed status read counts as not ready yet
+  while (i2c_handle_->ReadReg(kVl6180XSysNewSampleReady, &interrupt_status) != 0 ||
+         interrupt_status != kVl6180XSysNewSampleReadyStatusOK) {
     timeout_counter++;
     if (timeout_counter > kMAX_SENSOR_READ_ATTEMPTS) { // Not likely but to avoid hangs...
       return 0; // ToDo: add timeout error flag.
@@ -197,7 +269,128 @@ uint8_t CompressionSensor::GetDistance(void) {
   return distance;
 }
 
-float CompressionSensor::GetAmbientLight(VL6180xAlsGain vl6180x_als_gain) {
+/**
+    * @brief Single shot distance, waiting for the GPIO1 sample ready interrupt instead of polling
+    *
+    * @return Distance in mm, 0 with range status RANGING_TIMEOUT when no interrupt came
+    *         or RANGING_BUS_ERROR when the result could not be read
+    */
+uint8_t CompressionSensor::GetDistanceOnInterrupt(void) {
+  ArmSampleReady();
+  i2c_handle_->WriteReg(kVl6180XSysrangeStart, 0x01);
+  if (!WaitSampleReady(kVl6180XRangeTimeoutMs)) {
+    range_status = RANGING_TIMEOUT;
+    return 0;
+  }
+  const uint8_t kDistance = ReadRangeResult();
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
+  return kDistance;
+}
+
+/**
+    * @brief Wait for the next continuous result, the sensor starts each measurement by itself
+    *
+    * @return Distance in mm, 0 with range status RANGING_TIMEOUT when nothing came within two periods
+    *         or RANGING_BUS_ERROR when the result could not be read
+    */
+uint8_t CompressionSensor::GetContinuousDistance(void) {
+  const uint32_t kTimeoutMs = 2u * ranging_period_ms_;
+  const bool kReady = sample_ready_interrupt_ ? WaitSampleReady(kTimeoutMs) : PollSampleReady(kTimeoutMs);
+  if (!kReady) {
+    range_status = RANGING_TIMEOUT;
+    return 0;
+  }
+  const uint8_t kDistance = ReadRangeResult();
+  i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
+  return kDistance;
+}
+
+/**
+    * @brief Check RESULT__INTERRUPT_STATUS_GPIO once for a new range result
+    */
+bool CompressionSensor::RangeSampleReady(void) {
+  uint8_t interrupt_status = 0;
+  if (i2c_handle_->ReadReg(kVl6180XSysNewSampleReady, &interrupt_status) != 0) {
+    return false;
+  }
+  return (interrupt_status & kVl6180XRangeInterruptMask) == kVl6180XSysNewSampleReadyStatusOK;
+}
+
+bool CompressionSensor::PollSampleReady(uint32_t timeout_ms) {
+  const uint32_t kStart = SensorTimestampUs();
+  while (!RangeSampleReady()) {
+    if (SensorTimestampUs() - kStart > timeout_ms * 1000) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+    * @brief Read range status, ALS count and range value in one burst
+    *
+    * @return Distance in mm, range_status and als_count_ are updated,
+    *         0 with range status RANGING_BUS_ERROR when the burst read failed
+    */
+uint8_t CompressionSensor::ReadRangeResult(void) {
+  const uint8_t kResultReg[2] = {(kVl6180XResultBurstStart >> 8) & 0xFF, kVl6180XResultBurstStart & 0xFF};
+  uint8_t result[kVl6180XResultBurstSize] = {};
+  if (i2c_handle_->WriteRead(kResultReg, sizeof(kResultReg), result, sizeof(result)) != 0) {
+    range_status = RANGING_BUS_ERROR;
+    return 0;
+  }
+  range_status = SensorStatus(result[kVl6180XSysResultRangeStatus - kVl6180XResultBurstStart] >> 4);
+  als_count_ = (result[kVl6180XResultAlsVal - kVl6180XResultBurstStart] << 8) |
+               result[kVl6180XResultAlsVal - kVl6180XResultBurstStart + 1];
+  return result[kVl6180XResultRangeVal - kVl6180XResultBurstStart];
+}
+
+#if defined(__arm__) && !defined(Arduino)
+void CompressionSensor::ArmSampleReady(void) {
+  waiting_task_ = xTaskGetCurrentTaskHandle();
+  // Drop a notification left over from an earlier, timed out measurement
+  ulTaskNotifyTake(pdTRUE, 0);
+}
+
+bool CompressionSensor::WaitSampleReady(uint32_t timeout_ms) {
+  const bool kReady = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) != 0;
+  // Continuous ranging keeps signalling the task that started it
+  if (!continuous_ranging_) {
+    waiting_task_ = nullptr;
+  }
+  return kReady;
+}
+
+void CompressionSensor::OnSampleReadyInterrupt() {
+  BaseType_t higher_priority_task_woken = pdFALSE;
+  if (waiting_task_ != nullptr) {
+    vTaskNotifyGiveFromISR(waiting_task_, &higher_priority_task_woken);
+  }
+  portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+#else
+void CompressionSensor::ArmSampleReady(void) {
+  sample_ready_ = false;
+}
+
+// Without an RTOS the caller spins on a flag, which still keeps the bus free
+bool CompressionSensor::WaitSampleReady(uint32_t timeout_ms) {
+  const uint32_t kStart = SensorTimestampUs();
+  while (!sample_ready_) {
+    if (SensorTimestampUs() - kStart > timeout_ms * 1000) {
+      return false;
+    }
+  }
+  sample_ready_ = false;
+  return true;
+}
+
+void CompressionSensor::OnSampleReadyInterrupt() {
+  sample_ready_ = true;
+}
+#endif
+
+Vl6180XLux CompressionSensor::GetAmbientLight(VL6180xAlsGain vl6180x_als_gain) {
   i2c_handle_->WriteReg(kVl6180XSysalsAnalogueGain, (0x40 | vl6180x_als_gain));
 
   // Start ALS Measurement
@@ -208,38 +401,14 @@ float CompressionSensor::GetAmbientLight(VL6180xAlsGain vl6180x_als_gain) {
   i2c_handle_->WriteReg(kVl6180XSystemInterruptClear, 0x07);
 
   // Retrieve the Raw ALS value from the sensor
-  unsigned int als_raw = i2c_handle_->ReadReg16(kVl6180XResultAlsVal);
-
-  // Get Integration Period for calculation
-  unsigned int als_integration_period_raw = i2c_handle_->ReadReg16(kVl6180XSysalsIntegrationPeriod);
-  float als_integration_period = 100.0f / als_integration_period_raw;
-
-  // Calculate actual LUX from Appnotes
-  float als_gain = 0.0;
-
-  switch (vl6180x_als_gain) {
-    case kGain_20: als_gain = 20.0f;
-      break;
-    case kGain_10: als_gain = 10.32f;
-      break;
-    case kGain_5: als_gain = 5.21f;
-      break;
-    case kGain_2_5: als_gain = 2.60f;
-      break;
-    case kGain_1_67: als_gain = 1.72f;
-      break;
-    case kGain_1_25: als_gain = 1.28f;
-      break;
-    case kGain_1: als_gain = 1.01f;
-      break;
-    case kGain_40: als_gain = 40.0f;
-      break;
-  }
+  const uint16_t kAlsRaw = i2c_handle_->ReadReg16(kVl6180XResultAlsVal);
 
-  // Calculate LUX from formula in AppNotes
-  float als_calculated =
-      0.32f * (static_cast<float>(als_raw) / als_gain) * als_integration_period;
-  return als_calculated;
+  // Get Integration Period for calculation, the lux factor only changes with gain or integration period
+  const uint16_t kIntegrationPeriod = Vl6180XAlsIntegrationMs(i2c_handle_->ReadReg16(kVl6180XSysalsIntegrationPeriod));
+  if (als_scale_.gain != vl6180x_als_gain || als_scale_.integration_ms != kIntegrationPeriod) {
+    als_scale_ = Vl6180XMakeAlsScale(vl6180x_als_gain, kIntegrationPeriod);
+  }
+  return Vl6180XCountToLux(kAlsRaw, als_scale_);
 }
 
 void CompressionSensor::GetIdentification(struct VL6180xIdentification *dest) {
@@ -299,5 +468,7 @@ SensorStatus CompressionSensor::GetSensorRangeStatus() {
   return range_status;
 }
 
-void CompressionSensor::Uninitialize() {}
+void CompressionSensor::Uninitialize() {
+  StopContinuousRanging();
+}
 
@@ -40,20 +40,15 @@
 
 #include <sensor_base.hpp>
 #include <i2c_helper.hpp>
+#include <vl6180x_als.hpp>
 
-inline constexpr uint8_t kSensorAddr = 0x29;
+#if defined(__arm__) && !defined(Arduino)
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
 
-// Data sheet shows gain values as binary list
-enum VL6180xAlsGain {
-  kGain_20 = 0,        // Actual ALS Gain of 20
-  kGain_10,                  // Actual ALS Gain of 10.32
-  kGain_5,                   // Actual ALS Gain of 5.21
-  kGain_2_5,                 // Actual ALS Gain of 2.60
-  kGain_1_67,                // Actual ALS Gain of 1.72
-  kGain_1_25,                // Actual ALS Gain of 1.28
-  kGain_1,                   // Actual ALS Gain of 1.01
-  kGain_40,                  // Actual ALS Gain of 40
-};
+inline constexpr uint8_t kSensorAddr = 0x29;
+inline constexpr I2CSpeed kVl6180XMaxSpeed = kI2cSpeed_400KHz;
 
 enum SensorStatus { // 3.1 Range error codes Application notes p. 8/27
     STATUS_OK = 0,
@@ -70,6 +65,8 @@ enum SensorStatus { // 3.1 Range error codes Application notes p. 8/27
     RAW_RANGE_OVERFLOW = 13,
     RANGING_UNDERFLOW = 14,
     RANGING_OVERFLOW = 15,
+    RANGING_TIMEOUT = 16,   // Driver defined: no sample ready signalled in time
+    RANGING_BUS_ERROR = 17, // Driver defined: the range result could not be read
 };
 
 struct VL6180xIdentification {
@@ -82,12 +79,29 @@ struct VL6180xIdentification {
   uint16_t id_time;
 };
 
+struct VL6180xRangingStatistics {
+  uint32_t samples;            // Results drained since StartContinuousRanging
+  uint32_t dropped;            // Results overwritten on the sensor before they were drained
+  uint32_t achieved_rate_mhz;  // Drained samples per 1000 s
+};
 
 
 
-class CompressionSensor : public UniversalSensor {
+class CompressionSensor final : public UniversalSensor {
  public:
-  CompressionSensor() : UniversalSensor() {}
+  CompressionSensor();
+
+  /**
+   * @brief Addresses probed by SensorEnumerator
+   */
+  static constexpr uint8_t kProbeAddresses[] = {kSensorAddr};
+
+  /**
+   * @brief Check the model ID register, handle must already be set to the sensor's address
+   *
+   * @note Detaches the register cache of a previous sensor on this port, the ID has to come from the bus
+   */
+  static bool Identify(I2CDriver *handle);
 
   /**
    * @brief Initialises the sensor with its default settings
@@ -112,6 +126,58 @@ class CompressionSensor : public UniversalSensor {
    */
   SensorData GetSensorData() override;
 
+  /**
+   * @brief Take the samples that are ready, without waiting in continuous ranging mode
+   *
+   * @note The sensor holds a single result, so continuous mode yields at most one sample per call.
+   *       Single shot mode takes max_samples readings like the default.
+   */
+  size_t ReadSamples(SensorData_t *samples, size_t max_samples) override;
+
+  /**
+   * @brief Let the sensor range on its own every intermeasurement_period_ms
+   *
+   * @note Results are drained by ReadSamples or GetSensorData, from GPIO1 when
+   *       EnableSampleReadyInterrupt is set, otherwise from the interrupt status register.
+   *       On FreeRTOS drain from the task that started ranging, it receives the notifications.
+   *
+   * @param intermeasurement_period_ms 10 to 2550 ms, rounded down to 10 ms steps
+   * @param max_convergence_time_ms 1 to 63 ms, has to fit in the period together with readout averaging
+   * @return false when the timing is out of range, the sensor is left untouched
+   */
+  bool StartContinuousRanging(uint16_t intermeasurement_period_ms, uint8_t max_convergence_time_ms);
+
+  /**
+   * @brief Let the sensor measure ALS and range back to back every intermeasurement_period_ms
+   *
+   * @note Samples then carry two kSensorElementU16 values: distance in mm and the raw ALS count,
+   *       read in the same burst. A rise in the ALS count without a range change points at
+   *       a covered or dirty sensor window. Draining works as in StartContinuousRanging.
+   *
+   * @param intermeasurement_period_ms 10 to 2550 ms, rounded down to 10 ms steps
+   * @param max_convergence_time_ms 1 to 63 ms
+   * @param als_integration_ms 1 to 512 ms, the period has to fit integration, convergence and readout averaging
+   * @return false when the timing is out of range, the sensor is left untouched
+   */
+  bool StartInterleavedRanging(uint16_t intermeasurement_period_ms, uint8_t max_convergence_time_ms,
+                               uint16_t als_integration_ms);
+
+  /**
+   * @brief Stop continuous or interleaved ranging, GetSensorData goes back to single shot measurements
+   */
+  void StopContinuousRanging();
+
+  bool ContinuousRanging() const {
+    return continuous_ranging_;
+  }
+
+  /**
+   * @brief Sample count, dropped results and achieved rate of the current continuous run
+   */
+  VL6180xRangingStatistics GetRangingStatistics() const {
+    return ranging_statistics_;
+  }
+
   /**
     * @brief Get the availability status of the sensor
     *
@@ -126,6 +192,31 @@ class CompressionSensor : public UniversalSensor {
     */
   SensorStatus GetSensorRangeStatus();
 
+  /**
+   * @brief Wait for the GPIO1 sample ready interrupt instead of polling the interrupt status register
+   *
+   * @note GPIO1 has to be wired to an interrupt that calls OnSampleReadyInterrupt.
+   *       On FreeRTOS the reading task blocks on a task notification, so the bus is free
+   *       for other sensors while the range converges.
+   */
+  void EnableSampleReadyInterrupt(bool enable) {
+    sample_ready_interrupt_ = enable;
+  }
+
+  /**
+   * @brief Call from the GPIO1 edge interrupt handler
+   */
+  void OnSampleReadyInterrupt();
+
+  /**
+   * @brief Convert a raw ALS count, e.g. buffer[1] of an interleaved sample, with the current gain and integration time
+   *
+   * @return Q16.16 lux, or float lux when built with VL6180X_FLOAT_LUX
+   */
+  Vl6180XLux AlsCountToLux(uint16_t count) const {
+    return Vl6180XCountToLux(count, als_scale_);
+  }
+
   /**
   * @brief Uninitialize the sensor
   */
@@ -141,12 +232,39 @@ class CompressionSensor : public UniversalSensor {
 
   SensorData sensor_data_{};
   I2CDriver *i2c_handle_;
+  I2CRegisterCache register_cache_;
+
+  bool sample_ready_interrupt_ = false;
+#if defined(__arm__) && !defined(Arduino)
+  volatile TaskHandle_t waiting_task_ = nullptr;
+#else
+  volatile bool sample_ready_ = false;
+#endif
+
+  bool continuous_ranging_ = false;
+  bool interleaved_ = false;
+  uint16_t als_count_ = 0;
+  Vl6180XAlsScale als_scale_ = Vl6180XMakeAlsScale(kGain_20, 100);  // kVl6180XDefaultSettings
+  uint16_t ranging_period_ms_ = 0;
+  uint32_t first_sample_us_ = 0;
+  uint32_t last_sample_us_ = 0;
+  VL6180xRangingStatistics ranging_statistics_{};
 
 // Low level driver functions:
   uint8_t InitVL6180X(void);
   void SetVL6180xDefautSettings(void);
   uint8_t GetDistance(void);
-  float GetAmbientLight(VL6180xAlsGain vl6180x_als_gain);
+  uint8_t GetDistanceOnInterrupt(void);
+  uint8_t GetContinuousDistance(void);
+  void ArmSampleReady(void);
+  bool WaitSampleReady(uint32_t timeout_ms);
+  bool RangeSampleReady(void);
+  bool PollSampleReady(uint32_t timeout_ms);
+  uint8_t ReadRangeResult(void);
+  SensorData StoreSample(uint8_t distance);
+  void CountRangingSample(uint32_t timestamp_us);
+  void BeginContinuous(uint16_t start_register, uint16_t period_ms);
+  Vl6180XLux GetAmbientLight(VL6180xAlsGain vl6180x_als_gain);
   void GetIdentification(struct VL6180xIdentification *dest);
   uint8_t ChangeAddress(uint8_t old_address, uint8_t new_address);
 
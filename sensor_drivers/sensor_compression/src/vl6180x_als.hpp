@@ -0,0 +1,107 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+#ifndef SENSOR_COMPRESSION_VL6180X_ALS_HPP_
+#define SENSOR_COMPRESSION_VL6180X_ALS_HPP_
+
+#include <stdint.h>
+
+/*
+ * VL6180X ambient light to lux, AN4545: lux = 0.32 * count / gain * 100 ms / integration_ms
+ *
+ * All analogue gains are whole hundredths, so with the gain in hundredths this is
+ * lux = 3200 * count / (gain_centi * integration_ms), exact in integers. The driver keeps the
+ * per configuration factor in Q32 and converts each count with one multiply and shift,
+ * no float library calls on the Cortex-M0+. Define VL6180X_FLOAT_LUX for the float path.
+ */
+
+// Data sheet shows gain values as binary list
+enum VL6180xAlsGain {
+  kGain_20 = 0,        // Actual ALS Gain of 20
+  kGain_10,                  // Actual ALS Gain of 10.32
+  kGain_5,                   // Actual ALS Gain of 5.21
+  kGain_2_5,                 // Actual ALS Gain of 2.60
+  kGain_1_67,                // Actual ALS Gain of 1.72
+  kGain_1_25,                // Actual ALS Gain of 1.28
+  kGain_1,                   // Actual ALS Gain of 1.01
+  kGain_40,                  // Actual ALS Gain of 40
+};
+
+inline constexpr uint8_t kVl6180XNumOfAlsGains = 8;
+// Indexed by VL6180xAlsGain
+inline constexpr uint16_t kVl6180XAlsGainCenti[kVl6180XNumOfAlsGains] = {2000, 1032, 521, 260, 172, 128, 101, 4000};
+inline constexpr float kVl6180XAlsGain[kVl6180XNumOfAlsGains] = {20.0f, 10.32f, 5.21f, 2.60f,
+                                                                  1.72f, 1.28f, 1.01f, 40.0f};
+
+#ifdef VL6180X_FLOAT_LUX
+typedef float Vl6180XLux;
+#else
+typedef uint32_t Vl6180XLux;  // Q16.16, saturates at UINT32_MAX
+#endif
+
+/**
+ * @brief Lux per ALS count in Q32 for one gain and integration time, computed once per configuration
+ */
+constexpr uint64_t Vl6180XLuxPerCountQ32(VL6180xAlsGain gain, uint16_t integration_ms) {
+  const uint64_t kDivisor = static_cast<uint64_t>(kVl6180XAlsGainCenti[gain]) * integration_ms;
+  return kDivisor == 0 ? 0 : ((3200ull << 32) + kDivisor / 2) / kDivisor;
+}
+
+/**
+ * @brief Count to Q16.16 lux, within 1 LSB of the exact value
+ *
+ * @note The factor is rounded to half a Q32 LSB, times at most 2^16 counts that is half a Q16 LSB,
+ *       the final rounding adds the other half.
+ */
+inline uint32_t Vl6180XLuxQ16(uint16_t count, uint64_t lux_per_count_q32) {
+  const uint64_t kLuxQ16 = (count * lux_per_count_q32 + (1u << 15)) >> 16;
+  return kLuxQ16 > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(kLuxQ16);
+}
+
+inline float Vl6180XLuxFloat(uint16_t count, VL6180xAlsGain gain, uint16_t integration_ms) {
+  return 0.32f * (static_cast<float>(count) / kVl6180XAlsGain[gain]) * (100.0f / integration_ms);
+}
+
+struct Vl6180XAlsScale {
+  VL6180xAlsGain gain;
+  uint16_t integration_ms;
+  uint64_t lux_per_count_q32;
+};
+
+constexpr Vl6180XAlsScale Vl6180XMakeAlsScale(VL6180xAlsGain gain, uint16_t integration_ms) {
+  return {gain, integration_ms, Vl6180XLuxPerCountQ32(gain, integration_ms)};
+}
+
+inline Vl6180XLux Vl6180XCountToLux(uint16_t count, const Vl6180XAlsScale &scale) {
+#ifdef VL6180X_FLOAT_LUX
+  return Vl6180XLuxFloat(count, scale.gain, scale.integration_ms);
+#else
+  return Vl6180XLuxQ16(count, scale.lux_per_count_q32);
+#endif
+}
+
+#endif  // SENSOR_COMPRESSION_VL6180X_ALS_HPP_
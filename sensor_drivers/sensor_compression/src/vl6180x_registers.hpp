@@ -31,6 +31,8 @@
 #ifndef SENSOR_COMPRESSION_VL6180X_REGISTERS_HPP_
 #define SENSOR_COMPRESSION_VL6180X_REGISTERS_HPP_
 #include <stdint.h>
+#include <i2c_register_table.hpp>
+#include <i2c_register_cache.hpp>
 
 const uint8_t kVl6180XFailureReset = -1;
 const uint16_t kVl6180XIdentificationModelId = 0x0000;
@@ -40,9 +42,12 @@ const uint16_t kVl6180XIdentificationModuleRevMajor = 0x0003;
 const uint16_t kVl6180XIdentificationModuleRevMinor = 0x0004;
 const uint16_t kVl6180XIdentificationDate = 0x0006;  // 16bit value
 const uint16_t kVl6180XIdentificationTime = 0x0008;  // 16bit value
+const uint8_t kVl6180XModelIdValue = 0xB4;          // IDENTIFICATION__MODEL_ID of every VL6180X
 
 const uint16_t kVl6180XSystemModeGpio1 = 0x0011;
 const uint16_t kVl6180XSystemInterruptConfigGpio = 0x0014;
+const uint8_t kVl6180XInterruptConfigRange = 0x04;        // New sample ready for range only
+const uint8_t kVl6180XInterruptConfigRangeAndAls = 0x24;  // New sample ready for range and ALS
 const uint16_t kVl6180XSystemInterruptClear = 0x0015;
 const uint16_t kVl6180XSystemFreshOutOfReset = 0x0016;
 
@@ -53,24 +58,113 @@ const uint16_t kVl6180XSysrangeEarlyConvergenceEstimate = 0x0022;
 const uint16_t kVl6180XSysrangeRangeCheckEnables = 0x002D;
 const uint16_t kVl6180XSysrangeVhvRecalibrate = 0x002E;
 const uint16_t kVl6180XSysrangeVhvRepeatRate = 0x0031;
+// SYSRANGE__START and SYSALS__START share this encoding
+const uint8_t kVl6180XSysrangeSingleShot = 0x01;     // In continuous mode the same bit stops ranging
+const uint8_t kVl6180XSysrangeContinuous = 0x03;
 
 const uint16_t kVl6180XSysalsStart = 0x0038;
 const uint16_t kVl6180XSysalsIntermeasurementPeriod = 0x003E;
 const uint16_t kVl6180XSysalsAnalogueGain = 0x003F;
 const uint16_t kVl6180XSysalsIntegrationPeriod = 0x0040;
 
+// SYSALS__INTEGRATION_PERIOD holds the integration time in ms minus one, 9 bits
+constexpr uint16_t Vl6180XAlsIntegrationRegister(uint16_t integration_ms) {
+  return integration_ms - 1;
+}
+
+constexpr uint16_t Vl6180XAlsIntegrationMs(uint16_t register_value) {
+  return (register_value & 0x1FF) + 1;
+}
+
 const uint16_t kVl6180XSysNewSampleReady = 0x004F;
 const uint16_t kVl6180XSysNewSampleReadyStatusOK = 0x04; // Poll RESULT__INTERRUPT_STATUS_GPIO {0x4f} register till bit 2 is set to 1.
+const uint8_t kVl6180XRangeInterruptMask = 0x07;    // Range bits of RESULT__INTERRUPT_STATUS_GPIO, ALS uses [5:3]
 const uint16_t kVl6180XSysResultRangeStatus = 0x004D;
 
 const uint16_t kVl6180XResultAlsVal = 0x0050;
 const uint16_t kVl6180XResultRangeVal = 0x0062;
 
+// One burst from RESULT__RANGE_STATUS up to RESULT__RANGE_VAL carries status, ALS count and range result
+const uint16_t kVl6180XResultBurstStart = kVl6180XSysResultRangeStatus;
+const uint8_t kVl6180XResultBurstSize = kVl6180XResultRangeVal - kVl6180XResultBurstStart + 1;
+
 const uint16_t kVl6180XReadoutAveragingSamplePeriod = 0x010A;
+const uint16_t kVl6180XInterleavedModeEnable = 0x02A3;
 const uint16_t kVl6180XFirmwareResultScaler = 0x0120;
 const uint16_t kVl6180Xi2CSlaveDeviceAddress = 0x0212;
 
+// Recommended settings required to be loaded onto the VL6180X during the
+// initialisation of the device. See AN4545 p.24/27 Section 9 SR03 settings
+inline constexpr I2CRegisterWrite kVl6180XSr03Settings[] = {
+    {0x0207, 0x01, 1}, {0x0208, 0x01, 1},
+    {0x0096, 0x00, 1}, {0x0097, 0xfd, 1},
+    {0x00e3, 0x01, 1}, {0x00e4, 0x03, 1}, {0x00e5, 0x02, 1}, {0x00e6, 0x01, 1}, {0x00e7, 0x03, 1},
+    {0x00f5, 0x02, 1},
+    {0x00d9, 0x05, 1},
+    {0x00db, 0xce, 1}, {0x00dc, 0x03, 1}, {0x00dd, 0xf8, 1},
+    {0x009f, 0x00, 1},
+    {0x00a3, 0x3c, 1},
+    {0x00b7, 0x00, 1},
+    {0x00bb, 0x3c, 1},
+    {0x00b2, 0x09, 1},
+    {0x00ca, 0x09, 1},
+    {0x0198, 0x01, 1},
+    {0x01b0, 0x17, 1},
+    {0x01ad, 0x00, 1},
+    {0x00ff, 0x05, 1}, {0x0100, 0x05, 1},
+    {0x0199, 0x05, 1},
+    {0x01a6, 0x1b, 1},
+    {0x01ac, 0x3e, 1},
+    {0x01a7, 0x1f, 1},
+    {0x0030, 0x00, 1},
+};
+
+inline constexpr I2CRegisterWrite kVl6180XDefaultSettings[] = {
+    // Recommended settings from datasheet
+    {kVl6180XSystemInterruptConfigGpio, (4 << 3) | (4), 1},  // Set GPIO1 high when sample complete
+    {kVl6180XSystemModeGpio1, 0x10, 1},                      // Set GPIO1 high when sample complete
+    {kVl6180XReadoutAveragingSamplePeriod, 0x30, 1},         // Set Avg sample period
+    {kVl6180XSysalsAnalogueGain, 0x46, 1},                   // Set the ALS gain
+    {kVl6180XSysrangeVhvRepeatRate, 0xFF, 1},                // Set auto calibration period
+    {kVl6180XSysalsIntegrationPeriod, Vl6180XAlsIntegrationRegister(100), 1},  // Set ALS integration time to 100ms
+    {kVl6180XSysrangeVhvRecalibrate, 0x01, 1},               // perform a single temperature calibration
+    // Optional settings from datasheet:
+    {kVl6180XSysrangeIntermeasurementPeriod, 0x09, 1},       // Set default ranging inter-measurement period to 100ms
+    {kVl6180XSysalsIntermeasurementPeriod, 0x0A, 1},         // Set default ALS inter-measurement period to 100ms
+    {kVl6180XSystemInterruptConfigGpio, 0x24, 1},            // Configures interrupt on 'New Sample Ready threshold event'
+    // Additional settings defaults from community
+    {kVl6180XSysrangeMaxConvergenceTime, 0x32, 1},
+    {kVl6180XSysrangeRangeCheckEnables, 0x10 | 0x01, 1},
+    {kVl6180XSysrangeEarlyConvergenceEstimate, 0x7B, 2},
+    {kVl6180XSysalsIntegrationPeriod, Vl6180XAlsIntegrationRegister(100), 2},
+    {kVl6180XReadoutAveragingSamplePeriod, 0x30, 1},
+    {kVl6180XSysalsAnalogueGain, 0x40, 1},
+    {kVl6180XFirmwareResultScaler, 0x01, 1},
+};
+
+// Registers that only change when written by the host. Start, interrupt clear,
+// fresh-out-of-reset, VHV recalibrate (self-clearing) and all result registers are left out.
+inline constexpr I2CRegisterRange kVl6180XCacheableRegisters[] = {
+    {kVl6180XIdentificationModelId, kVl6180XIdentificationTime + 1},
+    {kVl6180XSystemModeGpio1, kVl6180XSystemInterruptConfigGpio},
+    {kVl6180XSysrangeStart + 1, kVl6180XSysrangeVhvRecalibrate - 1},
+    {kVl6180XSysrangeVhvRecalibrate + 1, kVl6180XSysalsStart - 1},
+    {kVl6180XSysalsIntermeasurementPeriod, kVl6180XSysalsIntegrationPeriod + 1},
+    {kVl6180XReadoutAveragingSamplePeriod, kVl6180XReadoutAveragingSamplePeriod},
+    {kVl6180XFirmwareResultScaler, kVl6180XFirmwareResultScaler},
+};
+
 const uint8_t kMAX_SENSOR_READ_ATTEMPTS = 150;
 const uint8_t kSAMPLE_TIME = 100;
+// Worst case single shot: 50 ms max convergence (SYSRANGE__MAX_CONVERGENCE_TIME) plus readout averaging
+const uint8_t kVl6180XRangeTimeoutMs = 100;
+// Continuous ranging limits: SYSRANGE__INTERMEASUREMENT_PERIOD is (value + 1) * 10 ms,
+// SYSRANGE__MAX_CONVERGENCE_TIME 1-63 ms. Readout averaging (0x30) adds 1.3 ms + 48 * 64.5 us.
+const uint16_t kVl6180XMinIntermeasurementPeriodMs = 10;
+const uint16_t kVl6180XMaxIntermeasurementPeriodMs = 2550;
+const uint8_t kVl6180XMaxConvergenceTimeMs = 63;
+const uint8_t kVl6180XReadoutAveragingMs = 5;
+// SYSALS__INTEGRATION_PERIOD is (value + 1) ms, 9 bits
+const uint16_t kVl6180XMaxAlsIntegrationMs = 512;
 
 #endif  // SENSOR_COMPRESSION_VL6180X_REGISTERS_HPP_
@@ -30,10 +30,16 @@
 #include <i2c_helper.hpp>
 #include <sensor_compression.hpp>
 #include <vl6180x_registers.hpp>
+#include <vl6180x_als.hpp>
+#include <cmath>
 
 using ::testing::Return;
 using ::testing::InSequence;
 using ::testing::Mock;
+using ::testing::DoAll;
+using ::testing::SetArgPointee;
+using ::testing::Invoke;
+using ::testing::_;
 
 void InitVL6180xCalls(I2CDriver *i2c_handle_mock) {
   EXPECT_CALL(*i2c_handle_mock, ReadReg(kVl6180XSystemFreshOutOfReset))
@@ -42,8 +48,8 @@ void InitVL6180xCalls(I2CDriver *i2c_handle_mock) {
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x0208, 0x01));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x0096, 0x00));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x0097, 0xfd));
-  EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e3, 0x00));
-  EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e4, 0x04));
+  EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e3, 0x01));
+  EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e4, 0x03));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e5, 0x02));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e6, 0x01));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(0x00e7, 0x03));
@@ -111,7 +117,7 @@ void SetVL6180xDefaultSettingsCalls(I2CDriver *i2c_handle_mock) {
   EXPECT_CALL(*i2c_handle_mock,
               WriteReg16(kVl6180XSysrangeEarlyConvergenceEstimate, 0x7B));
   EXPECT_CALL(*i2c_handle_mock,
-              WriteReg16(kVl6180XSysalsIntegrationPeriod, 0x64));
+              WriteReg16(kVl6180XSysalsIntegrationPeriod, 0x63));
   EXPECT_CALL(*i2c_handle_mock,
               WriteReg(kVl6180XReadoutAveragingSamplePeriod, 0x30));
   EXPECT_CALL(*i2c_handle_mock, WriteReg(kVl6180XSysalsAnalogueGain, 0x40));
@@ -122,6 +128,7 @@ TEST(compressionTest, initCalls) {
   I2CDriver i2c_handle_mock;
   CompressionSensor CompSensor;
   EXPECT_CALL(i2c_handle_mock, ChangeAddress(kSensorAddr));
+  EXPECT_CALL(i2c_handle_mock, AttachRegisterCache(_));
   {
     InSequence seq;
     InitVL6180xCalls(&i2c_handle_mock);
@@ -139,9 +146,13 @@ TEST(compressionTest, GetSensorData) {
   CompressionSensor CompSensor;
   CompSensor.Initialize(&i2c_handle_mock);
   EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01));
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kVl6180XSysNewSampleReadyStatusOK), Return(0)));
   EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
   EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XResultRangeVal))
       .WillOnce(Return(ExpectedOutput.buffer[0]));
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysResultRangeStatus))
+      .WillOnce(Return(STATUS_OK));
   // Do the "Real" call
   SensorData data = CompSensor.GetSensorData();
   EXPECT_EQ(ExpectedOutput.num_of_bytes, data.num_of_bytes);
@@ -149,6 +160,356 @@ TEST(compressionTest, GetSensorData) {
   Mock::VerifyAndClearExpectations(&i2c_handle_mock);
 }
 
+TEST(compressionTest, FailedStatusReadIsNotReady) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01));
+  // The failed read leaves a stale "ready" in the buffer, it must not be trusted
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kVl6180XSysNewSampleReadyStatusOK), Return(kI2cStatusShortRead)))
+      .WillOnce(DoAll(SetArgPointee<1>(kVl6180XSysNewSampleReadyStatusOK), Return(0)));
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XResultRangeVal)).WillOnce(Return(0x30));
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysResultRangeStatus)).WillOnce(Return(STATUS_OK));
+  EXPECT_EQ(CompSensor.GetSensorData().buffer[0], 0x30);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, ReadSamplesTakesOneReadingPerSample) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  const uint8_t kNumOfSamples = 3;
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01)).Times(kNumOfSamples);
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _)).Times(kNumOfSamples)
+      .WillRepeatedly(DoAll(SetArgPointee<1>(kVl6180XSysNewSampleReadyStatusOK), Return(0)));
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07)).Times(kNumOfSamples);
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XResultRangeVal))
+      .WillOnce(Return(10)).WillOnce(Return(20)).WillOnce(Return(30));
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysResultRangeStatus)).Times(kNumOfSamples)
+      .WillRepeatedly(Return(STATUS_OK));
+  // Do the "Real" call
+  SensorData samples[kNumOfSamples];
+  UniversalSensor *sensor = &CompSensor;
+  EXPECT_EQ(sensor->ReadSamples(samples, kNumOfSamples), kNumOfSamples);
+  EXPECT_EQ(samples[0].buffer[0], 10);
+  EXPECT_EQ(samples[2].buffer[0], 30);
+  EXPECT_EQ(samples[2].sample_num, samples[0].sample_num + 2);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, IdentifyChecksModelId) {
+  I2CDriver i2c_handle_mock;
+  EXPECT_CALL(i2c_handle_mock, AttachRegisterCache(_)).Times(0);
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XIdentificationModelId, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kVl6180XModelIdValue), Return(0)))
+      .WillOnce(DoAll(SetArgPointee<1>(0x24), Return(0)));
+  EXPECT_TRUE(CompressionSensor::Identify(&i2c_handle_mock));
+  EXPECT_FALSE(CompressionSensor::Identify(&i2c_handle_mock));
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+uint32_t fake_clock_us = 0;
+
+uint32_t FakeClockAdvancing10Ms() {
+  fake_clock_us += 10000;
+  return fake_clock_us;
+}
+
+TEST(compressionTest, InterruptModeWaitsForGpio1InsteadOfPolling) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  CompSensor.EnableSampleReadyInterrupt(true);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01))
+        .WillOnce(DoAll(Invoke([&CompSensor](uint16_t, uint8_t) { CompSensor.OnSampleReadyInterrupt(); }),
+                        Return(0)));
+    EXPECT_CALL(i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize))
+        .WillOnce(Invoke([](const uint8_t *tx, uint8_t, uint8_t *rx, uint8_t rx_len) {
+          EXPECT_EQ((tx[0] << 8) | tx[1], kVl6180XSysResultRangeStatus);
+          memset(rx, 0, rx_len);
+          rx[0] = RANGING_OVERFLOW << 4;
+          rx[kVl6180XResultRangeVal - kVl6180XSysResultRangeStatus] = 0x42;
+          return 0;
+        }));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  }
+  // No status register polling and no separate result reads
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _)).Times(0);
+  EXPECT_CALL(i2c_handle_mock, ReadReg(_)).Times(0);
+
+  SensorData data = CompSensor.GetSensorData();
+  EXPECT_EQ(data.buffer[0], 0x42);
+  EXPECT_EQ(data.status, RANGING_OVERFLOW);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, InterruptModeTimesOutWithoutGpio1) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  CompSensor.EnableSampleReadyInterrupt(true);
+  SetSensorClock(FakeClockAdvancing10Ms);
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01));
+  EXPECT_CALL(i2c_handle_mock, WriteRead(_, _, _, _)).Times(0);
+
+  SensorData data = CompSensor.GetSensorData();
+  SetSensorClock(SensorDefaultClock);
+  EXPECT_EQ(data.buffer[0], 0);
+  EXPECT_EQ(data.status, RANGING_TIMEOUT);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, FailedResultReadIsNotAValidSample) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  CompSensor.EnableSampleReadyInterrupt(true);
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01))
+      .WillOnce(DoAll(Invoke([&CompSensor](uint16_t, uint8_t) { CompSensor.OnSampleReadyInterrupt(); }),
+                      Return(0)));
+  EXPECT_CALL(i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize)).WillOnce(Return(2));
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+
+  SensorData data = CompSensor.GetSensorData();
+  EXPECT_EQ(data.buffer[0], 0);
+  EXPECT_EQ(data.status, RANGING_BUS_ERROR);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  // Continuous: the sample is dropped and not counted, the interrupt is still acknowledged
+  ASSERT_TRUE(CompSensor.StartContinuousRanging(50, 20));
+  CompSensor.OnSampleReadyInterrupt();
+  EXPECT_CALL(i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize)).WillOnce(Return(2));
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  SensorData samples[2];
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 2), 0u);
+  EXPECT_EQ(CompSensor.GetRangingStatistics().samples, 0u);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+uint32_t manual_clock_us = 0;
+
+uint32_t ManualClock() {
+  return manual_clock_us;
+}
+
+// Answer RESULT__INTERRUPT_STATUS_GPIO reads with *status and range result bursts with distance
+void ExpectContinuousResults(I2CDriver *i2c_handle_mock, const uint8_t *status, uint8_t distance) {
+  EXPECT_CALL(*i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _))
+      .WillRepeatedly(Invoke([status](uint16_t, uint8_t *data) {
+        *data = *status;
+        return 0;
+      }));
+  EXPECT_CALL(*i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize))
+      .WillRepeatedly(Invoke([distance](const uint8_t *, uint8_t, uint8_t *rx, uint8_t rx_len) {
+        memset(rx, 0, rx_len);
+        rx[kVl6180XResultRangeVal - kVl6180XSysResultRangeStatus] = distance;
+        return 0;
+      }));
+}
+
+TEST(compressionTest, StartContinuousRangingConfiguresPeriodAndConvergence) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  EXPECT_CALL(i2c_handle_mock, WriteReg(_, _)).Times(0);
+  EXPECT_FALSE(CompSensor.StartContinuousRanging(5, 1));      // Below 10 ms
+  EXPECT_FALSE(CompSensor.StartContinuousRanging(2560, 30));  // Above 2550 ms
+  EXPECT_FALSE(CompSensor.StartContinuousRanging(50, 0));
+  EXPECT_FALSE(CompSensor.StartContinuousRanging(50, 64));
+  EXPECT_FALSE(CompSensor.StartContinuousRanging(39, 30));    // 30 ms after rounding, no room for readout
+  EXPECT_FALSE(CompSensor.ContinuousRanging());
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeIntermeasurementPeriod, 4));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeMaxConvergenceTime, 30));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x03));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeStart, 0x01));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  }
+  EXPECT_TRUE(CompSensor.StartContinuousRanging(55, 30));
+  EXPECT_TRUE(CompSensor.ContinuousRanging());
+  CompSensor.StopContinuousRanging();
+  EXPECT_FALSE(CompSensor.ContinuousRanging());
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, ContinuousPollingDrainsReadyResultsAndCountsDropped) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  SetSensorClock(ManualClock);
+  manual_clock_us = 1000;
+  ASSERT_TRUE(CompSensor.StartContinuousRanging(100, 30));
+
+  uint8_t status = 0x00;
+  ExpectContinuousResults(&i2c_handle_mock, &status, 0x37);
+  SensorData samples[4];
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 4), 0u);
+
+  // ALS bits alone do not count as a range result
+  status = 0x20;
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 4), 0u);
+
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07)).Times(3);
+  status = 0x24;
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 4), 1u);
+  EXPECT_EQ(samples[0].buffer[0], 0x37);
+  EXPECT_EQ(samples[0].timestamp_us, 1000u);
+
+  manual_clock_us += 100000;
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 4), 1u);
+  // Two results overwritten while nobody drained the sensor
+  manual_clock_us += 300000;
+  EXPECT_EQ(CompSensor.GetSensorData().buffer[0], 0x37);
+
+  SetSensorClock(SensorDefaultClock);
+  const VL6180xRangingStatistics kStats = CompSensor.GetRangingStatistics();
+  EXPECT_EQ(kStats.samples, 3u);
+  EXPECT_EQ(kStats.dropped, 2u);
+  EXPECT_EQ(kStats.achieved_rate_mhz, 5000u);  // Two intervals in 400 ms
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, ContinuousInterruptModeDrainsOnGpio1) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  CompSensor.EnableSampleReadyInterrupt(true);
+  SetSensorClock(FakeClockAdvancing10Ms);
+  ASSERT_TRUE(CompSensor.StartContinuousRanging(50, 20));
+
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _)).Times(0);
+  EXPECT_CALL(i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize))
+      .WillOnce(Invoke([](const uint8_t *, uint8_t, uint8_t *rx, uint8_t rx_len) {
+        memset(rx, 0, rx_len);
+        rx[kVl6180XResultRangeVal - kVl6180XSysResultRangeStatus] = 0x21;
+        return 0;
+      }));
+  SensorData samples[2];
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 2), 0u);
+  CompSensor.OnSampleReadyInterrupt();
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 2), 1u);
+  EXPECT_EQ(samples[0].buffer[0], 0x21);
+  // The interrupt is consumed, no result until GPIO1 fires again
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 2), 0u);
+  EXPECT_EQ(CompSensor.GetSensorData().status, RANGING_TIMEOUT);
+  SetSensorClock(SensorDefaultClock);
+  EXPECT_EQ(CompSensor.GetRangingStatistics().samples, 1u);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, InterleavedModeDeliversRangeAndAlsInOneSample) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  EXPECT_CALL(i2c_handle_mock, WriteReg(_, _)).Times(0);
+  EXPECT_FALSE(CompSensor.StartInterleavedRanging(100, 30, 100));  // ALS alone fills the period
+  EXPECT_FALSE(CompSensor.StartInterleavedRanging(100, 30, 0));
+  EXPECT_FALSE(CompSensor.StartInterleavedRanging(1000, 30, 513));
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysalsIntermeasurementPeriod, 4));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysrangeMaxConvergenceTime, 20));
+    EXPECT_CALL(i2c_handle_mock, WriteReg16(kVl6180XSysalsIntegrationPeriod, 19));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptConfigGpio, 0x04));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XInterleavedModeEnable, 0x01));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysalsStart, 0x03));
+  }
+  ASSERT_TRUE(CompSensor.StartInterleavedRanging(50, 20, 20));
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  // Only the range interrupt bits tell a complete interleaved pair
+  uint8_t status = 0x20;
+  EXPECT_CALL(i2c_handle_mock, ReadReg(kVl6180XSysNewSampleReady, _))
+      .WillRepeatedly(Invoke([&status](uint16_t, uint8_t *data) {
+        *data = status;
+        return 0;
+      }));
+  EXPECT_CALL(i2c_handle_mock, WriteRead(_, 2, _, kVl6180XResultBurstSize))
+      .WillOnce(Invoke([](const uint8_t *, uint8_t, uint8_t *rx, uint8_t rx_len) {
+        memset(rx, 0, rx_len);
+        rx[kVl6180XResultAlsVal - kVl6180XSysResultRangeStatus] = 0x01;
+        rx[kVl6180XResultAlsVal - kVl6180XSysResultRangeStatus + 1] = 0x2C;
+        rx[kVl6180XResultRangeVal - kVl6180XSysResultRangeStatus] = 0x55;
+        return 0;
+      }));
+  EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  SensorData samples[1];
+  EXPECT_EQ(CompSensor.ReadSamples(samples, 1), 0u);
+  status = 0x24;
+  ASSERT_EQ(CompSensor.ReadSamples(samples, 1), 1u);
+  EXPECT_EQ(samples[0].element_type, kSensorElementU16);
+  EXPECT_EQ(samples[0].num_of_bytes, 4);
+  EXPECT_EQ(samples[0].buffer[0], 0x55);
+  EXPECT_EQ(samples[0].buffer[1], 0x012C);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSysalsStart, 0x01));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XInterleavedModeEnable, 0x00));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptConfigGpio, 0x24));
+    EXPECT_CALL(i2c_handle_mock, WriteReg(kVl6180XSystemInterruptClear, 0x07));
+  }
+  CompSensor.StopContinuousRanging();
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(compressionTest, FixedPointLuxWithinOneLsbForAllGains) {
+  const uint16_t kIntegrationPeriods[] = {1, 10, 50, 100, 255, 512};
+  for (uint8_t gain = 0; gain < kVl6180XNumOfAlsGains; gain++) {
+    for (const uint16_t kIntegrationMs : kIntegrationPeriods) {
+      const uint64_t kScale = Vl6180XLuxPerCountQ32(VL6180xAlsGain(gain), kIntegrationMs);
+      for (uint32_t count = 0; count <= 0xFFFF; count += 97) {
+        const double kExact = 3200.0 * count / (kVl6180XAlsGainCenti[gain] * kIntegrationMs);
+        const double kExactQ16 = kExact * 65536.0;
+        const uint32_t kFixed = Vl6180XLuxQ16(count, kScale);
+        if (kExactQ16 >= UINT32_MAX) {
+          EXPECT_EQ(kFixed, UINT32_MAX);
+          continue;
+        }
+        ASSERT_LE(std::fabs(kFixed - kExactQ16), 1.0) << "gain " << int(gain) << " integration " << kIntegrationMs
+                                                      << " count " << count;
+        // The float path agrees up to its own 24 bit mantissa
+        const double kFloat = Vl6180XLuxFloat(count, VL6180xAlsGain(gain), kIntegrationMs);
+        ASSERT_NEAR(kFloat, kExact, kExact * 1e-6 + 1e-6);
+      }
+    }
+  }
+}
+
+TEST(compressionTest, AlsCountToLuxFollowsInterleavedIntegration) {
+  I2CDriver i2c_handle_mock;
+  CompressionSensor CompSensor;
+  CompSensor.Initialize(&i2c_handle_mock);
+  // Defaults: gain 20, 100 ms -> 0.016 lux per count
+  EXPECT_EQ(CompSensor.AlsCountToLux(1000), Vl6180XCountToLux(1000, Vl6180XMakeAlsScale(kGain_20, 100)));
+  EXPECT_EQ(Vl6180XLuxQ16(1000, Vl6180XLuxPerCountQ32(kGain_20, 100)), 16u << 16);
+  ASSERT_TRUE(CompSensor.StartInterleavedRanging(100, 20, 50));
+  EXPECT_EQ(CompSensor.AlsCountToLux(1000), Vl6180XCountToLux(1000, Vl6180XMakeAlsScale(kGain_20, 50)));
+  CompSensor.StopContinuousRanging();
+
+  // The register holds ms - 1, both ways, so the single shot and interleaved paths agree
+  for (const I2CRegisterWrite &kWrite : kVl6180XDefaultSettings) {
+    if (kWrite.reg == kVl6180XSysalsIntegrationPeriod) {
+      EXPECT_EQ(Vl6180XAlsIntegrationMs(kWrite.value), 100);
+    }
+  }
+  EXPECT_EQ(Vl6180XAlsIntegrationMs(Vl6180XAlsIntegrationRegister(kVl6180XMaxAlsIntegrationMs)),
+            kVl6180XMaxAlsIntegrationMs);
+}
+
 int main(int argc, char **argv) {
   // ::testing::InitGoogleTest(&argc, argv);
   // if you plan to use GMock, replace the line above with
@@ -0,0 +1,130 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+/*
+ * Cost of converting VL6180X ALS counts to lux: the float switch the driver used to have,
+ * the float gain table (VL6180X_FLOAT_LUX) and the Q16.16 path with a cached factor.
+ *
+ * The host has an FPU, so the float numbers here are a lower bound; on the Cortex-M0+
+ * every float operation is a library call and the gap is larger.
+ */
+
+#include <vl6180x_als.hpp>
+#include <chrono>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SENSOR_BENCHMARK_CYCLES() __rdtsc()
+#endif
+
+namespace {
+
+inline constexpr uint32_t kRounds = 200;
+inline constexpr uint32_t kNumOfCounts = 4096;
+inline constexpr uint16_t kIntegrationMs = 100;
+
+// GetAmbientLight before the gain table, per call
+__attribute__((noinline)) float LuxFloatSwitch(uint16_t count, VL6180xAlsGain gain, uint16_t integration_period) {
+  float als_integration_period = 100.0f / integration_period;
+  float als_gain = 0.0;
+  switch (gain) {
+    case kGain_20: als_gain = 20.0f;
+      break;
+    case kGain_10: als_gain = 10.32f;
+      break;
+    case kGain_5: als_gain = 5.21f;
+      break;
+    case kGain_2_5: als_gain = 2.60f;
+      break;
+    case kGain_1_67: als_gain = 1.72f;
+      break;
+    case kGain_1_25: als_gain = 1.28f;
+      break;
+    case kGain_1: als_gain = 1.01f;
+      break;
+    case kGain_40: als_gain = 40.0f;
+      break;
+  }
+  return 0.32f * (static_cast<float>(count) / als_gain) * als_integration_period;
+}
+
+__attribute__((noinline)) float LuxFloatTable(uint16_t count, VL6180xAlsGain gain, uint16_t integration_period) {
+  return Vl6180XLuxFloat(count, gain, integration_period);
+}
+
+__attribute__((noinline)) uint32_t LuxFixed(uint16_t count, uint64_t lux_per_count_q32) {
+  return Vl6180XLuxQ16(count, lux_per_count_q32);
+}
+
+template <typename Convert>
+void Run(const char *name, const uint16_t *counts, Convert convert) {
+  typedef decltype(convert(0)) Lux;
+  volatile Lux checksum = 0;
+#ifdef SENSOR_BENCHMARK_CYCLES
+  const uint64_t kCyclesStart = SENSOR_BENCHMARK_CYCLES();
+#endif
+  const auto kStart = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < kRounds; round++) {
+    Lux sum = 0;
+    for (uint32_t i = 0; i < kNumOfCounts; i++) {
+      sum += convert(counts[i]);
+    }
+    checksum = checksum + sum;
+  }
+  const auto kEnd = std::chrono::steady_clock::now();
+  const double kConversions = static_cast<double>(kRounds) * kNumOfCounts;
+  std::printf("%-12s %6.2f ns/conversion", name,
+              std::chrono::duration<double, std::nano>(kEnd - kStart).count() / kConversions);
+#ifdef SENSOR_BENCHMARK_CYCLES
+  std::printf("  %6.2f cycles/conversion", (SENSOR_BENCHMARK_CYCLES() - kCyclesStart) / kConversions);
+#endif
+  std::printf("\n");
+}
+
+}  // namespace
+
+int main() {
+  static uint16_t counts[kNumOfCounts];
+  uint32_t lfsr = 0xACE1u;
+  for (uint32_t i = 0; i < kNumOfCounts; i++) {
+    lfsr = lfsr * 1664525u + 1013904223u;
+    counts[i] = lfsr >> 16;
+  }
+  // Opaque gain and integration time, so neither path folds its constants
+  volatile uint8_t gain_index = kGain_1_25;
+  volatile uint16_t integration_ms = kIntegrationMs;
+  const VL6180xAlsGain kGain = VL6180xAlsGain(gain_index);
+  const uint16_t kIntegration = integration_ms;
+  const Vl6180XAlsScale kScale = Vl6180XMakeAlsScale(kGain, kIntegration);
+
+  Run("float switch", counts, [&](uint16_t count) { return LuxFloatSwitch(count, kGain, kIntegration); });
+  Run("float table", counts, [&](uint16_t count) { return LuxFloatTable(count, kGain, kIntegration); });
+  Run("q16.16", counts, [&](uint16_t count) { return LuxFixed(count, kScale.lux_per_count_q32); });
+  return 0;
+}
@@ -28,6 +28,7 @@
 
 #ifndef ADS7138_REGISTERS_HPP_
 #define ADS7138_REGISTERS_HPP_
+#include <i2c_register_table.hpp>
 
 inline constexpr uint8_t kReadNumOfBytes = 2;
 inline constexpr uint8_t kNumOfAdcChannels = 8;
@@ -36,7 +37,14 @@ inline constexpr uint8_t kNumOfAdcChannels = 8;
 // 16-bit is 2-bytes therefore the channels times 2
 inline constexpr const uint8_t kNumOfSensorDataBytes = 2*kNumOfAdcChannels;
 
+// In auto-sequence mode every 2-byte frame of a read clocks out the next channel,
+// so one read of this size returns a full scan starting at channel 0.
+inline constexpr uint8_t kSequenceBurstNumOfBytes = kReadNumOfBytes*kNumOfAdcChannels;
+
+inline constexpr uint8_t kAds7138StatusBusError = 1;  // SensorData status: burst read failed, previous scan repeated
+
 enum ChipRegisters {
+  kSystemStatus = 0x00,
   kGeneralConfig = 0x01,
   kPinConfig = 0x5,
   kSequenceConfig = 0x10,
@@ -52,6 +60,20 @@ enum ChipOpcodes {
   kContinuousWrite = 0b00101000,
 };
 
+// SYSTEM_STATUS bit 7 is reserved and reads 1, bit 4 is reserved and reads 0
+inline constexpr uint8_t kSystemStatusReservedMask = 0x90;
+inline constexpr uint8_t kSystemStatusReservedValue = 0x80;
 
+constexpr uint16_t Ads7138Register(ChipOpcodes opcode, ChipRegisters reg_addr) {
+  return reg_addr | (opcode << 8);
+}
+
+// Set-bit writes only touch one register, so this table must not be sent as bursts.
+inline constexpr I2CRegisterWrite kAds7138DefaultSettings[] = {
+    {Ads7138Register(kSetBit, kPinConfig), 0x0, 1},            // Channels are configured as Analog inps
+    {Ads7138Register(kSetBit, kGeneralConfig), 0b10, 1},       // SET CAL bit
+    {Ads7138Register(kSetBit, kAutoSeqSelChannel), 0xFF, 1},   // xF --> Set all adc channels as inputs. enabled in scanning sequence.
+    {Ads7138Register(kSetBit, kSequenceConfig), 0b01, 1},      // Set Auto sequence mode on = 1. And 4th for sequence start.
+};
 
 #endif  // ADS7138_REGISTERS_HPP_
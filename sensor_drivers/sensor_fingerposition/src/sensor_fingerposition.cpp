@@ -29,6 +29,12 @@
 #include <sensor_fingerposition.hpp>
 #include <ads7138_registers.hpp>
 
+bool FingerPositionSensor::Identify(I2CDriver *handle) {
+  uint8_t status = 0;
+  return handle->ReadReg(Ads7138Register(kSingleRead, kSystemStatus), &status) == 0
+         && (status & kSystemStatusReservedMask) == kSystemStatusReservedValue;
+}
+
 void FingerPositionSensor::Initialize(I2CDriver* handle) {
   i2c_handle_ = handle;
   i2c_handle_->ChangeAddress(kSensorI2CAddress_);
@@ -38,30 +44,39 @@ void FingerPositionSensor::Initialize(I2CDriver* handle) {
 
 SensorData FingerPositionSensor::GetSensorData() {
   sensor_data_.num_of_bytes = kNumOfSensorDataBytes;
+  sensor_data_.element_type = kSensorElementU16;
   readADC(sensor_data_.buffer);
+  sensor_data_.timestamp_us = SensorTimestampUs();
   sensor_data_.sample_num++;
   sensor_data_.sensor_id = 0x03;
   return sensor_data_;
 }
 
 void FingerPositionSensor::initDefaultRead(void) {
-  setRegister(kPinConfig, 0x0);                  // Channels are configured as Analog inps
-  setRegister(kGeneralConfig, 0b10);             // SET CAL bit
-  setRegister(kAutoSeqSelChannel, 0xFF);         // xF --> Set all adc channels as inputs. enabled in scanning sequence.
-  setRegister(kSequenceConfig, 0b01);            // Set Auto sequence mode on = 1. And 4th for sequence start.
+  i2c_handle_->WriteRegTable(kAds7138DefaultSettings, RegTableSize(kAds7138DefaultSettings), false);
 }
 
 void FingerPositionSensor::readADC(uint16_t *dest) {
-  startReadSEQ();
-  uint8_t temp[2] = {0x0, 0x0};
-  static uint16_t buf[8];
-
-  for (int i = 0; i < 8; i++) {
-    getReading(temp);
-    buf[i] = (temp[0] << 4) | (temp[1] >> 4);  // 12b conversion.
+  if (!sequence_running_ && startReadSEQ() != 0) {
+    sensor_data_.status = kAds7138StatusBusError;
+    return;
+  }
+  uint8_t temp[kSequenceBurstNumOfBytes] = {};
+  uint16_t buf[kNumOfAdcChannels];
+
+  // After a failed or short burst the sequence stands somewhere mid-scan,
+  // restart it on the next read so channel 0 comes first again.
+  if (getSequenceReadings(temp) != 0) {
+    stopReadSEQ();
+    sensor_data_.status = kAds7138StatusBusError;
+    return;
+  }
+  sensor_data_.status = 0;
+  for (uint8_t i = 0; i < kNumOfAdcChannels; i++) {
+    const uint8_t *reading = temp + i * kReadNumOfBytes;
+    buf[i] = (reading[0] << 4) | (reading[1] >> 4);  // 12b conversion.
   }
   reindexArray(dest, buf);
-  stopReadSEQ();
 }
 
 uint16_t FingerPositionSensor::assembleRegister(uint8_t opcode, uint8_t regAddr) {
@@ -69,19 +84,19 @@ uint16_t FingerPositionSensor::assembleRegister(uint8_t opcode, uint8_t regAddr)
   return asmb_register;
 }
 
-void FingerPositionSensor::writeRegister(uint8_t reg_addr, uint8_t data) {
+uint8_t FingerPositionSensor::writeRegister(uint8_t reg_addr, uint8_t data) {
   uint16_t reg = assembleRegister(kContinuousWrite, reg_addr);
-  i2c_handle_->WriteReg(reg, data);
+  return i2c_handle_->WriteReg(reg, data);
 }
 
-void FingerPositionSensor::setRegister(uint8_t reg_addr, uint8_t data) {
+uint8_t FingerPositionSensor::setRegister(uint8_t reg_addr, uint8_t data) {
   uint16_t reg = assembleRegister(kSetBit, reg_addr);
-  i2c_handle_->WriteReg(reg, data);
+  return i2c_handle_->WriteReg(reg, data);
 }
 
-void FingerPositionSensor::clearRegister(uint8_t reg_addr, uint8_t data) {
+uint8_t FingerPositionSensor::clearRegister(uint8_t reg_addr, uint8_t data) {
   uint16_t reg = assembleRegister(kClearBit, reg_addr);
-  i2c_handle_->WriteReg(reg, data);
+  return i2c_handle_->WriteReg(reg, data);
 }
 
 uint8_t FingerPositionSensor::getRegister(uint8_t register_addr) {
@@ -89,12 +104,16 @@ uint8_t FingerPositionSensor::getRegister(uint8_t register_addr) {
   return i2c_handle_->ReadReg(reg);
 }
 
-void FingerPositionSensor::startReadSEQ(void) {
-  setRegister(kSequenceConfig, 1 << 4);          // 4th bit starts the sequence.
+uint8_t FingerPositionSensor::startReadSEQ(void) {
+  const uint8_t kStatus = setRegister(kSequenceConfig, 1 << 4);  // 4th bit starts the sequence.
+  // Only a sequence that was started can be read in bursts, otherwise try again on the next read
+  sequence_running_ = kStatus == 0;
+  return kStatus;
 }
 
 void FingerPositionSensor::stopReadSEQ(void) {
   clearRegister(kSequenceConfig, 1 << 4);        // 4th bit reset the sequence.
+  sequence_running_ = false;
 }
 
 void FingerPositionSensor::reindexArray(uint16_t *dest, uint16_t *original) {
@@ -108,9 +127,14 @@ void FingerPositionSensor::reindexArray(uint16_t *dest, uint16_t *original) {
   dest[7] = original[kLiH];
 }
 
-void FingerPositionSensor::getReading(uint8_t *buf) {
-  i2c_handle_->ReadBytes(buf, kReadNumOfBytes);
+// Always read the full scan, a shorter read would leave the sequence mid-way and shift the channels of the next sample.
+uint8_t FingerPositionSensor::getSequenceReadings(uint8_t *buf) {
+  return i2c_handle_->ReadBytes(buf, kSequenceBurstNumOfBytes);
 }
 
-void FingerPositionSensor::Uninitialize() {}
+void FingerPositionSensor::Uninitialize() {
+  if (sequence_running_) {
+    stopReadSEQ();
+  }
+}
 
@@ -32,6 +32,7 @@
 #include <sensor_base.hpp>
 
 inline constexpr uint8_t kAds7138Addr = 0x10;
+inline constexpr I2CSpeed kAds7138MaxSpeed = kI2cSpeed_1MHz;  // Fast-mode Plus
 
 enum SensorMapIndex {
   kLower = 5,
@@ -44,10 +45,20 @@ enum SensorMapIndex {
   kLiH = 1,
 };
 
-class FingerPositionSensor : public UniversalSensor {
+class FingerPositionSensor final : public UniversalSensor {
  public:
   FingerPositionSensor() : UniversalSensor() {}
 
+  /**
+   * @brief Addresses probed by SensorEnumerator
+   */
+  static constexpr uint8_t kProbeAddresses[] = {kAds7138Addr};
+
+  /**
+   * @brief Check the reserved bits of SYSTEM_STATUS, handle must already be set to the sensor's address
+   */
+  static bool Identify(I2CDriver *handle);
+
   /**
   * @brief Initialises the sensor with its default settings
   * 
@@ -66,13 +77,17 @@ class FingerPositionSensor : public UniversalSensor {
 
   /**
   * @brief Read the sensor
+  *
+  * @note The first read starts the auto-sequence, it is left running so every sample
+  *       after that is a single burst read of all channels. When the burst fails the previous
+  *       values are repeated with status kAds7138StatusBusError and the sequence is restarted.
   * 
   * @return SensorData_t SensorData struct with the sensordata, sample_num and sensor_id
   */
   SensorData GetSensorData() override;
 
   /**
-  * @brief Uninitialize the sensor
+  * @brief Uninitialize the sensor, stops the auto-sequence when it is running
   */
   void Uninitialize() override;
   ~FingerPositionSensor() {
@@ -85,29 +100,30 @@ class FingerPositionSensor : public UniversalSensor {
     * @return Availability status
     */
   const bool Available() override {
-    return false;  // TODO
+    return i2c_handle_ != nullptr && i2c_handle_->SensorAvailable();
   }
 
  private:
   const uint8_t SensorType_ = 0x03;
   const uint8_t kSensorI2CAddress_ = kAds7138Addr;
-  I2CDriver *i2c_handle_;
+  I2CDriver *i2c_handle_ = nullptr;
   SensorData sensor_data_{};
+  bool sequence_running_ = false;
 
   void initDefaultRead(void);
   void readADC(uint16_t *dest);
   uint16_t assembleRegister(uint8_t opcode, uint8_t reg_addr);
 
   // Low Level I2C communication:
-  void writeRegister(uint8_t reg_addr, uint8_t data);
-  void setRegister(uint8_t reg_addr, uint8_t data);
-  void clearRegister(uint8_t reg_addr, uint8_t data);
+  uint8_t writeRegister(uint8_t reg_addr, uint8_t data);
+  uint8_t setRegister(uint8_t reg_addr, uint8_t data);
+  uint8_t clearRegister(uint8_t reg_addr, uint8_t data);
   uint8_t getRegister(uint8_t register_addr);
 
-  void startReadSEQ(void);
+  uint8_t startReadSEQ(void);
   void stopReadSEQ(void);
   void reindexArray(uint16_t *dest, uint16_t *original);
-  void getReading(uint8_t *buf);
+  uint8_t getSequenceReadings(uint8_t *buf);
 };
 
 typedef FingerPositionSensor CompressionPositionSensor;
@@ -35,6 +35,8 @@ using ::testing::Return;
 using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::Mock;
+using ::testing::DoAll;
+using ::testing::SetArgPointee;
 using ::testing::_;
 
 constexpr uint16_t ProcessedVal(uint8_t *buffer) {
@@ -42,7 +44,9 @@ constexpr uint16_t ProcessedVal(uint8_t *buffer) {
 }
 
 uint8_t arb_test_buffer[16] = {0x05, 0x00, 0x85, 0x99,
-                               0x91, 0x74, 0x55, 0x14};
+                               0x91, 0x74, 0x55, 0x14,
+                               0xA3, 0x50, 0x0F, 0xF0,
+                               0x7E, 0x20, 0x31, 0xC0};
 
 uint16_t arb_test_buffer_processed[8] =
     {ProcessedVal(arb_test_buffer), ProcessedVal(arb_test_buffer + 2),
@@ -55,16 +59,14 @@ uint16_t arb_test_buffer_reindexed[8] =
      arb_test_buffer_processed[kMidH], arb_test_buffer_processed[kReL], arb_test_buffer_processed[kReH],
      arb_test_buffer_processed[kLiL], arb_test_buffer_processed[kLiH]};
 
-int buffer_index = 0;
-
 uint16_t AssembleRegister(uint8_t opcode, uint8_t regAddr) {
   uint16_t output = regAddr | (opcode << 8);
   return output;
 }
 
-void CopyArbTestBufferToBuffer(uint8_t *buffer, uint8_t num_of_bytes) {
-  memcpy(buffer, arb_test_buffer + buffer_index, num_of_bytes);
-  buffer_index += 2;
+uint8_t CopyArbTestBufferToBuffer(uint8_t *buffer, uint8_t num_of_bytes) {
+  memcpy(buffer, arb_test_buffer, num_of_bytes);
+  return 0;
 }
 
 TEST(FingerPositionTest, initCalls) {
@@ -82,6 +84,8 @@ TEST(FingerPositionTest, initCalls) {
   FingerPositionSensor finger_pos_sensor;
   /* Setup mock calls */
   EXPECT_CALL(i2c_mock_handle, ChangeAddress(kAds7138Addr));
+  // The ADS7138 opcodes address a single register, writes must never be merged
+  EXPECT_CALL(i2c_mock_handle, RegTableWritten(RegTableSize(kAds7138DefaultSettings), false));
   {
     InSequence Seq;
     EXPECT_CALL(i2c_mock_handle, WriteReg(kReg1, kData1));
@@ -98,8 +102,6 @@ TEST(FingerPositionTest, GetSensorData) {
   /* Initialize handles and classes */
   const uint16_t kReg1 = AssembleRegister(kSetBit, kSequenceConfig);
   const uint8_t kData1 = 1 << 4;
-  const uint16_t kReg2 = AssembleRegister(kClearBit, kSequenceConfig);
-  const uint8_t kData2 = 1 << 4;
   // Initialize mocks
   I2CDriver i2c_mock_handle;
   FingerPositionSensor finger_pos_sensor;
@@ -109,9 +111,8 @@ TEST(FingerPositionTest, GetSensorData) {
   {
     InSequence seq;
     EXPECT_CALL(i2c_mock_handle, WriteReg(kReg1, kData1));
-    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kReadNumOfBytes)).Times(kNumOfAdcChannels)
-        .WillRepeatedly(Invoke(CopyArbTestBufferToBuffer));
-    EXPECT_CALL(i2c_mock_handle, WriteReg(kReg2, kData2));
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes))
+        .WillOnce(Invoke(CopyArbTestBufferToBuffer));
   }
 
   /* Run the "real" call */
@@ -125,6 +126,99 @@ TEST(FingerPositionTest, GetSensorData) {
   Mock::VerifyAndClearExpectations(&i2c_mock_handle);
 }
 
+TEST(FingerPositionTest, SequenceKeepsRunningBetweenSamples) {
+  const uint16_t kStartReg = AssembleRegister(kSetBit, kSequenceConfig);
+  const uint16_t kStopReg = AssembleRegister(kClearBit, kSequenceConfig);
+  const uint8_t kSeqStartBit = 1 << 4;
+  I2CDriver i2c_mock_handle;
+  FingerPositionSensor finger_pos_sensor;
+  finger_pos_sensor.Initialize(&i2c_mock_handle);
+
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStartReg, kSeqStartBit)).Times(1);
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes)).Times(3)
+        .WillRepeatedly(Invoke(CopyArbTestBufferToBuffer));
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStopReg, kSeqStartBit)).Times(1);
+  }
+  EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kReadNumOfBytes)).Times(0);
+
+  for (int i = 0; i < 3; i++) {
+    SensorData data = finger_pos_sensor.GetSensorData();
+    EXPECT_EQ(i + 1, data.sample_num);
+    EXPECT_EQ(arb_test_buffer_reindexed[0], data.buffer[0]);
+  }
+  finger_pos_sensor.Uninitialize();
+  finger_pos_sensor.Uninitialize();  // Already stopped, no second write
+  Mock::VerifyAndClearExpectations(&i2c_mock_handle);
+}
+
+TEST(FingerPositionTest, FailedBurstRestartsSequence) {
+  const uint16_t kStartReg = AssembleRegister(kSetBit, kSequenceConfig);
+  const uint16_t kStopReg = AssembleRegister(kClearBit, kSequenceConfig);
+  const uint8_t kSeqStartBit = 1 << 4;
+  const uint8_t kNack = 2;
+  I2CDriver i2c_mock_handle;
+  FingerPositionSensor finger_pos_sensor;
+  finger_pos_sensor.Initialize(&i2c_mock_handle);
+
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStartReg, kSeqStartBit));
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes))
+        .WillOnce(Invoke(CopyArbTestBufferToBuffer));
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes)).WillOnce(Return(kNack));
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStopReg, kSeqStartBit));
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStartReg, kSeqStartBit));
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes))
+        .WillOnce(Invoke(CopyArbTestBufferToBuffer));
+  }
+
+  EXPECT_EQ(finger_pos_sensor.GetSensorData().status, 0);
+  SensorData failed = finger_pos_sensor.GetSensorData();
+  EXPECT_EQ(failed.status, kAds7138StatusBusError);
+  for (uint8_t i = 0; i < kNumOfAdcChannels; i++) {
+    EXPECT_EQ(arb_test_buffer_reindexed[i], failed.buffer[i]);
+  }
+  EXPECT_EQ(finger_pos_sensor.GetSensorData().status, 0);
+  Mock::VerifyAndClearExpectations(&i2c_mock_handle);
+}
+
+TEST(FingerPositionTest, FailedStartIsRetriedBeforeReading) {
+  const uint16_t kStartReg = AssembleRegister(kSetBit, kSequenceConfig);
+  const uint8_t kSeqStartBit = 1 << 4;
+  const uint8_t kNack = 2;
+  I2CDriver i2c_mock_handle;
+  FingerPositionSensor finger_pos_sensor;
+  finger_pos_sensor.Initialize(&i2c_mock_handle);
+
+  {
+    InSequence seq;
+    // No burst from a sequence that never started
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStartReg, kSeqStartBit)).WillOnce(Return(kNack));
+    EXPECT_CALL(i2c_mock_handle, WriteReg(kStartReg, kSeqStartBit)).WillOnce(Return(0));
+    EXPECT_CALL(i2c_mock_handle, ReadBytes(_, kSequenceBurstNumOfBytes))
+        .WillOnce(Invoke(CopyArbTestBufferToBuffer));
+  }
+
+  EXPECT_EQ(finger_pos_sensor.GetSensorData().status, kAds7138StatusBusError);
+  EXPECT_EQ(finger_pos_sensor.GetSensorData().status, 0);
+  Mock::VerifyAndClearExpectations(&i2c_mock_handle);
+}
+
+TEST(FingerPositionTest, IdentifyChecksSystemStatus) {
+  I2CDriver i2c_mock_handle;
+  const uint16_t kStatusReg = Ads7138Register(kSingleRead, kSystemStatus);
+  EXPECT_CALL(i2c_mock_handle, ReadReg(kStatusReg, _))
+      .WillOnce(DoAll(SetArgPointee<1>(0x81), Return(0)))     // power-up value, BOR set
+      .WillOnce(DoAll(SetArgPointee<1>(0xFF), Return(0)))
+      .WillOnce(Return(2));                                    // NACK
+  EXPECT_TRUE(FingerPositionSensor::Identify(&i2c_mock_handle));
+  EXPECT_FALSE(FingerPositionSensor::Identify(&i2c_mock_handle));
+  EXPECT_FALSE(FingerPositionSensor::Identify(&i2c_mock_handle));
+  Mock::VerifyAndClearExpectations(&i2c_mock_handle);
+}
+
 int main(int argc, char **argv) {
   // ::testing::InitGoogleTest(&argc, argv);
   // if you plan to use GMock, replace the line above with
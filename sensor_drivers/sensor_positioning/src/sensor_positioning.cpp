@@ -188,12 +188,22 @@ uint8_t PositioningSensor::InitBMI_Sensor(void) {
   //return 0;
 }
 
+bool PositioningSensor::Identify(I2CDriver *handle) {
+  // BMI270 registers have 8-bit addresses, ReadReg sends 16
+  const uint8_t kChipIdReg = BMI2_CHIP_ID_ADDR;
+  uint8_t chip_id = 0;
+  return handle->WriteRead(&kChipIdReg, 1, &chip_id, 1) == 0 && chip_id == BMI270_CHIP_ID;
+}
+
 void PositioningSensor::Initialize(I2CDriver* handle) {
-  handle->ChangeAddress(kSensorI2CAddress_);
+  handle->ChangeAddress(sensor_i2c_address_);
   if (handle->SensorAvailable()) {
     i2c_handle_ = handle;
-    i2c_handle_->ChangeAddress(kSensorI2CAddress_);
+    i2c_handle_->ChangeAddress(sensor_i2c_address_);
     int8_t status = InitBMI_Sensor();
+    if (status == BMI2_OK) {
+      EnableFifo();
+    }
     sensor_data_.sample_num = 0;
   }
 }
@@ -224,15 +234,14 @@ const bool PositioningSensor::Available() {
 
 int8_t PositioningSensor::bmi2_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr)
 {
-  if ((reg_data == NULL) || (len == 0) || (len > 32)) {
+  // FIFO reads are not split by read_write_len, so allow everything one transaction can carry
+  if ((reg_data == NULL) || (len == 0) || (len > UINT8_MAX)) {
     return -1;
   }
 
   struct dev_info* dev_info = (struct dev_info*)intf_ptr;
 
-  if (dev_info->_i2c_handle_->SendByte(reg_addr) == 0) {
-    dev_info->_i2c_handle_->ReadBytes(reg_data, len);
-  } else {
+  if (dev_info->_i2c_handle_->WriteRead(&reg_addr, 1, reg_data, len) != 0) {
     return -1;
   }
 
@@ -280,18 +289,19 @@ Orientation3D PositioningSensor::GetMagnetoInfo() {
       */
 
 SensorData PositioningSensor::GetSensorData() {
-  SensorData sensor_data_;
 
+  sensor_data_.element_type = kSensorElementI16;
 #ifndef USE_MAGNETOMETER
-  sensor_data_.num_of_bytes = 6; // g.x/y/z; a.x/y/z
+  sensor_data_.num_of_bytes = 6 * 2; // g.x/y/z; a.x/y/z
 #endif
 
 #ifdef USE_MAGNETOMETER
-  sensor_data_.num_of_bytes = 9; // g.x/y/z; a.x/y/z; m.x/y/z;
+  sensor_data_.num_of_bytes = 9 * 2; // g.x/y/z; a.x/y/z; m.x/y/z;
   Orientation3D magnetOrientation = GetMagnetoInfo();
 #endif
   Orientation3D gyroscOrientation = GetGyroscopeInfo();
   Orientation3D accelerOrientation = GetAcceleroInfo();
+  sensor_data_.timestamp_us = SensorTimestampUs();
 
   sensor_data_.buffer[0] = gyroscOrientation.x;
   sensor_data_.buffer[1] = gyroscOrientation.y;
@@ -314,6 +324,87 @@ SensorData PositioningSensor::GetSensorData() {
   return sensor_data_;
 }
 
+/**
+      * @brief Buffer accel and gyro frames in the FIFO, with headers so both can be told apart,
+      *        and a sensortime frame when the FIFO is read empty
+      */
+int8_t PositioningSensor::EnableFifo() {
+  int8_t rslt = bmi2_set_fifo_config(BMI2_FIFO_ALL_EN, BMI2_DISABLE, &bmiSensor);
+  if (rslt == BMI2_OK) {
+    rslt = bmi2_set_fifo_config(BMI2_FIFO_ACC_EN | BMI2_FIFO_GYR_EN | BMI2_FIFO_HEADER_EN | BMI2_FIFO_TIME_EN,
+                                BMI2_ENABLE, &bmiSensor);
+  }
+  fifo_enabled_ = (rslt == BMI2_OK);
+  return rslt;
+}
+
+size_t PositioningSensor::ReadSamples(SensorData_t *samples, size_t max_samples) {
+  if (!fifo_enabled_) {
+    return UniversalSensor::ReadSamples(samples, max_samples);
+  }
+
+  uint16_t fifo_length = 0;
+  if (bmi2_get_fifo_length(&fifo_length, &bmiSensor) != BMI2_OK) {
+    return 0;
+  }
+  uint16_t max_frames = max_samples < kBmi270FifoMaxFrames ? max_samples : kBmi270FifoMaxFrames;
+  uint16_t num_of_frames = fifo_length / kBmi270FifoFrameSize;
+  const bool kDrainsFifo = num_of_frames <= max_frames;
+  if (!kDrainsFifo) {
+    num_of_frames = max_frames;
+  }
+  if (num_of_frames == 0) {
+    return 0;
+  }
+
+  // Only whole frames are read, what is left stays in the FIFO for the next call.
+  // Reading the FIFO empty appends the sensortime frame.
+  struct bmi2_fifo_frame fifo_frame = {};
+  fifo_frame.data = fifo_buffer_;
+  fifo_frame.length = num_of_frames * kBmi270FifoFrameSize + bmiSensor.dummy_byte
+                      + (kDrainsFifo ? kBmi270SensortimeFrameSize : 0);
+  if (bmi2_read_fifo_data(&fifo_frame, &bmiSensor) != BMI2_OK) {
+    return 0;
+  }
+  const uint32_t kReadTimestamp = SensorTimestampUs();
+
+  uint16_t num_of_accel = num_of_frames;
+  uint16_t num_of_gyro = num_of_frames;
+  bmi2_extract_accel(fifo_accel_, &num_of_accel, &fifo_frame, &bmiSensor);
+  bmi2_extract_gyro(fifo_gyro_, &num_of_gyro, &fifo_frame, &bmiSensor);
+  const uint16_t kNumOfSamples = num_of_accel < num_of_gyro ? num_of_accel : num_of_gyro;
+
+  // The sensortime between two empty reads spans the frames read in between,
+  // which gives the real frame period to date the frames back from the read.
+  fifo_frames_since_sensortime_ += kNumOfSamples;
+  if (kDrainsFifo && fifo_frames_since_sensortime_ != 0) {
+    if (fifo_sensortime_valid_) {
+      const uint32_t kTicks = (fifo_frame.sensor_time - fifo_sensortime_) & kBmi270SensortimeMask;
+      fifo_period_us_ = static_cast<uint64_t>(kTicks) * 390625 / 10000 / fifo_frames_since_sensortime_;
+    }
+    fifo_sensortime_ = fifo_frame.sensor_time;
+    fifo_sensortime_valid_ = true;
+    fifo_frames_since_sensortime_ = 0;
+  }
+
+  for (uint16_t i = 0; i < kNumOfSamples; i++) {
+    SensorData_t &sample = samples[i];
+    sample.timestamp_us = kReadTimestamp - (kNumOfSamples - 1 - i) * fifo_period_us_;
+    sample.num_of_bytes = 6 * 2;  // g.x/y/z; a.x/y/z, raw LSB
+    sample.element_type = kSensorElementI16;
+    sample.buffer[0] = fifo_gyro_[i].x;
+    sample.buffer[1] = fifo_gyro_[i].y;
+    sample.buffer[2] = fifo_gyro_[i].z;
+    sample.buffer[3] = fifo_accel_[i].x;
+    sample.buffer[4] = fifo_accel_[i].y;
+    sample.buffer[5] = fifo_accel_[i].z;
+    sample.sample_num = ++sensor_data_.sample_num;
+    sample.sensor_id = POSITIONING_SENSOR;
+    sample.status = 0;
+  }
+  return kNumOfSamples;
+}
+
 int8_t PositioningSensor::bmi2_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr)
 {
   if ((reg_data == NULL) || (len == 0) || (len > 32)) {
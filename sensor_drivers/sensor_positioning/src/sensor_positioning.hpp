@@ -33,6 +33,15 @@
 #include "BMI270/bmi270.h"
 
 inline constexpr uint8_t kBMI270Addr = 0x68; // either 0x68 or 0x69 (latter is with jumper closed)
+inline constexpr uint8_t kBMI270AltAddr = 0x69;
+inline constexpr I2CSpeed kBMI270MaxSpeed = kI2cSpeed_1MHz;  // Fast-mode Plus
+
+// Frames drained per ReadSamples call, a headered accel+gyro frame is 1 + 12 bytes
+inline constexpr uint8_t kBmi270FifoMaxFrames = 16;
+inline constexpr uint8_t kBmi270FifoFrameSize = 1 + BMI2_FIFO_ACC_GYR_LENGTH;
+inline constexpr uint8_t kBmi270SensortimeFrameSize = 1 + BMI2_SENSOR_TIME_LENGTH;
+inline constexpr uint16_t kBmi270FifoBufferSize = kBmi270FifoMaxFrames * kBmi270FifoFrameSize + kBmi270SensortimeFrameSize;
+inline constexpr uint32_t kBmi270SensortimeMask = 0xFFFFFF;  // 24 bit counter, 39.0625 us per tick
 
 /*! Macros to select the sensors                   */
 #define ACCEL          UINT8_C(0x00)
@@ -58,10 +67,27 @@ typedef enum {
 } ACCEL_RANGE;
 
 
-class PositioningSensor : public UniversalSensor {
+class PositioningSensor final : public UniversalSensor {
 public:
     PositioningSensor() : UniversalSensor() {}
 
+    /**
+     * @brief Addresses probed by SensorEnumerator
+     */
+    static constexpr uint8_t kProbeAddresses[] = {kBMI270Addr, kBMI270AltAddr};
+
+    /**
+     * @brief Check the chip ID, handle must already be set to the sensor's address
+     */
+    static bool Identify(I2CDriver *handle);
+
+    /**
+     * @brief Address used by the next Initialize
+     */
+    void SetI2CAddress(uint8_t i2c_addr) {
+      sensor_i2c_address_ = i2c_addr;
+    }
+
     /**
     * @brief Initialises the sensor with its default settings
     *
@@ -86,6 +112,13 @@ public:
     */
     SensorData GetSensorData() override;
 
+    /**
+    * @brief Drain the accel+gyro frames buffered in the BMI270 FIFO
+    *
+    * @return Number of samples written, at most kBmi270FifoMaxFrames per call
+    */
+    size_t ReadSamples(SensorData_t *samples, size_t max_samples) override;
+
     /**
     * @brief Uninitialize the sensor
     */
@@ -101,7 +134,7 @@ public:
 
 private:
     const uint8_t SensorType_ = 0x03;
-    const uint8_t kSensorI2CAddress_ = kBMI270Addr;
+    uint8_t sensor_i2c_address_ = kBMI270Addr;
     I2CDriver *i2c_handle_;
     SensorData sensor_data_{};
 
@@ -120,6 +153,18 @@ private:
     static void bmi2_delay_us(uint32_t period, void *intf_ptr);
 
     int8_t configure_sensor(struct bmi2_dev *dev);
+    int8_t EnableFifo();
+
+    bool fifo_enabled_ = false;
+    uint8_t fifo_buffer_[kBmi270FifoBufferSize + 1];  // + the dummy byte SPI reads start with
+    struct bmi2_sens_axes_data fifo_accel_[kBmi270FifoMaxFrames];
+    struct bmi2_sens_axes_data fifo_gyro_[kBmi270FifoMaxFrames];
+
+    // Sensortime pacing of FIFO frames, see ReadSamples
+    bool fifo_sensortime_valid_ = false;
+    uint32_t fifo_sensortime_ = 0;
+    uint32_t fifo_frames_since_sensortime_ = 0;
+    uint32_t fifo_period_us_ = 0;
 
     bool _initialized = false;
 
@@ -29,9 +29,45 @@
 #ifndef SDP810_REGISTERS_HPP_
 #define SDP810_REGISTERS_HPP_
 
-inline constexpr uint8_t kSdp810BytesToReturn = 2;
+inline constexpr uint8_t kSdp810BytesToReturn = 4;   // Pressure ticks and scale factor, both int16_t
 inline constexpr uint8_t kSdp810InitCmdSize = 2;
 inline constexpr uint8_t kContMassFlowAvgMsb = 0x36;
 inline constexpr uint8_t kContMassFlowAvgLsb = 0x03;
+inline constexpr uint8_t kContMassFlowMsb = 0x36;
+inline constexpr uint8_t kContMassFlowLsb = 0x08;
+inline constexpr uint8_t kContDiffPressureAvgMsb = 0x36;
+inline constexpr uint8_t kContDiffPressureAvgLsb = 0x15;
+inline constexpr uint8_t kContDiffPressureMsb = 0x36;
+inline constexpr uint8_t kContDiffPressureLsb = 0x1E;
+// Triggered with clock stretching: the read is held until the measurement is done
+inline constexpr uint8_t kTrigMassFlowStretchMsb = 0x37;
+inline constexpr uint8_t kTrigMassFlowStretchLsb = 0x26;
+inline constexpr uint8_t kTrigDiffPressureStretchMsb = 0x37;
+inline constexpr uint8_t kTrigDiffPressureStretchLsb = 0x2D;
+
+inline constexpr uint8_t kStopContMeasurementMsb = 0x3F;
+inline constexpr uint8_t kStopContMeasurementLsb = 0xF9;
+inline constexpr uint16_t kSdp810StopDelayUs = 500;         // Commands are ignored this long after a stop
+inline constexpr uint8_t kGeneralCallAddr = 0x00;
+inline constexpr uint8_t kGeneralCallReset = 0x06;
+inline constexpr uint16_t kSdp810ResetDelayUs = 2000;
+inline constexpr uint8_t kReadProductIdMsb = 0x36;
+inline constexpr uint8_t kReadProductIdLsb = 0x7C;
+inline constexpr uint8_t kReadProductIdNextMsb = 0xE1;
+inline constexpr uint8_t kReadProductIdNextLsb = 0x02;
+// Product number word 1 and word 2, each followed by its CRC
+inline constexpr uint8_t kSdp810ProductIdSize = 6;
+inline constexpr uint16_t kSdp8xxProductFamily = 0x0302;    // upper word of every SDP8xx product number
+inline constexpr uint8_t kSdp810CrcPolynomial = 0x31;
+inline constexpr uint8_t kSdp810CrcInit = 0xFF;
+
+// Measurement frame: pressure, temperature and scale factor words, each followed by its CRC
+inline constexpr uint8_t kSdp810WordSize = 3;
+inline constexpr uint8_t kSdp810PressureOffset = 0;
+inline constexpr uint8_t kSdp810TemperatureOffset = 3;
+inline constexpr uint8_t kSdp810ScaleFactorOffset = 6;
+inline constexpr int16_t kSdp810TemperatureScale = 200;     // raw / 200 = degrees Celsius
+inline constexpr uint8_t kSdp810StatusCrcError = 1;          // SensorData status: previous pressure repeated
+inline constexpr uint8_t kSdp810StatusBusError = 2;          // SensorData status: read failed, previous pressure repeated
 
 #endif  // SDP810_REGISTERS_HPP_
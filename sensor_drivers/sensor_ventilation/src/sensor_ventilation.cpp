@@ -29,6 +29,74 @@
 #include <sensor_ventilation.hpp>
 #include <sdp810_registers.hpp>
 
+#ifdef __arm__
+#ifdef Arduino
+#include "Arduino.h"
+#else
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
+#elif _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif  // __arm__
+
+static uint8_t Sdp810Crc(const uint8_t *data, uint8_t num_of_bytes) {
+  uint8_t crc = kSdp810CrcInit;
+  for (uint8_t i = 0; i < num_of_bytes; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ kSdp810CrcPolynomial : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Indexed by Sdp810Mode and Sdp810Compensation
+static const uint8_t kSdp810ModeCommands[3][2][kSdp810InitCmdSize] = {
+    {{kContMassFlowAvgMsb, kContMassFlowAvgLsb}, {kContDiffPressureAvgMsb, kContDiffPressureAvgLsb}},
+    {{kContMassFlowMsb, kContMassFlowLsb}, {kContDiffPressureMsb, kContDiffPressureLsb}},
+    {{kTrigMassFlowStretchMsb, kTrigMassFlowStretchLsb}, {kTrigDiffPressureStretchMsb, kTrigDiffPressureStretchLsb}},
+};
+
+// SensorTimestampUs only moves per tick on target, so it can not time waits shorter than a few ticks
+static void Sdp810Wait(uint16_t delay_us) {
+#ifdef __arm__
+#ifdef Arduino
+  delayMicroseconds(delay_us);
+#else
+  // vTaskDelay(n) may return right after the n-th tick boundary, one extra tick makes the wait at least delay_us
+  const TickType_t kTicks = (static_cast<uint32_t>(delay_us) * configTICK_RATE_HZ + 999999) / 1000000 + 1;
+  vTaskDelay(kTicks);
+#endif
+#elif _WIN32
+  Sleep((delay_us + 999) / 1000);
+#else
+  usleep(delay_us);
+#endif  // __arm__
+}
+
+bool DifferentialPressureSensor::Identify(I2CDriver *handle) {
+  uint8_t stop_message[kSdp810InitCmdSize] = {kStopContMeasurementMsb, kStopContMeasurementLsb};
+  uint8_t id_message[kSdp810InitCmdSize] = {kReadProductIdMsb, kReadProductIdLsb};
+  uint8_t id_next_message[kSdp810InitCmdSize] = {kReadProductIdNextMsb, kReadProductIdNextLsb};
+  uint8_t product_id[kSdp810ProductIdSize] = {};
+  if (handle->SendBytes(stop_message, kSdp810InitCmdSize) != 0) {
+    return false;
+  }
+  Sdp810Wait(kSdp810StopDelayUs);  // A measuring part ignores the ID commands until the stop has settled
+  if (handle->SendBytes(id_message, kSdp810InitCmdSize) != 0
+      || handle->SendBytes(id_next_message, kSdp810InitCmdSize) != 0
+      || handle->ReadBytes(product_id, kSdp810ProductIdSize) != 0) {
+    return false;
+  }
+
+  const uint16_t kFamily = (product_id[0] << 8) | product_id[1];
+  return Sdp810Crc(&product_id[0], 2) == product_id[2] && Sdp810Crc(&product_id[3], 2) == product_id[5]
+         && kFamily == kSdp8xxProductFamily;
+}
+
 void DifferentialPressureSensor::Initialize(I2CDriver* handle) {
   i2c_handle_ = handle;
   i2c_handle_->ChangeAddress(kSensorI2CAddress_);
@@ -38,25 +106,127 @@ void DifferentialPressureSensor::Initialize(I2CDriver* handle) {
 
 SensorData DifferentialPressureSensor::GetSensorData() {
   ReadSdp810();
+  sensor_data_.timestamp_us = SensorTimestampUs();
   sensor_data_.num_of_bytes = kSdp810BytesToReturn;
+  sensor_data_.element_type = kSensorElementI16;
   sensor_data_.buffer[0] = sensor_raw_;
+  sensor_data_.buffer[1] = conversion_factor_;
   sensor_data_.sample_num++;
   sensor_data_.sensor_id = 0x02;
   return sensor_data_;
 }
 
+size_t DifferentialPressureSensor::ReadSamples(SensorData_t *samples, size_t max_samples) {
+  if (max_samples == 0) {
+    return 0;
+  }
+  samples[0] = DifferentialPressureSensor::GetSensorData();
+  return 1;
+}
+
 void DifferentialPressureSensor::BeginSDP810() {
-  uint8_t init_message[kSdp810InitCmdSize] = {kContMassFlowAvgMsb,
-                                              kContMassFlowAvgLsb};
-  i2c_handle_->SendBytes(init_message, kSdp810InitCmdSize);
+  if (mode_ == kSdp810Triggered) {
+    return;
+  }
+  SendCommand(kSdp810ModeCommands[mode_][compensation_][0], kSdp810ModeCommands[mode_][compensation_][1]);
+  measuring_ = true;
+}
+
+void DifferentialPressureSensor::SendCommand(uint8_t msb, uint8_t lsb) {
+  uint8_t command[kSdp810InitCmdSize] = {msb, lsb};
+  i2c_handle_->SendBytes(command, kSdp810InitCmdSize);
+}
+
+void DifferentialPressureSensor::SetMeasurementMode(Sdp810Mode mode, Sdp810Compensation compensation) {
+  StopMeasurement();
+  mode_ = mode;
+  compensation_ = compensation;
+  BeginSDP810();
+}
+
+void DifferentialPressureSensor::StopMeasurement() {
+  if (!measuring_) {
+    return;
+  }
+  SendCommand(kStopContMeasurementMsb, kStopContMeasurementLsb);
+  measuring_ = false;
+  Sdp810Wait(kSdp810StopDelayUs);
+}
+
+void DifferentialPressureSensor::SoftReset() {
+  i2c_handle_->ChangeAddress(kGeneralCallAddr);
+  i2c_handle_->SendByte(kGeneralCallReset);
+  i2c_handle_->ChangeAddress(kSensorI2CAddress_);
+  measuring_ = false;
+  Sdp810Wait(kSdp810ResetDelayUs);
+}
+
+void DifferentialPressureSensor::EnableStreaming(uint16_t temperature_interval) {
+  streaming_ = true;
+  scale_factor_valid_ = false;
+  temperature_interval_ = temperature_interval;
+  reads_since_full_frame_ = 0;
+  crc_errors_ = 0;
 }
 
 void DifferentialPressureSensor::ReadSdp810() {
-  i2c_handle_->ReadBytes(sensor_buffer_, kSdp810BufferSize);
+  if (mode_ == kSdp810Triggered) {
+    SendCommand(kSdp810ModeCommands[mode_][compensation_][0], kSdp810ModeCommands[mode_][compensation_][1]);
+  }
+  if (streaming_) {
+    ReadSdp810Streaming();
+    return;
+  }
+  if (i2c_handle_->ReadBytes(sensor_buffer_, kSdp810BufferSize) != 0) {
+    sensor_data_.status = kSdp810StatusBusError;
+    return;
+  }
+  sensor_data_.status = 0;
 
   conversion_factor_ = (sensor_buffer_[6] << (kSdp810BufferSize - 1) | sensor_buffer_[7]);
   sensor_raw_ = (sensor_buffer_[0] << (kSdp810BufferSize - 1) | sensor_buffer_[1]);
-  sensor_raw_ = (sensor_raw_ / conversion_factor_);
+}
+
+bool DifferentialPressureSensor::ValidWord(const uint8_t *word) {
+  if (Sdp810Crc(word, 2) == word[2]) {
+    return true;
+  }
+  crc_errors_++;
+  return false;
+}
+
+/**
+ * @brief The SDP810 lets the master stop reading after any byte, so the pressure word alone
+ *        is a complete transfer once the scale factor is known
+ */
+void DifferentialPressureSensor::ReadSdp810Streaming() {
+  const bool kFullFrame = !scale_factor_valid_ ||
+                          (temperature_interval_ != 0 && reads_since_full_frame_ >= temperature_interval_);
+  if (i2c_handle_->ReadBytes(sensor_buffer_, kFullFrame ? kSdp810BufferSize : kSdp810WordSize) != 0) {
+    sensor_data_.status = kSdp810StatusBusError;
+    return;
+  }
+  reads_since_full_frame_ = kFullFrame ? 0 : reads_since_full_frame_ + 1;
+
+  if (kFullFrame) {
+    if (ValidWord(&sensor_buffer_[kSdp810TemperatureOffset])) {
+      temperature_raw_ = (sensor_buffer_[kSdp810TemperatureOffset] << 8) | sensor_buffer_[kSdp810TemperatureOffset + 1];
+    }
+    if (ValidWord(&sensor_buffer_[kSdp810ScaleFactorOffset])) {
+      const int16_t kScaleFactor = (sensor_buffer_[kSdp810ScaleFactorOffset] << 8) |
+                                   sensor_buffer_[kSdp810ScaleFactorOffset + 1];
+      if (kScaleFactor > 0) {
+        conversion_factor_ = kScaleFactor;
+        scale_factor_valid_ = true;
+      }
+    }
+  }
+  if (!ValidWord(&sensor_buffer_[kSdp810PressureOffset]) || !scale_factor_valid_) {
+    sensor_data_.status = kSdp810StatusCrcError;
+    return;
+  }
+  sensor_data_.status = 0;
+  sensor_raw_ = (sensor_buffer_[kSdp810PressureOffset] << 8) | sensor_buffer_[kSdp810PressureOffset + 1];
 }
 
 void DifferentialPressureSensor::Uninitialize() {}
@@ -34,10 +34,49 @@
 inline constexpr uint8_t kSdp810I2CAddr = 0x25;
 inline constexpr uint8_t kSdp810BufferSize = 9;
 
-class DifferentialPressureSensor : public UniversalSensor {
+/**
+ * @brief Differential pressure in Pa as Q23.8, rounded to nearest, from a sample's ticks and scale factor
+ *
+ * @note Sensirion's conversion is ticks / scale factor (60 per Pa for the SDP810-500Pa), so 1/256 Pa
+ *       keeps the full sensor resolution without float.
+ */
+inline int32_t Sdp810PressureQ8(int16_t ticks, int16_t scale_factor) {
+  if (scale_factor <= 0) {
+    return 0;
+  }
+  const int32_t kScaled = static_cast<int32_t>(ticks) * 256;
+  const int32_t kHalf = kScaled >= 0 ? scale_factor / 2 : -(scale_factor / 2);
+  return (kScaled + kHalf) / scale_factor;
+}
+
+enum Sdp810Mode {
+  kSdp810ContinuousAverage = 0,   /**< Averages every measurement since the previous read, low noise */
+  kSdp810Continuous,              /**< Newest measurement only, every 0.5 ms, for breath onset latency */
+  kSdp810Triggered,               /**< One measurement per read, the sensor stretches the clock until it is done */
+};
+
+enum Sdp810Compensation {
+  kSdp810MassFlow = 0,            /**< Temperature compensated for mass flow */
+  kSdp810DifferentialPressure,    /**< Temperature compensated for differential pressure */
+};
+
+class DifferentialPressureSensor final : public UniversalSensor {
  public:
   DifferentialPressureSensor() : UniversalSensor() {}
 
+  /**
+   * @brief Addresses probed by SensorEnumerator
+   */
+  static constexpr uint8_t kProbeAddresses[] = {kSdp810I2CAddr};
+
+  /**
+   * @brief Check the product number, handle must already be set to the sensor's address
+   *
+   * @note The SDP810 ignores the ID commands while measuring, a part still measuring
+   *       from before a reset is stopped first, this waits kSdp810StopDelayUs
+   */
+  static bool Identify(I2CDriver *handle);
+
   /**
   * @brief Initialises the sensor with its default settings
   * 
@@ -57,17 +96,83 @@ class DifferentialPressureSensor : public UniversalSensor {
   /**
    * @brief Read the sensor
    * 
+   * @note buffer[0] holds the raw pressure ticks and buffer[1] the scale factor, convert with
+   *       Sdp810PressureQ8 where Pa are needed. Integer Pa truncated away everything below 1 Pa.
+   *       When the read fails the previous values are repeated with status kSdp810StatusBusError.
+   *
    * @return SensorData_t SensorData struct with the sensordata, sample_num and sensor_id
    */
   SensorData GetSensorData() override;
 
+  /**
+   * @brief Read the buffered measurements
+   *
+   * @note In continuous average mode the SDP810 folds every measurement since the
+   *       previous read into one result, so a single read drains the sensor
+   *
+   * @return 1, or 0 when max_samples is 0
+   */
+  size_t ReadSamples(SensorData_t *samples, size_t max_samples) override;
+
+  /**
+   * @brief Stop the current measurement and switch mode, Initialize starts continuous average mass flow
+   *
+   * @note Continuous modes start right away, the first result is ready about 8 ms later
+   */
+  void SetMeasurementMode(Sdp810Mode mode, Sdp810Compensation compensation = kSdp810MassFlow);
+
+  Sdp810Mode GetMeasurementMode() const {
+    return mode_;
+  }
+
+  /**
+   * @brief Stop continuous measurement, the sensor then accepts every command again
+   */
+  void StopMeasurement();
+
+  /**
+   * @brief General call reset, the sensor comes back idle and SetMeasurementMode has to restart it
+   *
+   * @note Every device on the bus that honours the general call resets too
+   */
+  void SoftReset();
+
+  /**
+   * @brief Validate every word's CRC and fetch only the pressure word in steady state
+   *
+   * @note The first valid full frame caches the scale factor, after that a sample is 3 bytes instead of 9.
+   *       A sample whose pressure word fails its CRC repeats the previous pressure with status kSdp810StatusCrcError.
+   *
+   * @param temperature_interval Read the full frame, and with it the temperature, every this many samples, 0 for never
+   */
+  void EnableStreaming(uint16_t temperature_interval);
+
+  void DisableStreaming() {
+    streaming_ = false;
+    sensor_data_.status = 0;
+  }
+
+  /**
+   * @brief Temperature from the last valid full frame, in degrees Celsius times kSdp810TemperatureScale
+   */
+  int16_t GetTemperatureRaw() const {
+    return temperature_raw_;
+  }
+
+  /**
+   * @brief Words rejected on their CRC since EnableStreaming
+   */
+  uint32_t GetCrcErrors() const {
+    return crc_errors_;
+  }
+
   /**
   * @brief Get the availability status of the sensor
   *
   * @return Availability status
   */
   const bool Available() override {
-    return false;  // TODO
+    return i2c_handle_ != nullptr && i2c_handle_->SensorAvailable();
   }
 
   /**
@@ -81,16 +186,30 @@ class DifferentialPressureSensor : public UniversalSensor {
  private:
   const uint8_t SensorType_ = 0x02;
   const uint8_t kSensorI2CAddress_ = kSdp810I2CAddr;
-  I2CDriver *i2c_handle_;
+  I2CDriver *i2c_handle_ = nullptr;
   SensorData sensor_data_{};
 
-  int16_t sensor_raw_;
-  int16_t conversion_factor_;
+  int16_t sensor_raw_ = 0;
+  int16_t conversion_factor_ = 0;
   uint8_t sensor_buffer_[kSdp810BufferSize];
 
+  Sdp810Mode mode_ = kSdp810ContinuousAverage;
+  Sdp810Compensation compensation_ = kSdp810MassFlow;
+  bool measuring_ = false;
+
+  bool streaming_ = false;
+  bool scale_factor_valid_ = false;
+  uint16_t temperature_interval_ = 0;
+  uint16_t reads_since_full_frame_ = 0;
+  int16_t temperature_raw_ = 0;
+  uint32_t crc_errors_ = 0;
+
 // Low level driver functions:
   void BeginSDP810();
+  void SendCommand(uint8_t msb, uint8_t lsb);
   void ReadSdp810();
+  void ReadSdp810Streaming();
+  bool ValidWord(const uint8_t *word);
   int16_t GetRawSDP810();
 };
 
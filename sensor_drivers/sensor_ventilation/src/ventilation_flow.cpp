@@ -0,0 +1,171 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#include <ventilation_flow.hpp>
+#include <sensor_ventilation.hpp>
+
+VentilationFlowMeter::VentilationFlowMeter(const VentilationFlowConfig &config)
+    : config_(config),
+      mirrored_(config.num_of_points > 0 && config.characteristic[0].pressure_q8 >= 0) {
+  if (config_.num_of_points > kVentilationMaxFlowPoints) {
+    config_.num_of_points = kVentilationMaxFlowPoints;
+  }
+}
+
+void VentilationFlowMeter::Reset() {
+  phase_ = kVentilationIdle;
+  has_sample_ = false;
+  has_breath_ = false;
+  flow_ul_s_ = 0;
+  bias_acc_ = 0;
+  inspired_pl_ = 0;
+  expired_pl_ = 0;
+  peak_flow_ul_s_ = 0;
+}
+
+int32_t VentilationFlowMeter::FlowFromPressure(int32_t pressure_q8) const {
+  if (config_.num_of_points < 2) {
+    return 0;
+  }
+  if (mirrored_ && pressure_q8 < 0) {
+    return -FlowFromPressure(-pressure_q8);
+  }
+  const VentilationFlowPoint *kTable = config_.characteristic;
+  const uint8_t kLast = config_.num_of_points - 1;
+  if (pressure_q8 <= kTable[0].pressure_q8) {
+    return kTable[0].flow_ul_s;
+  }
+  if (pressure_q8 >= kTable[kLast].pressure_q8) {
+    return kTable[kLast].flow_ul_s;
+  }
+  // Find the segment with kTable[low] < pressure <= kTable[high]
+  uint8_t low = 0;
+  uint8_t high = kLast;
+  while (high - low > 1) {
+    const uint8_t kMiddle = (low + high) / 2;
+    if (kTable[kMiddle].pressure_q8 < pressure_q8) {
+      low = kMiddle;
+    } else {
+      high = kMiddle;
+    }
+  }
+  const int64_t kRise = static_cast<int64_t>(kTable[high].flow_ul_s - kTable[low].flow_ul_s) *
+                        (pressure_q8 - kTable[low].pressure_q8);
+  return kTable[low].flow_ul_s +
+         static_cast<int32_t>(kRise / (kTable[high].pressure_q8 - kTable[low].pressure_q8));
+}
+
+bool VentilationFlowMeter::Process(const SensorData_t &sample, BreathEvent *event) {
+  if (sample.status != 0) {
+    return false;
+  }
+  return Process(sample.timestamp_us, static_cast<int16_t>(sample.buffer[0]),
+                 static_cast<int16_t>(sample.buffer[1]), event);
+}
+
+bool VentilationFlowMeter::Process(uint32_t timestamp_us, int16_t ticks, int16_t scale_factor,
+                                   BreathEvent *event) {
+  const int32_t kPressureQ8 = Sdp810PressureQ8(ticks, scale_factor);
+  const int32_t kFlow = FlowFromPressure(kPressureQ8 - GetPressureOffsetQ8());
+  const uint32_t kDt = has_sample_ ? timestamp_us - last_us_ : 0;
+  // Trapezoid over the interval since the previous sample, uL/s * us = pL
+  const int64_t kVolumePl = (static_cast<int64_t>(kFlow) + flow_ul_s_) * kDt / 2;
+  has_sample_ = true;
+  last_us_ = timestamp_us;
+  flow_ul_s_ = kFlow;
+
+  const int32_t kMagnitude = kFlow < 0 ? -kFlow : kFlow;
+  if (kMagnitude > config_.end_flow_ul_s) {
+    last_active_us_ = timestamp_us;
+  }
+
+  bool completed = false;
+  switch (phase_) {
+    case kVentilationIdle:
+      if (kFlow > config_.start_flow_ul_s) {
+        BeginBreath(timestamp_us, kVolumePl);
+      } else if (kMagnitude <= config_.end_flow_ul_s) {
+        // Only quiet samples, the rising edge of the next inspiration would pull the offset along
+        bias_acc_ += kPressureQ8 - GetPressureOffsetQ8();
+      }
+      break;
+    case kVentilationInspiration:
+      inspired_pl_ += kVolumePl;
+      if (kFlow > config_.end_flow_ul_s) {
+        breath_end_us_ = timestamp_us;
+      }
+      if (kFlow > peak_flow_ul_s_) {
+        peak_flow_ul_s_ = kFlow;
+      }
+      if (kFlow < config_.end_flow_ul_s) {
+        inspiration_us_ = timestamp_us - breath_start_us_;
+        phase_ = kVentilationExpiration;
+      }
+      break;
+    case kVentilationExpiration:
+      if (kFlow > config_.start_flow_ul_s) {
+        FinishBreath(event);
+        completed = true;
+        BeginBreath(timestamp_us, kVolumePl);
+      } else {
+        expired_pl_ -= kVolumePl;
+        // Only expiratory flow, the rising edge of the next inspiration belongs to that breath
+        if (kFlow < -config_.end_flow_ul_s) {
+          breath_end_us_ = timestamp_us;
+        }
+        if (timestamp_us - last_active_us_ > config_.idle_timeout_us) {
+          FinishBreath(event);
+          completed = true;
+          phase_ = kVentilationIdle;
+        }
+      }
+      break;
+  }
+  return completed;
+}
+
+void VentilationFlowMeter::BeginBreath(uint32_t timestamp_us, int64_t volume_pl) {
+  previous_start_us_ = breath_start_us_;
+  breath_start_us_ = timestamp_us;
+  breath_end_us_ = timestamp_us;
+  inspired_pl_ = volume_pl;
+  expired_pl_ = 0;
+  peak_flow_ul_s_ = flow_ul_s_;
+  phase_ = kVentilationInspiration;
+}
+
+void VentilationFlowMeter::FinishBreath(BreathEvent *event) {
+  event->start_us = breath_start_us_;
+  event->interval_us = has_breath_ ? breath_start_us_ - previous_start_us_ : 0;
+  event->inspiration_us = inspiration_us_;
+  event->duration_us = breath_end_us_ - breath_start_us_;
+  event->inspired_volume_ul = static_cast<int32_t>(inspired_pl_ / 1000000);
+  event->expired_volume_ul = static_cast<int32_t>(expired_pl_ / 1000000);
+  event->peak_flow_ul_s = peak_flow_ul_s_;
+  has_breath_ = true;
+}
@@ -0,0 +1,158 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+#ifndef SENSOR_VENTILATION_FLOW_HPP_
+#define SENSOR_VENTILATION_FLOW_HPP_
+
+#include <stdint.h>
+#include <sensor_helper.hpp>
+
+inline constexpr uint8_t kVentilationMaxFlowPoints = 32;
+
+/**
+ * @brief One point of the flow element characteristic, pressure drop against flow
+ */
+struct VentilationFlowPoint {
+  int32_t pressure_q8;      /**< Differential pressure in Pa, Q23.8 as from Sdp810PressureQ8 */
+  int32_t flow_ul_s;        /**< Flow in uL/s at that pressure */
+};
+
+struct VentilationFlowConfig {
+  const VentilationFlowPoint *characteristic;   /**< Ascending pressure, a table starting at 0 Pa is mirrored */
+  uint8_t num_of_points;                        /**< 2 to kVentilationMaxFlowPoints */
+  int32_t start_flow_ul_s = 100000;             /**< Inspiration starts above this flow */
+  int32_t end_flow_ul_s = 30000;                /**< Inspiration ends below, expiration counts as active above its magnitude */
+  uint32_t idle_timeout_us = 1000000;           /**< Quiet time that closes a breath without a next inspiration */
+  uint8_t bias_shift = 6;                       /**< Zero drift follows quiet idle pressure over 2^bias_shift samples */
+};
+
+enum VentilationPhase {
+  kVentilationIdle = 0,
+  kVentilationInspiration,
+  kVentilationExpiration,
+};
+
+struct BreathEvent {
+  uint32_t start_us;            /**< Timestamp of the sample that started inspiration */
+  uint32_t interval_us;         /**< Since the previous breath started, 0 for the first breath */
+  uint32_t inspiration_us;
+  uint32_t duration_us;         /**< Inspiration start to the last expiratory flow above end_flow_ul_s */
+  int32_t inspired_volume_ul;
+  int32_t expired_volume_ul;
+  int32_t peak_flow_ul_s;
+};
+
+/**
+ * @brief Turns SDP810 samples into flow, integrates it and cuts the stream into breaths
+ *
+ * Every sample costs one table lookup, bounded by kVentilationMaxFlowPoints, and a handful of
+ * integer operations; the state is a few words, nothing is buffered. Volume is integrated with
+ * the trapezoid rule in pL (uL/s times us) and restarts with every breath, so an offset in the
+ * flow can not build up over more than one breath. The pressure offset itself is tracked while
+ * idle with the flow below end_flow_ul_s, and subtracted before the lookup; an offset worth more
+ * flow than that is never learned.
+ *
+ * Nothing here touches the bus, recorded traces can be replayed through Process on Linux.
+ */
+class VentilationFlowMeter {
+ public:
+  explicit VentilationFlowMeter(const VentilationFlowConfig &config);
+
+  /**
+   * @brief Feed one sample from DifferentialPressureSensor, samples with a non-zero status are skipped
+   *
+   * @param event Filled when a breath completes
+   * @return true when event was filled
+   */
+  bool Process(const SensorData_t &sample, BreathEvent *event);
+
+  /**
+   * @brief Feed one measurement as pressure ticks and scale factor
+   */
+  bool Process(uint32_t timestamp_us, int16_t ticks, int16_t scale_factor, BreathEvent *event);
+
+  /**
+   * @brief Forget the current breath and the learned pressure offset
+   */
+  void Reset();
+
+  /**
+   * @brief Flow at the last sample, offset corrected
+   */
+  int32_t GetFlow() const {
+    return flow_ul_s_;
+  }
+
+  /**
+   * @brief Volume inspired so far in the current breath
+   */
+  int32_t GetInspiredVolume() const {
+    return static_cast<int32_t>(inspired_pl_ / 1000000);
+  }
+
+  VentilationPhase GetPhase() const {
+    return phase_;
+  }
+
+  /**
+   * @brief Learned pressure offset in Pa, Q23.8
+   */
+  int32_t GetPressureOffsetQ8() const {
+    return bias_acc_ >> config_.bias_shift;
+  }
+
+  /**
+   * @brief Interpolate the characteristic, clamped to its ends
+   */
+  int32_t FlowFromPressure(int32_t pressure_q8) const;
+
+ private:
+  VentilationFlowConfig config_;
+  bool mirrored_;
+
+  VentilationPhase phase_ = kVentilationIdle;
+  bool has_sample_ = false;
+  bool has_breath_ = false;
+  uint32_t last_us_ = 0;
+  uint32_t last_active_us_ = 0;
+  int32_t flow_ul_s_ = 0;
+  int32_t bias_acc_ = 0;
+
+  uint32_t breath_start_us_ = 0;
+  uint32_t breath_end_us_ = 0;
+  uint32_t previous_start_us_ = 0;
+  uint32_t inspiration_us_ = 0;
+  int64_t inspired_pl_ = 0;
+  int64_t expired_pl_ = 0;
+  int32_t peak_flow_ul_s_ = 0;
+
+  void BeginBreath(uint32_t timestamp_us, int64_t volume_pl);
+  void FinishBreath(BreathEvent *event);
+};
+
+#endif  // SENSOR_VENTILATION_FLOW_HPP_
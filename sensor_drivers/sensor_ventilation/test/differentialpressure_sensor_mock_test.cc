@@ -28,8 +28,11 @@
 
 #include <gmock/gmock.h>
 #include <i2c_helper.hpp>
-#include <sensor_differentialpressure.hpp>
+#include <sensor_ventilation.hpp>
 #include <sdp810_registers.hpp>
+#include <ventilation_flow.hpp>
+#include <vector>
+#include <cmath>
 
 using ::testing::Return;
 using ::testing::InSequence;
@@ -41,12 +44,14 @@ uint8_t initialize_test_temp_buffer[2];
 constexpr uint8_t arb_test_buffer[kSdp810BufferSize] = {0x20, 0x50, 0x70, 0x90,
                                               0x72, 0x10, 0x05, 0x02, 0x09};
 
-void CopyExampleBufferToBuffer(uint8_t *buffer, uint8_t num_of_bytes) {
+uint8_t CopyExampleBufferToBuffer(uint8_t *buffer, uint8_t num_of_bytes) {
   memcpy(buffer, arb_test_buffer, num_of_bytes);
+  return 0;
 }
 
-void CopyBufferToTestBuffer(uint8_t *buffer, uint8_t num_of_bytes) {
+uint8_t CopyBufferToTestBuffer(const uint8_t *buffer, uint8_t num_of_bytes) {
   memcpy(initialize_test_temp_buffer, buffer, num_of_bytes);
+  return 0;
 }
 
 TEST(DifferentialPressureSensorTest, Initialize) {
@@ -64,17 +69,414 @@ TEST(DifferentialPressureSensorTest, GetSensorData) {
   // ToDo: Check the conversion-factor for the SDP810 sensor
   /* Generated Parameters */
   const int kConversionFactor = arb_test_buffer[6] << (kSdp810BufferSize - 1) | arb_test_buffer[7];
-  const int kSensorOutput = (arb_test_buffer[0] << (kSdp810BufferSize - 1) | arb_test_buffer[1]) / kConversionFactor;
+  const int kSensorOutput = arb_test_buffer[0] << (kSdp810BufferSize - 1) | arb_test_buffer[1];
   I2CDriver i2c_handle_mock;
   DifferentialPressureSensor DiffPressSensor;
   DiffPressSensor.Initialize(&i2c_handle_mock);
   EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(CopyExampleBufferToBuffer));
   SensorData data = DiffPressSensor.GetSensorData();
   EXPECT_EQ(data.buffer[0], kSensorOutput);
+  EXPECT_EQ(data.buffer[1], kConversionFactor);
   EXPECT_EQ(data.num_of_bytes, kSdp810BytesToReturn);
+  EXPECT_EQ(data.element_type, kSensorElementI16);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, ReadSamplesDrainsAveragedResult) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  // The sensor averages everything since the last read, so one read drains it
+  EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(CopyExampleBufferToBuffer));
+  SensorData samples[4];
+  UniversalSensor *sensor = &DiffPressSensor;
+  EXPECT_EQ(sensor->ReadSamples(samples, 4), 1u);
+  EXPECT_EQ(samples[0].num_of_bytes, kSdp810BytesToReturn);
+  EXPECT_EQ(sensor->ReadSamples(samples, 0), 0u);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+uint32_t fake_time_us = 0;
+
+uint32_t FakeClock() {
+  return fake_time_us;
+}
+
+uint8_t CopyExampleBufferAndAdvanceClock(uint8_t *buffer, uint8_t num_of_bytes) {
+  fake_time_us += 500;
+  return CopyExampleBufferToBuffer(buffer, num_of_bytes);
+}
+
+TEST(DifferentialPressureSensorTest, SamplesCarryTimestampAndSequence) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  fake_time_us = 1000;
+  SetSensorClock(FakeClock);
+  EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).Times(2)
+      .WillRepeatedly(Invoke(CopyExampleBufferAndAdvanceClock));
+  SensorData first = DiffPressSensor.GetSensorData();
+  SensorData second = DiffPressSensor.GetSensorData();
+  // Stamped after the read, not before it
+  EXPECT_EQ(first.timestamp_us, 1500u);
+  EXPECT_EQ(second.timestamp_us, 2000u);
+  EXPECT_EQ(second.sample_num, first.sample_num + 1);
+  SetSensorClock(SensorDefaultClock);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, FailedReadRepeatsPreviousSample) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  const uint8_t kNack = 2;
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(CopyExampleBufferToBuffer));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Return(kNack));
+  }
+  SensorData first = DiffPressSensor.GetSensorData();
+  SensorData failed = DiffPressSensor.GetSensorData();
+  EXPECT_EQ(failed.status, kSdp810StatusBusError);
+  EXPECT_EQ(failed.buffer[0], first.buffer[0]);
+  EXPECT_EQ(failed.buffer[1], first.buffer[1]);
+  EXPECT_EQ(failed.sample_num, first.sample_num + 1);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, IdentifyChecksProductNumber) {
+  I2CDriver i2c_handle_mock;
+  // SDP810-500Pa product number 0x03020A01, every word followed by its CRC
+  static const uint8_t kProductId[kSdp810ProductIdSize] = {0x03, 0x02, 0xCE, 0x0A, 0x01, 0x5E};
+  static const uint8_t kBadCrc[kSdp810ProductIdSize] = {0x03, 0x02, 0xCF, 0x0A, 0x01, 0x5E};
+  {
+    InSequence seq;
+    for (const uint8_t *id : {kProductId, kBadCrc}) {
+      EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize)).Times(3);
+      EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810ProductIdSize))
+          .WillOnce(Invoke([id](uint8_t *buffer, uint8_t num_of_bytes) { memcpy(buffer, id, num_of_bytes); return 0; }));
+    }
+  }
+  EXPECT_TRUE(DifferentialPressureSensor::Identify(&i2c_handle_mock));
+  EXPECT_FALSE(DifferentialPressureSensor::Identify(&i2c_handle_mock));
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  // Nothing answering at the address: the stop command is NACKed, no ID is read
+  const uint8_t kNack = 2;
+  EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize)).WillOnce(Return(kNack));
+  EXPECT_CALL(i2c_handle_mock, ReadBytes(_, _)).Times(0);
+  EXPECT_FALSE(DifferentialPressureSensor::Identify(&i2c_handle_mock));
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+uint8_t TestCrc(const uint8_t *data) {
+  uint8_t crc = kSdp810CrcInit;
+  for (uint8_t i = 0; i < 2; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ kSdp810CrcPolynomial : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Pressure, temperature and scale factor words with valid CRCs
+void BuildSdp810Frame(uint8_t *frame, int16_t pressure, int16_t temperature, int16_t scale_factor) {
+  const int16_t kWords[3] = {pressure, temperature, scale_factor};
+  for (uint8_t i = 0; i < 3; i++) {
+    frame[i * kSdp810WordSize] = static_cast<uint16_t>(kWords[i]) >> 8;
+    frame[i * kSdp810WordSize + 1] = kWords[i] & 0xFF;
+    frame[i * kSdp810WordSize + 2] = TestCrc(&frame[i * kSdp810WordSize]);
+  }
+}
+
+TEST(DifferentialPressureSensorTest, StreamingReadsPressureWordAfterFirstFrame) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  DiffPressSensor.EnableStreaming(3);
+
+  uint8_t frame[kSdp810BufferSize];
+  int16_t pressure = 600;
+  auto serve = [&](uint8_t *buffer, uint8_t num_of_bytes) {
+    BuildSdp810Frame(frame, pressure, 25 * kSdp810TemperatureScale, 60);
+    memcpy(buffer, frame, num_of_bytes);
+    return 0;
+  };
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(serve));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810WordSize)).Times(3).WillRepeatedly(Invoke(serve));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(serve));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810WordSize)).WillOnce(Invoke(serve));
+  }
+  for (int i = 0; i < 6; i++) {
+    pressure = -120 * i;
+    SensorData data = DiffPressSensor.GetSensorData();
+    EXPECT_EQ(static_cast<int16_t>(data.buffer[0]), -120 * i);
+    EXPECT_EQ(data.buffer[1], 60);
+    EXPECT_EQ(data.status, 0);
+  }
+  EXPECT_EQ(DiffPressSensor.GetTemperatureRaw(), 25 * kSdp810TemperatureScale);
+  EXPECT_EQ(DiffPressSensor.GetCrcErrors(), 0u);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, StreamingRejectsWordsFailingCrc) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  DiffPressSensor.EnableStreaming(0);
+
+  uint8_t good[kSdp810BufferSize];
+  uint8_t bad_scale[kSdp810BufferSize];
+  uint8_t bad_pressure[kSdp810BufferSize];
+  BuildSdp810Frame(good, 300, 0, 60);
+  BuildSdp810Frame(bad_scale, 300, 0, 60);
+  bad_scale[kSdp810ScaleFactorOffset + 2] ^= 0x01;
+  BuildSdp810Frame(bad_pressure, 1200, 0, 60);
+  bad_pressure[kSdp810PressureOffset] ^= 0x80;
+  auto serve = [](const uint8_t *frame) {
+    return Invoke([frame](uint8_t *buffer, uint8_t num_of_bytes) { memcpy(buffer, frame, num_of_bytes); return 0; });
+  };
+  {
+    InSequence seq;
+    // No scale factor yet: nothing to convert with, the full frame is read again
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(serve(bad_scale));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(serve(good));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810WordSize)).WillOnce(serve(bad_pressure));
+  }
+  EXPECT_EQ(DiffPressSensor.GetSensorData().status, kSdp810StatusCrcError);
+  SensorData data = DiffPressSensor.GetSensorData();
+  EXPECT_EQ(data.status, 0);
+  EXPECT_EQ(data.buffer[0], 300);
+  data = DiffPressSensor.GetSensorData();
+  EXPECT_EQ(data.status, kSdp810StatusCrcError);
+  EXPECT_EQ(data.buffer[0], 300);
+  EXPECT_EQ(DiffPressSensor.GetCrcErrors(), 2u);
   Mock::VerifyAndClearExpectations(&i2c_handle_mock);
 }
 
+TEST(DifferentialPressureSensorTest, DisableStreamingClearsCrcStatus) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  DiffPressSensor.EnableStreaming(0);
+
+  uint8_t bad_scale[kSdp810BufferSize];
+  uint8_t good[kSdp810BufferSize];
+  BuildSdp810Frame(bad_scale, 300, 0, 60);
+  bad_scale[kSdp810ScaleFactorOffset + 2] ^= 0x01;
+  BuildSdp810Frame(good, 400, 0, 60);
+  auto serve = [](const uint8_t *frame) {
+    return Invoke([frame](uint8_t *buffer, uint8_t num_of_bytes) { memcpy(buffer, frame, num_of_bytes); return 0; });
+  };
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(serve(bad_scale));
+    EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(serve(good));
+  }
+  EXPECT_EQ(DiffPressSensor.GetSensorData().status, kSdp810StatusCrcError);
+  DiffPressSensor.DisableStreaming();
+  SensorData data = DiffPressSensor.GetSensorData();
+  EXPECT_EQ(data.status, 0);
+  EXPECT_EQ(data.buffer[0], 400);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, PressureQ8MatchesSensirionConversion) {
+  // SDP810-500Pa and SDP810-125Pa scale factors, ticks covering their full range
+  const struct {
+    int16_t scale_factor;
+    int32_t max_pa;
+  } kParts[] = {{60, 500}, {240, 125}};
+  for (const auto &kPart : kParts) {
+    const int32_t kMaxTicks = kPart.max_pa * kPart.scale_factor;
+    for (int32_t ticks = -kMaxTicks; ticks <= kMaxTicks; ticks++) {
+      const double kReferencePa = static_cast<double>(ticks) / kPart.scale_factor;
+      const int32_t kQ8 = Sdp810PressureQ8(static_cast<int16_t>(ticks), kPart.scale_factor);
+      ASSERT_LE(std::fabs(kQ8 / 256.0 - kReferencePa), 0.5 / 256 + 1e-9) << "ticks " << ticks;
+    }
+  }
+  // Below 1 Pa is no longer lost: 30 ticks is 0.5 Pa, not 0
+  EXPECT_EQ(Sdp810PressureQ8(30, 60), 128);
+  EXPECT_EQ(Sdp810PressureQ8(-30, 60), -128);
+  EXPECT_EQ(Sdp810PressureQ8(100, 0), 0);
+}
+
+// Orifice: flow = 50 mL/s per sqrt(Pa), points at (i / 2)^2 Pa
+std::vector<VentilationFlowPoint> OrificeCharacteristic() {
+  std::vector<VentilationFlowPoint> points;
+  for (int i = 0; i < kVentilationMaxFlowPoints; i++) {
+    const double kPa = (i / 2.0) * (i / 2.0);
+    points.push_back({static_cast<int32_t>(std::lround(kPa * 256)), static_cast<int32_t>(std::lround(50000 * i / 2.0))});
+  }
+  return points;
+}
+
+// 500 Hz trace of breaths every 5 s: 1 s inspiration peaking at 500 mL/s, 1.5 s expiration at -400 mL/s,
+// through the orifice above, with a 0.3 Pa sensor offset
+std::vector<SensorData> BreathTrace(int num_of_breaths, double period_s = 5.0) {
+  std::vector<SensorData> trace;
+  const double kIdleS = 2.0;
+  const double kPeriodS = period_s;
+  for (uint32_t n = 0; n * 0.002 < kIdleS + num_of_breaths * kPeriodS; n++) {
+    const double kT = n * 0.002 - kIdleS;
+    const double kPhase = kT - kPeriodS * std::floor(kT / kPeriodS);
+    double flow = 0;
+    if (kT >= 0 && kPhase < 1.0) {
+      flow = 500 * std::sin(M_PI * kPhase);
+    } else if (kT >= 0 && kPhase >= 1.2 && kPhase < 2.7) {
+      flow = -400 * std::sin(M_PI * (kPhase - 1.2) / 1.5);
+    }
+    const double kPa = (flow < 0 ? -1 : 1) * (flow / 50) * (flow / 50) + 0.3;
+    SensorData sample = {};
+    sample.timestamp_us = n * 2000;
+    sample.buffer[0] = static_cast<uint16_t>(static_cast<int16_t>(std::lround(kPa * 60)));
+    sample.buffer[1] = 60;
+    trace.push_back(sample);
+  }
+  return trace;
+}
+
+uint16_t ReadCommand(const uint8_t *buffer) {
+  return (buffer[0] << 8) | buffer[1];
+}
+
+TEST(DifferentialPressureSensorTest, MeasurementModesSendTheirCommands) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+
+  std::vector<uint16_t> commands;
+  EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize))
+      .WillRepeatedly(Invoke([&commands](const uint8_t *buffer, uint8_t) { commands.push_back(ReadCommand(buffer)); return 0; }));
+  DiffPressSensor.SetMeasurementMode(kSdp810Continuous);
+  DiffPressSensor.SetMeasurementMode(kSdp810ContinuousAverage, kSdp810DifferentialPressure);
+  DiffPressSensor.SetMeasurementMode(kSdp810Continuous, kSdp810DifferentialPressure);
+  DiffPressSensor.StopMeasurement();
+  // Already stopped: no second stop command
+  DiffPressSensor.StopMeasurement();
+  const std::vector<uint16_t> kExpected = {0x3FF9, 0x3608, 0x3FF9, 0x3615, 0x3FF9, 0x361E, 0x3FF9};
+  EXPECT_EQ(commands, kExpected);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, TriggeredModeStartsEveryMeasurement) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  DiffPressSensor.SetMeasurementMode(kSdp810Triggered);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  {
+    InSequence seq;
+    for (int i = 0; i < 2; i++) {
+      EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize))
+          .WillOnce(Invoke([](const uint8_t *buffer, uint8_t) { EXPECT_EQ(ReadCommand(buffer), 0x3726); return 0; }));
+      EXPECT_CALL(i2c_handle_mock, ReadBytes(_, kSdp810BufferSize)).WillOnce(Invoke(CopyExampleBufferToBuffer));
+    }
+  }
+  DiffPressSensor.GetSensorData();
+  DiffPressSensor.GetSensorData();
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  // Nothing runs between triggers, so switching back needs no stop
+  EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize))
+      .WillOnce(Invoke([](const uint8_t *buffer, uint8_t) { EXPECT_EQ(ReadCommand(buffer), 0x3603); return 0; }));
+  DiffPressSensor.SetMeasurementMode(kSdp810ContinuousAverage);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(DifferentialPressureSensorTest, SoftResetUsesGeneralCall) {
+  I2CDriver i2c_handle_mock;
+  DifferentialPressureSensor DiffPressSensor;
+  DiffPressSensor.Initialize(&i2c_handle_mock);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+  {
+    InSequence seq;
+    EXPECT_CALL(i2c_handle_mock, ChangeAddress(kGeneralCallAddr));
+    EXPECT_CALL(i2c_handle_mock, SendByte(kGeneralCallReset));
+    EXPECT_CALL(i2c_handle_mock, ChangeAddress(kSdp810I2CAddr));
+    // The reset stopped the measurement, restarting sends no stop first
+    EXPECT_CALL(i2c_handle_mock, SendBytes(_, kSdp810InitCmdSize))
+        .WillOnce(Invoke([](const uint8_t *buffer, uint8_t) { EXPECT_EQ(ReadCommand(buffer), 0x3603); return 0; }));
+  }
+  DiffPressSensor.SoftReset();
+  DiffPressSensor.SetMeasurementMode(kSdp810ContinuousAverage);
+  Mock::VerifyAndClearExpectations(&i2c_handle_mock);
+}
+
+TEST(VentilationFlowTest, CharacteristicIsMirroredAndClamped) {
+  const std::vector<VentilationFlowPoint> kPoints = OrificeCharacteristic();
+  VentilationFlowConfig config;
+  config.characteristic = kPoints.data();
+  config.num_of_points = kPoints.size();
+  VentilationFlowMeter meter(config);
+  EXPECT_EQ(meter.FlowFromPressure(0), 0);
+  EXPECT_EQ(meter.FlowFromPressure(100 * 256), 500000);
+  EXPECT_EQ(meter.FlowFromPressure(-100 * 256), -500000);
+  // Halfway between 4 Pa (100 mL/s) and 6.25 Pa (125 mL/s)
+  EXPECT_EQ(meter.FlowFromPressure(static_cast<int32_t>(5.125 * 256)), 112500);
+  EXPECT_EQ(meter.FlowFromPressure(1000 * 256), kPoints.back().flow_ul_s);
+}
+
+TEST(VentilationFlowTest, SegmentsBreathsFromTrace) {
+  const std::vector<VentilationFlowPoint> kPoints = OrificeCharacteristic();
+  VentilationFlowConfig config;
+  config.characteristic = kPoints.data();
+  config.num_of_points = kPoints.size();
+  VentilationFlowMeter meter(config);
+
+  std::vector<SensorData> trace = BreathTrace(3);
+  // A rejected frame in the middle of an inspiration is skipped, not integrated
+  trace[1600].status = kSdp810StatusCrcError;
+  trace[1600].buffer[0] = 0x7FFF;
+  std::vector<BreathEvent> events;
+  for (const SensorData &kSample : trace) {
+    BreathEvent event;
+    if (meter.Process(kSample, &event)) {
+      events.push_back(event);
+    }
+  }
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_NEAR(meter.GetPressureOffsetQ8(), 0.3 * 256, 3);
+  for (size_t i = 0; i < events.size(); i++) {
+    // Exact: 2 / pi * 500 mL/s * 1 s and 2 / pi * 400 mL/s * 1.5 s
+    EXPECT_NEAR(events[i].inspired_volume_ul, 318310, 318310 * 0.02) << "breath " << i;
+    EXPECT_NEAR(events[i].expired_volume_ul, 381972, 381972 * 0.03) << "breath " << i;
+    EXPECT_NEAR(events[i].peak_flow_ul_s, 500000, 5000);
+    // Hysteresis: from 100 mL/s rising to 30 mL/s falling, 0.064 s to 0.981 s into the half sine
+    EXPECT_NEAR(events[i].inspiration_us, 917000, 10000);
+    EXPECT_NEAR(events[i].duration_us, 2600000, 50000);
+    EXPECT_EQ(events[i].interval_us, i == 0 ? 0u : 5000000u);
+  }
+  EXPECT_EQ(meter.GetPhase(), kVentilationIdle);
+}
+
+TEST(VentilationFlowTest, BackToBackBreathEndsAtLastExpiratorySample) {
+  const std::vector<VentilationFlowPoint> kPoints = OrificeCharacteristic();
+  VentilationFlowConfig config;
+  config.characteristic = kPoints.data();
+  config.num_of_points = kPoints.size();
+  VentilationFlowMeter meter(config);
+
+  // 0.3 s of quiet between breaths, shorter than the idle timeout: the next inspiration closes each breath,
+  // the trace ends before the last one times out
+  std::vector<BreathEvent> events;
+  for (const SensorData &kSample : BreathTrace(4, 3.0)) {
+    BreathEvent event;
+    if (meter.Process(kSample, &event)) {
+      events.push_back(event);
+    }
+  }
+  ASSERT_EQ(events.size(), 3u);
+  for (size_t i = 0; i < events.size(); i++) {
+    EXPECT_NEAR(events[i].duration_us, 2600000, 50000) << "breath " << i;
+  }
+  EXPECT_EQ(events[1].interval_us, 3000000u);
+  EXPECT_LT(events[1].duration_us, events[1].interval_us);
+}
+
 int main(int argc, char **argv) {
   // ::testing::InitGoogleTest(&argc, argv);
   // if you plan to use GMock, replace the line above with
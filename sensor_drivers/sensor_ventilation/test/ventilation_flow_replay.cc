@@ -0,0 +1,107 @@
+/* *******************************************************************************************
+ * Copyright (c) 2023 by RobotPatient Simulators
+ *
+ * Authors: Richard Kroesen en Victor Hogeweij
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,
+ *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so,
+ *
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+***********************************************************************************************/
+
+/*
+ * Replays a recorded SDP810 trace through VentilationFlowMeter and prints every breath.
+ *
+ * Usage: ventilation_flow_replay trace.csv characteristic.csv
+ *
+ * trace.csv holds one sample per line: timestamp_us, pressure ticks, scale factor.
+ * characteristic.csv holds the flow element: pressure in Pa, flow in mL/s, ascending pressure.
+ */
+
+#include <ventilation_flow.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool ReadColumns(std::ifstream *file, double *columns, size_t count) {
+  std::string line;
+  while (std::getline(*file, line)) {
+    std::stringstream fields(line);
+    std::string field;
+    size_t i = 0;
+    for (; i < count && std::getline(fields, field, ','); i++) {
+      try {
+        columns[i] = std::stod(field);
+      } catch (...) {
+        break;  // Header line
+      }
+    }
+    if (i == count) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: %s trace.csv characteristic.csv\n", argv[0]);
+    return 1;
+  }
+  std::ifstream characteristic_file(argv[2]);
+  std::vector<VentilationFlowPoint> points;
+  double point[2];
+  while (points.size() < kVentilationMaxFlowPoints && ReadColumns(&characteristic_file, point, 2)) {
+    points.push_back({static_cast<int32_t>(std::lround(point[0] * 256)),
+                      static_cast<int32_t>(std::lround(point[1] * 1000))});
+  }
+  std::ifstream trace_file(argv[1]);
+  if (points.size() < 2 || !trace_file) {
+    std::fprintf(stderr, "need a trace and at least two characteristic points\n");
+    return 1;
+  }
+
+  VentilationFlowConfig config;
+  config.characteristic = points.data();
+  config.num_of_points = points.size();
+  VentilationFlowMeter meter(config);
+
+  double sample[3];
+  while (ReadColumns(&trace_file, sample, 3)) {
+    BreathEvent event;
+    if (meter.Process(static_cast<uint32_t>(sample[0]), static_cast<int16_t>(sample[1]),
+                      static_cast<int16_t>(sample[2]), &event)) {
+      std::printf("breath at %9.3f s  rate %5.1f /min  insp %5.2f s  duration %5.2f s  "
+                  "Vi %7.1f mL  Ve %7.1f mL  peak %6.1f mL/s\n",
+                  event.start_us / 1e6, event.interval_us ? 60e6 / event.interval_us : 0.0,
+                  event.inspiration_us / 1e6, event.duration_us / 1e6, event.inspired_volume_ul / 1e3,
+                  event.expired_volume_ul / 1e3, event.peak_flow_ul_s / 1e3);
+    }
+  }
+  std::printf("pressure offset %.3f Pa\n", meter.GetPressureOffsetQ8() / 256.0);
+  return 0;
+}